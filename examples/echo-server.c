@@ -43,6 +43,10 @@ struct message_s
 };
 
 unsigned char stop_loop = 0;
+/* The transfer is created for the first message, and then only switched
+ * between transmission and reception, which keeps the radio open and tuned */
+gmsk_transfer_t transfer = NULL;
+struct message_s message;
 
 int transmission_callback(void *context,
                           unsigned char *payload,
@@ -61,38 +65,6 @@ int transmission_callback(void *context,
   return(size);
 }
 
-void transmit(unsigned char *data,
-              unsigned int size,
-              unsigned long int frequency)
-{
-  struct message_s message = {data, size, 0};
-  gmsk_transfer_t transfer = gmsk_transfer_create_callback(RADIO_DRIVER,
-                                                           1,
-                                                           transmission_callback,
-                                                           (void *) &message,
-                                                           SAMPLE_RATE,
-                                                           BIT_RATE,
-                                                           frequency,
-                                                           FREQUENCY_OFFSET,
-                                                           BIT_RATE / 100,
-                                                           TRANSMISSION_GAIN,
-                                                           0,
-                                                           BT,
-                                                           INNER_FEC,
-                                                           OUTER_FEC,
-                                                           "",
-                                                           NULL,
-                                                           0,
-                                                           0);
-  if(transfer == NULL)
-  {
-    return;
-  }
-  gmsk_transfer_start(transfer);
-  sleep(1); /* Give time to the hackrf to send the last samples */
-  gmsk_transfer_free(transfer);
-}
-
 int reception_callback(void *context,
                        unsigned char *payload,
                        unsigned int payload_size)
@@ -107,35 +79,68 @@ int reception_callback(void *context,
   return(payload_size);
 }
 
+int prepare_transfer(unsigned char emit, unsigned long int frequency)
+{
+  char *gain = emit ? TRANSMISSION_GAIN : RECEPTION_GAIN;
+  int (*callback)(void *, unsigned char *, unsigned int) =
+    emit ? transmission_callback : reception_callback;
+
+  if(transfer)
+  {
+    return(gmsk_transfer_switch_direction(transfer,
+                                          emit,
+                                          gain,
+                                          callback,
+                                          (void *) &message));
+  }
+  transfer = gmsk_transfer_create_callback(RADIO_DRIVER,
+                                           emit,
+                                           callback,
+                                           (void *) &message,
+                                           SAMPLE_RATE,
+                                           BIT_RATE,
+                                           frequency,
+                                           FREQUENCY_OFFSET,
+                                           BIT_RATE / 100,
+                                           gain,
+                                           0,
+                                           BT,
+                                           INNER_FEC,
+                                           OUTER_FEC,
+                                           "",
+                                           NULL,
+                                           0,
+                                           0);
+  return((transfer == NULL) ? -1 : 0);
+}
+
+void transmit(unsigned char *data,
+              unsigned int size,
+              unsigned long int frequency)
+{
+  message.data = data;
+  message.size = size;
+  message.done = 0;
+  if(prepare_transfer(1, frequency) < 0)
+  {
+    return;
+  }
+  gmsk_transfer_start(transfer);
+}
+
 void receive_1(unsigned char *data,
                unsigned int *size,
                unsigned long int frequency)
 {
-  struct message_s message = {data, *size, 0};
-  gmsk_transfer_t transfer = gmsk_transfer_create_callback(RADIO_DRIVER,
-                                                           0,
-                                                           reception_callback,
-                                                           (void *) &message,
-                                                           SAMPLE_RATE,
-                                                           BIT_RATE,
-                                                           frequency,
-                                                           FREQUENCY_OFFSET,
-                                                           BIT_RATE / 100,
-                                                           RECEPTION_GAIN,
-                                                           0,
-                                                           BT,
-                                                           INNER_FEC,
-                                                           OUTER_FEC,
-                                                           "",
-                                                           NULL,
-                                                           0,
-                                                           0);
-  if(transfer == NULL)
+  message.data = data;
+  message.size = *size;
+  message.done = 0;
+  if(prepare_transfer(0, frequency) < 0)
   {
+    *size = 0;
     return;
   }
   gmsk_transfer_start(transfer);
-  gmsk_transfer_free(transfer);
   *size = message.done;
 }
 
@@ -242,5 +247,6 @@ int main(int argc, char **argv)
     usage();
     return(-1);
   }
+  gmsk_transfer_free(transfer);
   return(0);
 }
@@ -39,7 +39,15 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 void usage()
 {
   fprintf(stderr, "Usage:\n");
-  fprintf(stderr, "  full-duplex <downlink frequency> <uplink frequency>\n");
+  fprintf(stderr, "  full-duplex <downlink frequency> <uplink frequency> [radio]\n");
+  fprintf(stderr, "\n");
+  fprintf(stderr, "By default, two radios are used. If a full-duplex radio is\n");
+  fprintf(stderr, "given (e.g. \"driver=lime\", \"loopback\" or\n");
+  fprintf(stderr, "\"sim=snr=12\"), it is used in both directions.\n");
+  fprintf(stderr, "\n");
+  fprintf(stderr, "The \"loopback\" and \"sim\" radios give the samples of the\n");
+  fprintf(stderr, "uplink to the downlink without changing their frequency, so\n");
+  fprintf(stderr, "both frequencies must be the same to receive the uplink.\n");
 }
 
 void signal_handler(int signum)
@@ -65,7 +73,7 @@ int main(int argc, char **argv)
   gmsk_transfer_t uplink;
   pthread_t uplink_thread;
 
-  if(argc != 3)
+  if((argc != 3) && (argc != 4))
   {
     usage();
     return(EXIT_FAILURE);
@@ -74,7 +82,7 @@ int main(int argc, char **argv)
   downlink_frequency = strtoul(argv[1], NULL, 10);
   uplink_frequency = strtoul(argv[2], NULL, 10);
 
-  downlink = gmsk_transfer_create(DOWNLINK_RADIO,
+  downlink = gmsk_transfer_create((argc == 4) ? argv[3] : DOWNLINK_RADIO,
                                   0,
                                   NULL,
                                   DOWNLINK_SAMPLE_RATE,
@@ -97,23 +105,37 @@ int main(int argc, char **argv)
     return(EXIT_FAILURE);
   }
 
-  uplink = gmsk_transfer_create(UPLINK_RADIO,
-                                1,
-                                NULL,
-                                UPLINK_SAMPLE_RATE,
-                                BIT_RATE,
-                                uplink_frequency,
-                                UPLINK_FREQUENCY_OFFSET,
-                                0,
-                                UPLINK_GAIN,
-                                0,
-                                BT,
-                                INNER_FEC,
-                                OUTER_FEC,
-                                "",
-                                NULL,
-                                0,
-                                0);
+  if(argc == 4)
+  {
+    /* The uplink has its own stream on the device of the downlink */
+    uplink = gmsk_transfer_create_shared(downlink,
+                                         1,
+                                         NULL,
+                                         uplink_frequency,
+                                         UPLINK_FREQUENCY_OFFSET,
+                                         UPLINK_GAIN,
+                                         0);
+  }
+  else
+  {
+    uplink = gmsk_transfer_create(UPLINK_RADIO,
+                                  1,
+                                  NULL,
+                                  UPLINK_SAMPLE_RATE,
+                                  BIT_RATE,
+                                  uplink_frequency,
+                                  UPLINK_FREQUENCY_OFFSET,
+                                  0,
+                                  UPLINK_GAIN,
+                                  0,
+                                  BT,
+                                  INNER_FEC,
+                                  OUTER_FEC,
+                                  "",
+                                  NULL,
+                                  0,
+                                  0);
+  }
   if(uplink == NULL)
   {
     fprintf(stderr, "Error: Failed to initialize uplink.\n");
@@ -0,0 +1,551 @@
+/*
+Example of use of gmsk-transfer's API to measure the packet error rate of
+links using different parameters through a simulated radio channel.
+
+Copyright 2022 Guillaume LE VAILLANT
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <gmsk-transfer.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <unistd.h>
+
+#define FREQUENCY 434000000
+#define MAXIMUM_VALUES 32
+#define DEFAULT_BIT_RATE 9600
+#define DEFAULT_BT 0.5
+#define DEFAULT_FEC "h128,none"
+#define DEFAULT_FRAMES 100
+/* By default, the sample rate is 8 times the bit rate */
+#define DEFAULT_SAMPLES_PER_BIT 8
+
+typedef struct
+{
+  unsigned int bit_rate;
+  float bt;
+  char *fec;
+  float ebn0;
+  /* Results */
+  int failed;
+  unsigned int frames_received;
+  unsigned long int bytes_received;
+  double throughput;
+  double cpu_time;
+} point_t;
+
+typedef struct
+{
+  point_t *points;
+  unsigned int points_count;
+  atomic_uint next_point;
+  unsigned int frames;
+  unsigned long int sample_rate;
+  float cfo;
+} sweep_t;
+
+typedef struct
+{
+  unsigned int frames;
+  unsigned int index;
+} tx_context_t;
+
+typedef struct
+{
+  gmsk_transfer_t transfer;
+  unsigned int frames;
+  unsigned int frames_received;
+  unsigned long int bytes_received;
+  /* Index and reception time of the first and last frames received, to
+   * measure the time taken by a frame on the channel */
+  unsigned int first_index;
+  long long int first_time;
+  unsigned int last_index;
+  long long int last_time;
+  double cpu_time;
+} rx_context_t;
+
+void usage()
+{
+  fprintf(stderr, "Usage:\n");
+  fprintf(stderr, "  per-sweep [options] [output file]\n");
+  fprintf(stderr, "\n");
+  fprintf(stderr, "Send frames between two transfers through a simulated\n");
+  fprintf(stderr, "channel for each combination of the parameters, and\n");
+  fprintf(stderr, "write the packet error rate, the throughput and the CPU\n");
+  fprintf(stderr, "time as CSV to the output file (or to stdout).\n");
+  fprintf(stderr, "\n");
+  fprintf(stderr, "Options:\n");
+  fprintf(stderr, "  -b <bit rate>  (default: %u b/s)\n", DEFAULT_BIT_RATE);
+  fprintf(stderr, "  -c <carrier frequency offset>  (default: 0 Hz)\n");
+  fprintf(stderr, "  -E <min:max:step>  (default: 0:12:1)\n");
+  fprintf(stderr, "    Range of Eb/N0 values in dB.\n");
+  fprintf(stderr, "  -e <inner fec,outer fec>  (default: %s)\n", DEFAULT_FEC);
+  fprintf(stderr, "  -f <frames>  (default: %u)\n", DEFAULT_FRAMES);
+  fprintf(stderr, "    Number of frames sent for each combination.\n");
+  fprintf(stderr, "  -h\n");
+  fprintf(stderr, "  -j <jobs>  (default: half the number of processors)\n");
+  fprintf(stderr, "    Number of combinations measured at the same time.\n");
+  fprintf(stderr, "  -n <bt>  (default: %.1f)\n", DEFAULT_BT);
+  fprintf(stderr, "  -s <sample rate>  (default: %u * bit rate)\n",
+          DEFAULT_SAMPLES_PER_BIT);
+  fprintf(stderr, "\n");
+  fprintf(stderr, "The options -b, -e and -n can be repeated to measure\n");
+  fprintf(stderr, "several values.\n");
+}
+
+double get_cpu_time()
+{
+  struct timespec t;
+
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &t);
+  return(t.tv_sec + (t.tv_nsec / 1000000000.0));
+}
+
+/* The payload of a frame is made of its index followed by bytes depending
+ * on the index, so the receiver can check what it gets */
+void make_payload(unsigned int index,
+                  unsigned char *payload,
+                  unsigned int payload_size)
+{
+  unsigned int state = index * 2654435761U;
+  unsigned int i;
+
+  payload[0] = (index >> 24) & 255;
+  payload[1] = (index >> 16) & 255;
+  payload[2] = (index >> 8) & 255;
+  payload[3] = index & 255;
+  for(i = 4; i < payload_size; i++)
+  {
+    state = (state * 1103515245U) + 12345U;
+    payload[i] = state >> 24;
+  }
+}
+
+int read_data(void *context, unsigned char *payload, unsigned int payload_size)
+{
+  tx_context_t *tx = (tx_context_t *) context;
+
+  if(tx->index == tx->frames)
+  {
+    return(-1);
+  }
+  make_payload(tx->index, payload, payload_size);
+  tx->index++;
+
+  return(payload_size);
+}
+
+int write_data(void *context, unsigned char *payload, unsigned int payload_size)
+{
+  rx_context_t *rx = (rx_context_t *) context;
+  unsigned char expected[payload_size];
+  unsigned int index;
+  long long int time;
+
+  if(payload_size < 4)
+  {
+    return(payload_size);
+  }
+  index = (payload[0] << 24) | (payload[1] << 16) | (payload[2] << 8) |
+    payload[3];
+  if(index >= rx->frames)
+  {
+    return(payload_size);
+  }
+  make_payload(index, expected, payload_size);
+  if(memcmp(payload, expected, payload_size) != 0)
+  {
+    return(payload_size);
+  }
+
+  time = gmsk_transfer_get_frame_time(rx->transfer);
+  if(time >= 0)
+  {
+    if(rx->first_time < 0)
+    {
+      rx->first_index = index;
+      rx->first_time = time;
+    }
+    rx->last_index = index;
+    rx->last_time = time;
+  }
+  rx->frames_received++;
+  rx->bytes_received += payload_size;
+
+  return(payload_size);
+}
+
+void * reception_thread(void *arg)
+{
+  rx_context_t *rx = (rx_context_t *) arg;
+  double start = get_cpu_time();
+
+  gmsk_transfer_start(rx->transfer);
+  rx->cpu_time = get_cpu_time() - start;
+
+  return(NULL);
+}
+
+void measure_point(sweep_t *sweep, point_t *point)
+{
+  unsigned long int sample_rate = sweep->sample_rate;
+  unsigned int maximum_deviation = 0;
+  float snr;
+  char radio[128];
+  char inner_fec[32];
+  char outer_fec[32];
+  char *separation;
+  gmsk_transfer_t send;
+  gmsk_transfer_t receive;
+  pthread_t thread;
+  tx_context_t tx;
+  rx_context_t rx;
+  double start;
+  double period;
+
+  if(sample_rate == 0)
+  {
+    sample_rate = point->bit_rate * DEFAULT_SAMPLES_PER_BIT;
+  }
+  /* The noise is spread over the whole band of the samples */
+  snr = point->ebn0 - (10 * log10f((float) sample_rate / point->bit_rate));
+  snprintf(radio,
+           sizeof(radio),
+           "sim=snr=%.2f,cfo=%.1f,seed=%u",
+           snr,
+           sweep->cfo,
+           (unsigned int) (point - sweep->points) + 1);
+  if(fabsf(sweep->cfo) * 2 > point->bit_rate / 100.0)
+  {
+    maximum_deviation = ceilf(fabsf(sweep->cfo) * 2);
+  }
+  strncpy(inner_fec, point->fec, sizeof(inner_fec) - 1);
+  inner_fec[sizeof(inner_fec) - 1] = '\0';
+  strcpy(outer_fec, "none");
+  if((separation = strchr(inner_fec, ',')) != NULL)
+  {
+    *separation = '\0';
+    strcpy(outer_fec, separation + 1);
+  }
+
+  bzero(&tx, sizeof(tx));
+  tx.frames = sweep->frames;
+  bzero(&rx, sizeof(rx));
+  rx.frames = sweep->frames;
+  rx.first_time = -1;
+  rx.last_time = -1;
+
+  receive = gmsk_transfer_create_callback(radio,
+                                          0,
+                                          write_data,
+                                          &rx,
+                                          sample_rate,
+                                          point->bit_rate,
+                                          FREQUENCY,
+                                          0,
+                                          maximum_deviation,
+                                          "0",
+                                          0,
+                                          point->bt,
+                                          inner_fec,
+                                          outer_fec,
+                                          "",
+                                          NULL,
+                                          0,
+                                          0);
+  if(receive == NULL)
+  {
+    point->failed = 1;
+    return;
+  }
+  send = gmsk_transfer_create_shared_callback(receive,
+                                              1,
+                                              read_data,
+                                              &tx,
+                                              FREQUENCY,
+                                              0,
+                                              "0",
+                                              0);
+  if(send == NULL)
+  {
+    gmsk_transfer_free(receive);
+    point->failed = 1;
+    return;
+  }
+  rx.transfer = receive;
+
+  if(pthread_create(&thread, NULL, reception_thread, &rx) != 0)
+  {
+    fprintf(stderr, "Error: Failed to start reception thread\n");
+    exit(EXIT_FAILURE);
+  }
+  start = get_cpu_time();
+  gmsk_transfer_start(send);
+  point->cpu_time = get_cpu_time() - start;
+  pthread_join(thread, NULL);
+  gmsk_transfer_free(send);
+  gmsk_transfer_free(receive);
+
+  point->cpu_time += rx.cpu_time;
+  point->frames_received = rx.frames_received;
+  point->bytes_received = rx.bytes_received;
+  /* The frames are sent one after the other, so the time between two
+   * received frames gives the time taken by each frame on the channel */
+  if(rx.last_index > rx.first_index)
+  {
+    period = (rx.last_time - rx.first_time) /
+      ((rx.last_index - rx.first_index) * 1000000000.0);
+    point->throughput = (rx.bytes_received * 8) / (sweep->frames * period);
+  }
+}
+
+void * worker_thread(void *arg)
+{
+  sweep_t *sweep = (sweep_t *) arg;
+  unsigned int i;
+
+  while((i = atomic_fetch_add(&sweep->next_point, 1)) < sweep->points_count)
+  {
+    measure_point(sweep, &sweep->points[i]);
+  }
+
+  return(NULL);
+}
+
+void write_results(sweep_t *sweep, FILE *output)
+{
+  point_t *point;
+  unsigned long int sample_rate;
+  unsigned int i;
+
+  fprintf(output,
+          "bit_rate,bt,fec,ebn0_db,snr_db,cfo_hz,"
+          "frames_sent,frames_received,per,throughput_bps,cpu_s\n");
+  for(i = 0; i < sweep->points_count; i++)
+  {
+    point = &sweep->points[i];
+    if(point->failed)
+    {
+      continue;
+    }
+    sample_rate = sweep->sample_rate ?
+      sweep->sample_rate :
+      point->bit_rate * DEFAULT_SAMPLES_PER_BIT;
+    fprintf(output,
+            "%u,%.2f,\"%s\",%.2f,%.2f,%.1f,%u,%u,%.6f,%.1f,%.3f\n",
+            point->bit_rate,
+            point->bt,
+            point->fec,
+            point->ebn0,
+            point->ebn0 - (10 * log10f((float) sample_rate / point->bit_rate)),
+            sweep->cfo,
+            sweep->frames,
+            point->frames_received,
+            1 - ((double) point->frames_received / sweep->frames),
+            point->throughput,
+            point->cpu_time);
+  }
+}
+
+int main(int argc, char **argv)
+{
+  sweep_t sweep;
+  unsigned int bit_rates[MAXIMUM_VALUES];
+  unsigned int bit_rates_count = 0;
+  float bts[MAXIMUM_VALUES];
+  unsigned int bts_count = 0;
+  char *fecs[MAXIMUM_VALUES];
+  unsigned int fecs_count = 0;
+  float ebn0_min = 0;
+  float ebn0_max = 12;
+  float ebn0_step = 1;
+  unsigned int ebn0_count;
+  long int jobs = sysconf(_SC_NPROCESSORS_ONLN) / 2;
+  pthread_t *workers;
+  FILE *output = stdout;
+  unsigned int i;
+  unsigned int b;
+  unsigned int t;
+  unsigned int e;
+  unsigned int s;
+  int status = EXIT_SUCCESS;
+  int opt;
+
+  bzero(&sweep, sizeof(sweep));
+  sweep.frames = DEFAULT_FRAMES;
+
+  while((opt = getopt(argc, argv, "b:c:E:e:f:hj:n:s:")) != -1)
+  {
+    switch(opt)
+    {
+    case 'b':
+      if(bit_rates_count < MAXIMUM_VALUES)
+      {
+        bit_rates[bit_rates_count++] = strtoul(optarg, NULL, 10);
+      }
+      break;
+
+    case 'c':
+      sweep.cfo = strtof(optarg, NULL);
+      break;
+
+    case 'E':
+      if(sscanf(optarg, "%f:%f:%f", &ebn0_min, &ebn0_max, &ebn0_step) != 3)
+      {
+        fprintf(stderr, "Error: Invalid range of Eb/N0 values\n");
+        return(EXIT_FAILURE);
+      }
+      break;
+
+    case 'e':
+      if(fecs_count < MAXIMUM_VALUES)
+      {
+        fecs[fecs_count++] = optarg;
+      }
+      break;
+
+    case 'f':
+      sweep.frames = strtoul(optarg, NULL, 10);
+      break;
+
+    case 'h':
+      usage();
+      return(EXIT_SUCCESS);
+
+    case 'j':
+      jobs = strtol(optarg, NULL, 10);
+      break;
+
+    case 'n':
+      if(bts_count < MAXIMUM_VALUES)
+      {
+        bts[bts_count++] = strtof(optarg, NULL);
+      }
+      break;
+
+    case 's':
+      sweep.sample_rate = strtoul(optarg, NULL, 10);
+      break;
+
+    default:
+      usage();
+      return(EXIT_FAILURE);
+    }
+  }
+  if(optind < argc)
+  {
+    output = fopen(argv[optind], "w");
+    if(output == NULL)
+    {
+      fprintf(stderr, "Error: Failed to open '%s'\n", argv[optind]);
+      return(EXIT_FAILURE);
+    }
+  }
+  if((ebn0_step <= 0) || (ebn0_max < ebn0_min) || (sweep.frames == 0))
+  {
+    usage();
+    return(EXIT_FAILURE);
+  }
+  if(bit_rates_count == 0)
+  {
+    bit_rates[bit_rates_count++] = DEFAULT_BIT_RATE;
+  }
+  if(bts_count == 0)
+  {
+    bts[bts_count++] = DEFAULT_BT;
+  }
+  if(fecs_count == 0)
+  {
+    fecs[fecs_count++] = DEFAULT_FEC;
+  }
+  if(jobs < 1)
+  {
+    jobs = 1;
+  }
+
+  /* Each combination of the parameters is a point of the sweep */
+  ebn0_count = floorf(((ebn0_max - ebn0_min) / ebn0_step) + 0.001) + 1;
+  sweep.points_count = bit_rates_count * bts_count * fecs_count * ebn0_count;
+  sweep.points = calloc(sweep.points_count, sizeof(point_t));
+  workers = calloc(jobs, sizeof(pthread_t));
+  if((sweep.points == NULL) || (workers == NULL))
+  {
+    fprintf(stderr, "Error: Memory allocation failed\n");
+    return(EXIT_FAILURE);
+  }
+  i = 0;
+  for(b = 0; b < bit_rates_count; b++)
+  {
+    for(t = 0; t < bts_count; t++)
+    {
+      for(e = 0; e < fecs_count; e++)
+      {
+        for(s = 0; s < ebn0_count; s++)
+        {
+          sweep.points[i].bit_rate = bit_rates[b];
+          sweep.points[i].bt = bts[t];
+          sweep.points[i].fec = fecs[e];
+          sweep.points[i].ebn0 = ebn0_min + (s * ebn0_step);
+          i++;
+        }
+      }
+    }
+  }
+  atomic_init(&sweep.next_point, 0);
+
+  /* Each point uses a thread for the transmitter and another for the
+   * receiver */
+  for(i = 0; i < jobs; i++)
+  {
+    if(pthread_create(&workers[i], NULL, worker_thread, &sweep) != 0)
+    {
+      fprintf(stderr, "Error: Failed to start worker thread\n");
+      return(EXIT_FAILURE);
+    }
+  }
+  for(i = 0; i < jobs; i++)
+  {
+    pthread_join(workers[i], NULL);
+  }
+
+  write_results(&sweep, output);
+  if(output != stdout)
+  {
+    fclose(output);
+  }
+  for(i = 0; i < sweep.points_count; i++)
+  {
+    if(sweep.points[i].failed)
+    {
+      fprintf(stderr,
+              "Error: Failed to measure bit rate %u, BT %.2f, FEC %s\n",
+              sweep.points[i].bit_rate,
+              sweep.points[i].bt,
+              sweep.points[i].fec);
+      status = EXIT_FAILURE;
+    }
+  }
+  free(workers);
+  free(sweep.points);
+
+  return(status);
+}
@@ -0,0 +1,177 @@
+/*
+This file is part of gmsk-transfer, a program to send or receive data
+by software defined radio using the GMSK modulation.
+
+Copyright 2021-2022 Guillaume LE VAILLANT
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <complex.h>
+#include <liquid/liquid.h>
+#include <math.h>
+#include <stdlib.h>
+#include "audiomodem.h"
+
+#define TAU (2 * M_PI)
+
+/* Semi-length of the low-pass filter of the demodulator (in baseband
+ * samples) */
+#define AUDIODEMOD_FILTER_LENGTH 4
+/* Number of baseband samples computed at the same time by the
+ * demodulator */
+#define AUDIODEMOD_BLOCK_SIZE 64
+
+struct audiomod_s
+{
+  nco_crcf oscillator;
+};
+
+struct audiodemod_s
+{
+  nco_crcf oscillator;
+  firdecim_crcf decimator;
+  unsigned int decimation;
+  unsigned int delay;
+  complex float *mixed;
+};
+
+audiomod_t audiomod_create(float frequency)
+{
+  audiomod_t modulator = malloc(sizeof(struct audiomod_s));
+
+  if(modulator == NULL)
+  {
+    return(NULL);
+  }
+  modulator->oscillator = nco_crcf_create(LIQUID_NCO);
+  nco_crcf_set_phase(modulator->oscillator, 0);
+  nco_crcf_set_frequency(modulator->oscillator, TAU * frequency);
+
+  return(modulator);
+}
+
+void audiomod_free(audiomod_t modulator)
+{
+  if(modulator)
+  {
+    nco_crcf_destroy(modulator->oscillator);
+    free(modulator);
+  }
+}
+
+void audiomod_execute(audiomod_t modulator,
+                      complex float *samples,
+                      unsigned int samples_size,
+                      float *audio)
+{
+  unsigned int i;
+  complex float carrier;
+
+  /* Only the real part of the product with the carrier is needed:
+   * 2 multiplications instead of 4 */
+  for(i = 0; i < samples_size; i++)
+  {
+    nco_crcf_cexpf(modulator->oscillator, &carrier);
+    nco_crcf_step(modulator->oscillator);
+    audio[i] = (crealf(samples[i]) * crealf(carrier)) -
+      (cimagf(samples[i]) * cimagf(carrier));
+  }
+}
+
+audiodemod_t audiodemod_create(float frequency, unsigned int decimation)
+{
+  audiodemod_t demodulator;
+
+  if(decimation == 0)
+  {
+    return(NULL);
+  }
+
+  demodulator = malloc(sizeof(struct audiodemod_s));
+  if(demodulator == NULL)
+  {
+    return(NULL);
+  }
+  demodulator->mixed = malloc(AUDIODEMOD_BLOCK_SIZE * decimation *
+                              sizeof(complex float));
+  if(demodulator->mixed == NULL)
+  {
+    free(demodulator);
+    return(NULL);
+  }
+  demodulator->decimation = decimation;
+  demodulator->oscillator = nco_crcf_create(LIQUID_NCO);
+  nco_crcf_set_phase(demodulator->oscillator, 0);
+  nco_crcf_set_frequency(demodulator->oscillator, TAU * frequency);
+  /* The filter removes the image of the signal at twice the carrier
+   * frequency and the noise outside of the band of the baseband samples,
+   * and it is only computed for the samples kept after the decimation */
+  demodulator->decimator = firdecim_crcf_create_kaiser(decimation,
+                                                       AUDIODEMOD_FILTER_LENGTH,
+                                                       60);
+  demodulator->delay = AUDIODEMOD_FILTER_LENGTH;
+
+  return(demodulator);
+}
+
+void audiodemod_free(audiodemod_t demodulator)
+{
+  if(demodulator)
+  {
+    firdecim_crcf_destroy(demodulator->decimator);
+    nco_crcf_destroy(demodulator->oscillator);
+    free(demodulator->mixed);
+    free(demodulator);
+  }
+}
+
+unsigned int audiodemod_get_delay(audiodemod_t demodulator)
+{
+  return(demodulator->delay);
+}
+
+void audiodemod_execute(audiodemod_t demodulator,
+                        float *audio,
+                        unsigned int samples_size,
+                        complex float *samples)
+{
+  unsigned int i;
+  unsigned int n;
+  unsigned int size;
+  complex float carrier;
+
+  while(samples_size > 0)
+  {
+    n = (samples_size < AUDIODEMOD_BLOCK_SIZE) ?
+      samples_size : AUDIODEMOD_BLOCK_SIZE;
+    size = n * demodulator->decimation;
+    /* The input is real: 2 multiplications instead of 4. The factor 2
+     * compensates the power lost in the image. */
+    for(i = 0; i < size; i++)
+    {
+      nco_crcf_cexpf(demodulator->oscillator, &carrier);
+      nco_crcf_step(demodulator->oscillator);
+      demodulator->mixed[i] = 2 * audio[i] * conjf(carrier);
+    }
+    firdecim_crcf_execute_block(demodulator->decimator,
+                                demodulator->mixed,
+                                n,
+                                samples);
+    audio += size;
+    samples += n;
+    samples_size -= n;
+  }
+}
@@ -0,0 +1,83 @@
+/*
+This file is part of gmsk-transfer, a program to send or receive data
+by software defined radio using the GMSK modulation.
+
+Copyright 2021-2022 Guillaume LE VAILLANT
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef AUDIOMODEM_H
+#define AUDIOMODEM_H
+
+#include <complex.h>
+
+/* Conversion between the complex baseband samples of the frame generator
+ * and frame synchronizer and the real samples of a sound card, working
+ * directly at the audio sample rate. The audio carrier is produced and
+ * removed by mixing the real samples with an oscillator, which avoids the
+ * Hilbert transform, the complex resampler and the complex mixer of the
+ * IQ pipeline when the audio sample rate is a multiple of the symbol
+ * rate. */
+typedef struct audiomod_s *audiomod_t;
+typedef struct audiodemod_s *audiodemod_t;
+
+/* Create a new modulator
+ *  - frequency: frequency of the audio carrier divided by the audio sample
+ *    rate
+ *
+ * If the allocation fails, the function returns NULL.
+ */
+audiomod_t audiomod_create(float frequency);
+
+/* Cleanup a modulator */
+void audiomod_free(audiomod_t modulator);
+
+/* Shift baseband samples to the audio carrier and keep their real part
+ *  - samples: baseband samples, at the audio sample rate
+ *  - samples_size: number of samples
+ *  - audio: output buffer for 'samples_size' audio samples
+ */
+void audiomod_execute(audiomod_t modulator,
+                      complex float *samples,
+                      unsigned int samples_size,
+                      float *audio);
+
+/* Create a new demodulator
+ *  - frequency: frequency of the audio carrier divided by the audio sample
+ *    rate
+ *  - decimation: number of audio samples for one baseband sample
+ *
+ * If the allocation fails, the function returns NULL.
+ */
+audiodemod_t audiodemod_create(float frequency, unsigned int decimation);
+
+/* Cleanup a demodulator */
+void audiodemod_free(audiodemod_t demodulator);
+
+/* Get the delay of the low-pass filter (in baseband samples) */
+unsigned int audiodemod_get_delay(audiodemod_t demodulator);
+
+/* Shift audio samples from the audio carrier to baseband and decimate them
+ *  - audio: input buffer of 'samples_size' * decimation audio samples
+ *  - samples_size: number of baseband samples to produce
+ *  - samples: output buffer for 'samples_size' baseband samples
+ */
+void audiodemod_execute(audiodemod_t demodulator,
+                        float *audio,
+                        unsigned int samples_size,
+                        complex float *samples);
+
+#endif
@@ -0,0 +1,184 @@
+/*
+This file is part of gmsk-transfer, a program to send or receive data
+by software defined radio using the GMSK modulation.
+
+Copyright 2021-2022 Guillaume LE VAILLANT
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <math.h>
+#include "convert.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+void convert_float_to_s16(const float *input,
+                          short int *output,
+                          unsigned int size,
+                          float gain)
+{
+  unsigned int i = 0;
+  float scale = gain * 32767;
+  float x;
+
+#ifdef __SSE2__
+  __m128 s = _mm_set1_ps(scale);
+  __m128 high = _mm_set1_ps(32767);
+  __m128 low = _mm_set1_ps(-32768);
+  __m128 a;
+  __m128 b;
+
+  /* Clip in float, then convert to 32-bit integers and pack them to 16-bit
+   * integers */
+  for(; i + 8 <= size; i += 8)
+  {
+    a = _mm_mul_ps(_mm_loadu_ps(&input[i]), s);
+    b = _mm_mul_ps(_mm_loadu_ps(&input[i + 4]), s);
+    a = _mm_max_ps(_mm_min_ps(a, high), low);
+    b = _mm_max_ps(_mm_min_ps(b, high), low);
+    _mm_storeu_si128((__m128i *) &output[i],
+                     _mm_packs_epi32(_mm_cvtps_epi32(a), _mm_cvtps_epi32(b)));
+  }
+#endif
+
+  /* Simple enough for the compiler to vectorize it on other architectures */
+  for(; i < size; i++)
+  {
+    x = input[i] * scale;
+    x = (x > 32767) ? 32767 : x;
+    x = (x < -32768) ? -32768 : x;
+    output[i] = lrintf(x);
+  }
+}
+
+void convert_s16_to_float(const short int *input,
+                          float *output,
+                          unsigned int size,
+                          float gain)
+{
+  unsigned int i = 0;
+  float scale = gain / 32768;
+
+#ifdef __SSE2__
+  __m128 s = _mm_set1_ps(scale);
+  __m128i x;
+  __m128i sign;
+
+  for(; i + 8 <= size; i += 8)
+  {
+    x = _mm_loadu_si128((const __m128i *) &input[i]);
+    sign = _mm_srai_epi16(x, 15);
+    _mm_storeu_ps(&output[i],
+                  _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(x, sign)), s));
+    _mm_storeu_ps(&output[i + 4],
+                  _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(x, sign)), s));
+  }
+#endif
+
+  for(; i < size; i++)
+  {
+    output[i] = input[i] * scale;
+  }
+}
+
+void convert_float_to_s8(const float *input,
+                         signed char *output,
+                         unsigned int size,
+                         float gain)
+{
+  unsigned int i = 0;
+  float scale = gain * 127;
+  float x;
+
+#ifdef __SSE2__
+  __m128 s = _mm_set1_ps(scale);
+  __m128 high = _mm_set1_ps(127);
+  __m128 low = _mm_set1_ps(-128);
+  __m128 a;
+  __m128 b;
+  __m128 c;
+  __m128 d;
+
+  /* Clip in float, then convert to 32-bit integers and pack them to 16-bit
+   * integers and to 8-bit integers */
+  for(; i + 16 <= size; i += 16)
+  {
+    a = _mm_mul_ps(_mm_loadu_ps(&input[i]), s);
+    b = _mm_mul_ps(_mm_loadu_ps(&input[i + 4]), s);
+    c = _mm_mul_ps(_mm_loadu_ps(&input[i + 8]), s);
+    d = _mm_mul_ps(_mm_loadu_ps(&input[i + 12]), s);
+    a = _mm_max_ps(_mm_min_ps(a, high), low);
+    b = _mm_max_ps(_mm_min_ps(b, high), low);
+    c = _mm_max_ps(_mm_min_ps(c, high), low);
+    d = _mm_max_ps(_mm_min_ps(d, high), low);
+    _mm_storeu_si128((__m128i *) &output[i],
+                     _mm_packs_epi16(_mm_packs_epi32(_mm_cvtps_epi32(a),
+                                                     _mm_cvtps_epi32(b)),
+                                     _mm_packs_epi32(_mm_cvtps_epi32(c),
+                                                     _mm_cvtps_epi32(d))));
+  }
+#endif
+
+  for(; i < size; i++)
+  {
+    x = input[i] * scale;
+    x = (x > 127) ? 127 : x;
+    x = (x < -128) ? -128 : x;
+    output[i] = lrintf(x);
+  }
+}
+
+void convert_s8_to_float(const signed char *input,
+                         float *output,
+                         unsigned int size,
+                         float gain)
+{
+  unsigned int i = 0;
+  float scale = gain / 128;
+
+#ifdef __SSE2__
+  __m128 s = _mm_set1_ps(scale);
+  __m128i zero = _mm_setzero_si128();
+  __m128i x;
+  __m128i x_sign;
+  __m128i y;
+  __m128i sign;
+
+  /* Extend the sign to 16-bit integers, then to 32-bit integers */
+  for(; i + 16 <= size; i += 16)
+  {
+    x = _mm_loadu_si128((const __m128i *) &input[i]);
+    x_sign = _mm_cmpgt_epi8(zero, x);
+    y = _mm_unpacklo_epi8(x, x_sign);
+    sign = _mm_srai_epi16(y, 15);
+    _mm_storeu_ps(&output[i],
+                  _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(y, sign)), s));
+    _mm_storeu_ps(&output[i + 4],
+                  _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(y, sign)), s));
+    y = _mm_unpackhi_epi8(x, x_sign);
+    sign = _mm_srai_epi16(y, 15);
+    _mm_storeu_ps(&output[i + 8],
+                  _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(y, sign)), s));
+    _mm_storeu_ps(&output[i + 12],
+                  _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(y, sign)), s));
+  }
+#endif
+
+  for(; i < size; i++)
+  {
+    output[i] = input[i] * scale;
+  }
+}
@@ -0,0 +1,72 @@
+/*
+This file is part of gmsk-transfer, a program to send or receive data
+by software defined radio using the GMSK modulation.
+
+Copyright 2021-2022 Guillaume LE VAILLANT
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CONVERT_H
+#define CONVERT_H
+
+/* Convert float samples to signed 16-bit samples
+ *  - input: float samples, full scale is [-1, 1]
+ *  - output: signed 16-bit samples
+ *  - size: number of samples
+ *  - gain: factor applied to the input samples
+ *
+ * The samples outside of the full scale are clipped.
+ */
+void convert_float_to_s16(const float *input,
+                          short int *output,
+                          unsigned int size,
+                          float gain);
+
+/* Convert signed 16-bit samples to float samples
+ *  - input: signed 16-bit samples
+ *  - output: float samples, full scale is [-1, 1]
+ *  - size: number of samples
+ *  - gain: factor applied to the output samples
+ */
+void convert_s16_to_float(const short int *input,
+                          float *output,
+                          unsigned int size,
+                          float gain);
+
+/* Convert float samples to signed 8-bit samples
+ *  - input: float samples, full scale is [-1, 1]
+ *  - output: signed 8-bit samples
+ *  - size: number of samples
+ *  - gain: factor applied to the input samples
+ *
+ * The samples outside of the full scale are clipped.
+ */
+void convert_float_to_s8(const float *input,
+                         signed char *output,
+                         unsigned int size,
+                         float gain);
+
+/* Convert signed 8-bit samples to float samples
+ *  - input: signed 8-bit samples
+ *  - output: float samples, full scale is [-1, 1]
+ *  - size: number of samples
+ *  - gain: factor applied to the output samples
+ */
+void convert_s8_to_float(const signed char *input,
+                         float *output,
+                         unsigned int size,
+                         float gain);
+
+#endif
@@ -20,22 +20,88 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <complex.h>
 #include <fcntl.h>
+#include <limits.h>
 #include <liquid/liquid.h>
 #include <math.h>
+#include <poll.h>
+#include <pthread.h>
 #include <SoapySDR/Device.h>
 #include <SoapySDR/Formats.h>
+#include <stdatomic.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <strings.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <time.h>
 #include <unistd.h>
+#include "audiomodem.h"
+#include "convert.h"
 #include "gettext.h"
 #include "gmsk-transfer.h"
+#include "gmskburstgen.h"
 #include "gmskframesync.h"
+#include "metrics.h"
+#include "profiler.h"
+#include "ringbuffer.h"
+#include "simulator.h"
+#include "squelch.h"
 
 #define TAU (2 * M_PI)
 
+/* Maximum payload size of a frame */
+#define MAXIMUM_PAYLOAD_SIZE 8000
+
+/* Maximum size of the user header of a frame, and size of the counter at
+ * the end of this header */
+#define MAXIMUM_HEADER_SIZE 8
+#define COUNTER_SIZE 4
+
+/* Parameters of the squelch: durations of a power measurement and of the
+ * history in bits */
+#define SQUELCH_WINDOW_BITS 32
+#define SQUELCH_HISTORY_BITS 128
+
+/* Parameters of the parallel decoding of recordings: minimal duration of a
+ * chunk in seconds and in number of overlaps, margin added to the length of
+ * the longest frame in the overlap and tolerance on the position of the end
+ * of a frame in bits */
+#define OFFLINE_CHUNK_DURATION 10
+#define OFFLINE_CHUNK_OVERLAPS 8
+#define OFFLINE_MARGIN_BITS 1024
+#define OFFLINE_TOLERANCE_BITS 64
+
+/* The pages of a mapped recording are released by steps of 64 MiB after
+ * being processed, and the space of a generated recording is reserved by
+ * steps of 64 MiB */
+#define FILE_RELEASE_SIZE (64 * 1024 * 1024)
+#define FILE_PREALLOCATION_SIZE (64 * 1024 * 1024)
+
+/* Number of audio samples converted and written or read at the same time */
+#define AUDIO_BLOCK_SIZE 1024
+
+/* When there is no data to send, the radio is fed with blocks of 10 ms of
+ * silence, sent when less than 5 ms of samples remain to be sent */
+#define IDLE_SILENCE_DURATION 10
+#define IDLE_MARGIN_DURATION 5
+
+/* Margin added to the estimated end of a burst for the latency of the
+ * radio, in ms */
+#define END_OF_BURST_MARGIN 5
+
+/* The latency of the transmitted data is measured with a resolution of
+ * 1 ms up to 10 s */
+#define LATENCY_HISTOGRAM_SIZE 10000
+
+/* Number of IQ samples converted to or from the sample format of the radio
+ * and written or read at the same time */
+#define FORMAT_BLOCK_SIZE 1024
+
+/* The 'loopback' pseudo-radio can hold 100 ms of samples sent by the
+ * transmitter and not yet read by the receiver */
+#define LOOPBACK_DURATION 100
+
 #define MIN(x, y) ((x < y) ? x : y)
 #define MAX(x, y) ((x > y) ? x : y)
 
@@ -55,13 +121,73 @@ typedef enum
   {
     IO,
     FILENAME,
-    SOAPYSDR
+    SOAPYSDR,
+    LOOPBACK
   } radio_type_t;
 
+typedef enum
+  {
+    FORMAT_CF32,
+    FORMAT_CS16,
+    FORMAT_CS8
+  } sample_format_t;
+
+/* Stages of the transmit and receive loops whose duration is measured when
+ * profiling is enabled */
+typedef enum
+  {
+    STAGE_RADIO,
+    STAGE_DATA,
+    STAGE_ASSEMBLY,
+    STAGE_MODULATOR,
+    STAGE_OSCILLATOR,
+    STAGE_SQUELCH,
+    STAGE_RESAMPLER,
+    STAGE_SYNCHRONIZER,
+    STAGES_SIZE
+  } stage_t;
+
+const char *stage_names[STAGES_SIZE] =
+  {
+    "radio",
+    "data",
+    "assembly",
+    "modulator",
+    "oscillator",
+    "squelch",
+    "resampler",
+    "synchronizer"
+  };
+
+/* Statistics of a transfer, updated without locks by the threads of the
+ * transfer. The sums of the signal measures are only updated by the thread
+ * delivering the frames. */
+typedef struct
+{
+  atomic_ulong frames_received;
+  atomic_ulong frames_corrupted_header;
+  atomic_ulong frames_corrupted_payload;
+  atomic_ulong frames_ignored;
+  atomic_ullong bytes_received;
+  atomic_ulong frames_sent;
+  atomic_ullong bytes_sent;
+  atomic_ulong overflows;
+  atomic_ulong underflows;
+  atomic_ulong timeouts;
+  atomic_ulong measured_frames;
+  _Atomic float rssi;
+  _Atomic float evm;
+  _Atomic float cfo;
+  _Atomic double rssi_sum;
+  _Atomic double evm_sum;
+  _Atomic double cfo_sum;
+} transfer_stats_t;
+
 typedef union
 {
   FILE *file;
   SoapySDRDevice *soapysdr;
+  ringbuffer_t loopback;
 } radio_device_t;
 
 typedef union
@@ -74,12 +200,19 @@ struct gmsk_transfer_s
   radio_type_t radio_type;
   radio_device_t radio_device;
   radio_stream_t radio_stream;
+  /* Channel of the radio used by the stream, and number of transfers using
+   * the radio when it is shared by a transmitter and a receiver */
+  size_t radio_channel;
+  atomic_uint *radio_users;
+  /* Impairments applied by a 'loopback' pseudo-radio to the samples sent */
+  simulator_t simulator;
   unsigned char emit;
   FILE *file;
   unsigned long int sample_rate;
   unsigned int bit_rate;
   unsigned long int frequency;
   long int frequency_offset;
+  float ppm;
   unsigned int maximum_deviation;
   float bt;
   crc_scheme crc;
@@ -94,6 +227,102 @@ struct gmsk_transfer_s
   time_t timeout_start;
   firhilbf audio_converter;
   float audio_gain;
+  /* Parameters of the direct audio engine, before their conversion for the
+   * IQ pipeline */
+  unsigned long int audio_sample_rate;
+  unsigned long int audio_frequency;
+  unsigned int ring_size;
+  ringbuffer_t payloads_ring;
+  unsigned int channels;
+  int (*channel_callback)(void *, unsigned int, unsigned char *, unsigned int);
+  float squelch_threshold;
+  squelch_t squelch;
+  unsigned int jobs;
+  /* With a 'file' radio, a regular file is mapped in memory when receiving
+   * and written directly at 'file_position' when transmitting */
+  unsigned char *file_map;
+  size_t file_size;
+  size_t file_position;
+  size_t file_released;
+  unsigned char file_direct;
+  /* Format of the IQ samples exchanged with the radio, and buffer used to
+   * convert them for SoapySDR */
+  sample_format_t sample_format;
+  unsigned int sample_bytes;
+  unsigned char *stream_buffer;
+  unsigned int stream_buffer_size;
+  /* Buffers of the driver acquired with the direct access API of SoapySDR,
+   * when it is supported */
+  unsigned char direct_access;
+  size_t read_handle;
+  unsigned char read_acquired;
+  const unsigned char *read_buffer;
+  unsigned int read_available;
+  size_t write_handle;
+  unsigned char write_acquired;
+  unsigned char *write_buffer;
+  unsigned int write_capacity;
+  /* Monotonic time (in microseconds) at which the radio will have sent all
+   * the samples written to it */
+  atomic_llong radio_time;
+  /* Number of samples written to the stream of the radio since the start
+   * of the current burst */
+  unsigned long int burst_samples;
+  /* In transmit mode, time (in ns) at which the transmission must start,
+   * either on the clock of the radio or relative to the start of the
+   * transfer, then time on the clock of the radio and whether the first
+   * samples have been written */
+  long long int start_time;
+  unsigned char start_time_relative;
+  long long int scheduled_time;
+  unsigned char start_time_pending;
+  /* In receive mode, time of the clock of the radio (in ns, -1 if unknown)
+   * of the first sample of the last block read, index of this sample for
+   * the frame synchronizer, and time of the frame being delivered */
+  long long int block_time;
+  unsigned long long int block_start;
+  long long int frame_time;
+  unsigned long int samples_read;
+  long long int read_time;
+  unsigned int read_offset;
+  /* In transmit mode, data waiting for more data to fill a frame, and time
+   * at which the first byte of the payload of the next frame was read */
+  unsigned int coalescing_delay;
+  unsigned char *pending;
+  unsigned int pending_size;
+  long long int payload_time;
+  unsigned long int latency_histogram[LATENCY_HISTOGRAM_SIZE];
+  unsigned long int latency_count;
+  /* Maximum number of frames sent behind the same preamble */
+  unsigned int aggregation;
+  /* Lengths of the preamble (in symbols), of the user header (in bytes) and
+   * of the ramps of the bursts (in symbols, -1 for the filter delay) */
+  unsigned int preamble_size;
+  unsigned int header_size;
+  int ramp_size;
+  /* Objects of the modulation or demodulation, created during the first run
+   * of the transfer and only reset during the next ones */
+  gmskburstgen frame_generator;
+  gmskframesync frame_synchronizer;
+  msresamp_crcf tx_resampler;
+  msresamp_crcf rx_resampler;
+  nco_crcf oscillator;
+  unsigned char stream_active;
+  /* In half-duplex mode, stream of the radio for the other direction, and
+   * time at which the previous run ended, to measure the turnaround when
+   * the direction changes */
+  radio_stream_t other_stream;
+  unsigned char direction_switched;
+  long long int end_time;
+  /* Time spent in the stages of the transmit and receive loops (NULL when
+   * profiling is disabled), and time spent in the data callback during the
+   * current call of the frame synchronizer */
+  profiler_t profiler;
+  long long int callback_duration;
+  /* Statistics since the creation of the transfer, and their export to
+   * a file */
+  transfer_stats_t stats;
+  metrics_t metrics;
 };
 
 unsigned char stop = 0;
@@ -109,1000 +338,5457 @@ unsigned char gmsk_transfer_is_verbose()
   return(verbose);
 }
 
-void dump_samples(gmsk_transfer_t transfer,
-                  complex float *samples,
-                  unsigned int samples_size)
+/* Convert IQ samples to the sample format of the radio
+ * 'data' must have room for 'samples_size' samples in this format. */
+void samples_to_format(gmsk_transfer_t transfer,
+                       const complex float *samples,
+                       unsigned int samples_size,
+                       void *data)
 {
-  fwrite(samples, sizeof(complex float), samples_size, transfer->dump);
-}
+  switch(transfer->sample_format)
+  {
+  case FORMAT_CS16:
+    convert_float_to_s16((const float *) samples, data, 2 * samples_size, 1);
+    break;
 
-int read_data(void *context,
-              unsigned char *payload,
-              unsigned int payload_size)
-{
-  gmsk_transfer_t transfer = (gmsk_transfer_t) context;
-  int n;
+  case FORMAT_CS8:
+    convert_float_to_s8((const float *) samples, data, 2 * samples_size, 1);
+    break;
 
-  if(feof(transfer->file))
-  {
-    return(-1);
+  default:
+    memcpy(data, samples, samples_size * sizeof(complex float));
+    break;
   }
+}
 
-  n = fread(payload, 1, payload_size, transfer->file);
-  if(n == 0)
+/* Convert IQ samples from the sample format of the radio */
+void samples_from_format(gmsk_transfer_t transfer,
+                         const void *data,
+                         unsigned int samples_size,
+                         complex float *samples)
+{
+  switch(transfer->sample_format)
   {
-    usleep(1);
-  }
+  case FORMAT_CS16:
+    convert_s16_to_float(data, (float *) samples, 2 * samples_size, 1);
+    break;
 
-  return(n);
+  case FORMAT_CS8:
+    convert_s8_to_float(data, (float *) samples, 2 * samples_size, 1);
+    break;
+
+  default:
+    memcpy(samples, data, samples_size * sizeof(complex float));
+    break;
+  }
 }
 
-int write_data(void *context,
-               unsigned char *payload,
-               unsigned int payload_size)
+void dump_samples(gmsk_transfer_t transfer,
+                  complex float *samples,
+                  unsigned int samples_size)
 {
-  gmsk_transfer_t transfer = (gmsk_transfer_t) context;
+  unsigned int n;
+  unsigned char data[FORMAT_BLOCK_SIZE * sizeof(complex float)];
 
-  fwrite(payload, 1, payload_size, transfer->file);
-  if(transfer->file == stdout)
+  if(transfer->sample_format == FORMAT_CF32)
   {
-    fflush(transfer->file);
+    fwrite(samples, sizeof(complex float), samples_size, transfer->dump);
+    return;
   }
 
-  return(payload_size);
+  while(samples_size > 0)
+  {
+    n = MIN(samples_size, FORMAT_BLOCK_SIZE);
+    samples_to_format(transfer, samples, n, data);
+    fwrite(data, transfer->sample_bytes, n, transfer->dump);
+    samples += n;
+    samples_size -= n;
+  }
 }
 
-void write_audio(gmsk_transfer_t transfer,
-                 complex float *samples,
-                 unsigned int samples_size,
-                 FILE *output)
+long long int get_time_us()
 {
-  float gain = transfer->audio_gain;
-  unsigned int n;
-  float audio_samples[2];
-  short int audio_samples_s16[2];
+  struct timespec t;
 
-  for(n = 0; n < samples_size; n++)
-  {
-    firhilbf_interp_execute(transfer->audio_converter,
-                            samples[n],
-                            audio_samples);
-    audio_samples_s16[0] = (audio_samples[0] * gain) * 32767;
-    audio_samples_s16[1] = (audio_samples[1] * gain) * 32767;
-    fwrite(audio_samples_s16, sizeof(short int), 2, output);
-  }
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return((t.tv_sec * 1000000LL) + (t.tv_nsec / 1000));
 }
 
-unsigned int read_audio(gmsk_transfer_t transfer,
-                        complex float *samples,
+/* Update the time at which the radio will have sent its samples after
+ * writing 'samples_size' more samples at 'sample_rate' */
+void advance_radio_time(gmsk_transfer_t transfer,
                         unsigned int samples_size,
-                        FILE* input)
+                        unsigned long int sample_rate)
 {
-  float gain = transfer->audio_gain;
-  unsigned int n = 0;
-  float audio_samples[2];
-  short int audio_samples_s16[2];
+  long long int now = get_time_us();
+  long long int radio_time = atomic_load(&transfer->radio_time);
 
-  while((n < samples_size) &&
-        (fread(audio_samples_s16, sizeof(short int), 2, input) == 2))
+  if(radio_time < now)
   {
-    audio_samples[0] = (audio_samples_s16[0] * gain) / 32768.0;
-    audio_samples[1] = (audio_samples_s16[1] * gain) / 32768.0;
-    firhilbf_decim_execute(transfer->audio_converter,
-                           audio_samples,
-                           &samples[n]);
-    n++;
+    radio_time = now;
   }
-  return(n);
+  radio_time += (samples_size * 1000000LL) / sample_rate;
+  atomic_store(&transfer->radio_time, radio_time);
 }
 
-void send_to_radio(gmsk_transfer_t transfer,
-                   complex float *samples,
-                   unsigned int samples_size,
-                   int last)
+int gmsk_transfer_get_idle_timeout(gmsk_transfer_t transfer)
 {
-  unsigned int n;
-  unsigned int size;
-  int flags = 0;
-  size_t mask = 0;
-  long long int timestamp = 0;
-  int r;
-  const void *buffers[1];
+  long long int now = get_time_us();
+  long long int remaining = atomic_load(&transfer->radio_time) - now;
+  long long int coalescing;
 
-  if(transfer->dump)
+  remaining = (remaining / 1000) - IDLE_MARGIN_DURATION;
+  if(transfer->pending_size > 0)
   {
-    dump_samples(transfer, samples, samples_size);
+    /* Don't wait for more data after the deadline of the pending data */
+    coalescing = transfer->payload_time +
+      (transfer->coalescing_delay * 1000LL) - now;
+    coalescing /= 1000;
+    remaining = MIN(remaining, coalescing);
   }
+  return((remaining > 0) ? remaining : 0);
+}
 
-  switch(transfer->radio_type)
+/* Get the payload of the next frame from the data callback
+ * With a coalescing delay, the data is accumulated in the transfer until the
+ * payload is full or the first byte has waited for the coalescing delay, and
+ * then it is copied to 'payload'. The pending data doesn't depend on the
+ * buffer given by the caller, which can change between two calls.
+ * Return the size of the payload, 0 if there is nothing to send yet, or -1
+ * at the end of the data. */
+int read_payload(gmsk_transfer_t transfer,
+                 unsigned char *payload,
+                 unsigned int payload_size)
+{
+  long long int now;
+  int r;
+
+  if(transfer->coalescing_delay == 0)
   {
-  case IO:
-    if(transfer->audio_converter)
-    {
-      write_audio(transfer, samples, samples_size, stdout);
-    }
-    else
+    r = transfer->data_callback(transfer->callback_context,
+                                payload,
+                                payload_size);
+    if(r > 0)
     {
-      fwrite(samples, sizeof(complex float), samples_size, stdout);
+      transfer->payload_time = get_time_us();
     }
-    break;
+    return(r);
+  }
 
-  case FILENAME:
-    if(transfer->audio_converter)
-    {
-      write_audio(transfer, samples, samples_size, transfer->radio_device.file);
-    }
-    else
+  r = transfer->data_callback(transfer->callback_context,
+                              &transfer->pending[transfer->pending_size],
+                              payload_size - transfer->pending_size);
+  now = get_time_us();
+  if(r > 0)
+  {
+    if(transfer->pending_size == 0)
     {
-      fwrite(samples,
-             sizeof(complex float),
-             samples_size,
-             transfer->radio_device.file);
+      transfer->payload_time = now;
     }
-    break;
+    transfer->pending_size += r;
+  }
+  if((transfer->pending_size > 0) &&
+     ((r < 0) ||
+      (transfer->pending_size == payload_size) ||
+      (now >= transfer->payload_time + (transfer->coalescing_delay * 1000LL))))
+  {
+    r = transfer->pending_size;
+    memcpy(payload, transfer->pending, r);
+    transfer->pending_size = 0;
+    return(r);
+  }
+  return((r < 0) ? -1 : 0);
+}
 
-  case SOAPYSDR:
-    n = 0;
-    while((n < samples_size) && (!stop) && (!transfer->stop))
-    {
-      buffers[0] = &samples[n];
-      size = samples_size - n;
-      r = SoapySDRDevice_writeStream(transfer->radio_device.soapysdr,
-                                     transfer->radio_stream.soapysdr,
-                                     buffers,
-                                     size,
-                                     &flags,
-                                     0,
-                                     10000);
-      if(r > 0)
-      {
-        n += r;
-      }
-    }
-    if(last)
-    {
-      /* Complete the remaining buffer to ensure that SoapySDR
-       * will process it */
-      flags = SOAPY_SDR_END_BURST;
-      size = SoapySDRDevice_getStreamMTU(transfer->radio_device.soapysdr,
-                                         transfer->radio_stream.soapysdr);
-      bzero(samples, samples_size * sizeof(complex float));
-      buffers[0] = samples;
-      while((size > 0) && (!stop) && (!transfer->stop))
-      {
-        n = (samples_size < size) ? samples_size : size;
-        r = SoapySDRDevice_writeStream(transfer->radio_device.soapysdr,
-                                       transfer->radio_stream.soapysdr,
-                                       buffers,
-                                       n,
-                                       &flags,
-                                       0,
-                                       10000);
-        if(r > 0)
-        {
-          size -= r;
-        }
-      }
-      do
-      {
-        r = SoapySDRDevice_readStreamStatus(transfer->radio_device.soapysdr,
-                                            transfer->radio_stream.soapysdr,
-                                            &mask,
-                                            &flags,
-                                            &timestamp,
-                                            10000);
-      }
-      while((r != SOAPY_SDR_UNDERFLOW) && (!stop) && (!transfer->stop));
-    }
-    break;
+/* Record the time between the reading of the payload of a frame and the
+ * time at which the radio will have sent the frame */
+void record_latency(gmsk_transfer_t transfer,
+                    long long int payload_time,
+                    long long int air_time)
+{
+  long long int latency = (air_time - payload_time) / 1000;
+
+  if(latency < 0)
+  {
+    latency = 0;
+  }
+  else if(latency >= LATENCY_HISTOGRAM_SIZE)
+  {
+    latency = LATENCY_HISTOGRAM_SIZE - 1;
   }
+  transfer->latency_histogram[latency]++;
+  transfer->latency_count++;
 }
 
-unsigned int receive_from_radio(gmsk_transfer_t transfer,
-                                complex float *samples,
-                                unsigned int samples_size)
+unsigned int get_latency_percentile(gmsk_transfer_t transfer,
+                                    float percentile)
 {
-  unsigned int n = 0;
-  int flags;
-  long long int timestamp;
-  int r;
-  void *buffers[1];
+  unsigned long int target = ceilf(transfer->latency_count * percentile);
+  unsigned long int count = 0;
+  unsigned int i;
 
-  switch(transfer->radio_type)
+  for(i = 0; i < LATENCY_HISTOGRAM_SIZE - 1; i++)
   {
-  case IO:
-    if(transfer->audio_converter)
-    {
-      n = read_audio(transfer, samples, samples_size, stdin);
-    }
-    else
+    count += transfer->latency_histogram[i];
+    if(count >= target)
     {
-      n = fread(samples, sizeof(complex float), samples_size, stdin);
+      break;
     }
+  }
+  return(i);
+}
+
+unsigned long int gmsk_transfer_get_latency(gmsk_transfer_t transfer,
+                                            unsigned int *p50,
+                                            unsigned int *p99)
+{
+  if(p50)
+  {
+    *p50 = get_latency_percentile(transfer, 0.5);
+  }
+  if(p99)
+  {
+    *p99 = get_latency_percentile(transfer, 0.99);
+  }
+  return(transfer->latency_count);
+}
+
+void print_latency_info(gmsk_transfer_t transfer)
+{
+  unsigned int p50;
+  unsigned int p99;
+  unsigned long int frames = gmsk_transfer_get_latency(transfer, &p50, &p99);
+
+  if(verbose && (frames > 0))
+  {
+    fprintf(stderr,
+            _("Info: Latency of %lu frames: p50 %u ms, p99 %u ms\n"),
+            frames,
+            p50,
+            p99);
+  }
+}
+
+/* Count the errors reported by the stream of the radio */
+void count_radio_error(gmsk_transfer_t transfer, int error)
+{
+  switch(error)
+  {
+  case SOAPY_SDR_OVERFLOW:
+    atomic_fetch_add_explicit(&transfer->stats.overflows,
+                              1,
+                              memory_order_relaxed);
     break;
 
-  case FILENAME:
-    if(transfer->audio_converter)
-    {
-      n = read_audio(transfer,
-                     samples,
-                     samples_size,
-                     transfer->radio_device.file);
-    }
-    else
-    {
-      n = fread(samples,
-                sizeof(complex float),
-                samples_size,
-                transfer->radio_device.file);
-    }
+  case SOAPY_SDR_UNDERFLOW:
+    atomic_fetch_add_explicit(&transfer->stats.underflows,
+                              1,
+                              memory_order_relaxed);
     break;
 
-  case SOAPYSDR:
-    buffers[0] = samples;
-    r = SoapySDRDevice_readStream(transfer->radio_device.soapysdr,
-                                  transfer->radio_stream.soapysdr,
-                                  buffers,
-                                  samples_size,
-                                  &flags,
-                                  &timestamp,
-                                  10000);
-    if(r >= 0)
-    {
-      n = r;
-    }
+  case SOAPY_SDR_TIMEOUT:
+    atomic_fetch_add_explicit(&transfer->stats.timeouts,
+                              1,
+                              memory_order_relaxed);
+    break;
+
+  default:
     break;
   }
-  return(n);
 }
 
-void set_counter(unsigned char *header, unsigned int counter)
+void count_frame_sent(gmsk_transfer_t transfer, unsigned int payload_size)
 {
-  header[4] = (counter >> 24) & 255;
-  header[5] = (counter >> 16) & 255;
-  header[6] = (counter >> 8) & 255;
-  header[7] = counter & 255;
+  atomic_fetch_add_explicit(&transfer->stats.frames_sent,
+                            1,
+                            memory_order_relaxed);
+  atomic_fetch_add_explicit(&transfer->stats.bytes_sent,
+                            payload_size,
+                            memory_order_relaxed);
 }
 
-unsigned int get_counter(unsigned char *header)
+/* Start measuring the duration of a stage; without a profiler, the clock is
+ * not read */
+long long int start_stage(gmsk_transfer_t transfer)
 {
-  return((header[4] << 24) | (header[5] << 16) | (header[6] << 8) | header[7]);
+  return(transfer->profiler ? profiler_get_time() : 0);
 }
 
-void send_dummy_samples(gmsk_transfer_t transfer,
-                        msresamp_crcf resampler,
-                        nco_crcf oscillator,
-                        complex float *samples,
-                        unsigned int delay,
-                        int last)
+/* Record the time elapsed since '*start' for a stage, and start measuring
+ * the next stage. Return the duration of the stage. */
+long long int end_stage(gmsk_transfer_t transfer,
+                        stage_t stage,
+                        long long int *start)
+{
+  long long int now;
+  long long int duration;
+
+  if(transfer->profiler == NULL)
+  {
+    return(0);
+  }
+  now = profiler_get_time();
+  duration = now - *start;
+  profiler_record(transfer->profiler, stage, duration);
+  *start = now;
+  return(duration);
+}
+
+void print_profiling_info(gmsk_transfer_t transfer)
 {
+  unsigned long int calls;
+  unsigned long long int total;
+  unsigned long long int p50;
+  unsigned long long int p99;
+  long long int elapsed;
   unsigned int i;
-  unsigned int n;
-  complex float zero_sample = 0;
 
-  for(i = 0; i < delay; i++)
+  if((!verbose) || (transfer->profiler == NULL))
   {
-    msresamp_crcf_execute(resampler, &zero_sample, 1, samples, &n);
-    if(transfer->frequency_offset != 0)
-    {
-      nco_crcf_mix_block_up(oscillator, samples, samples, n);
-    }
-    if(i + 1 < delay)
+    return;
+  }
+  elapsed = profiler_get_elapsed(transfer->profiler);
+  for(i = 0; i < STAGES_SIZE; i++)
+  {
+    profiler_get_stage(transfer->profiler, i, &calls, &total, &p50, &p99);
+    if(calls > 0)
     {
-      send_to_radio(transfer, samples, n, 0);
+      fprintf(stderr,
+              _("Info: Stage '%s': %lu calls, %.3f s (%.1f%%), p50 %.1f us, p99 %.1f us\n"),
+              stage_names[i],
+              calls,
+              total / 1000000000.0,
+              (elapsed > 0) ? (100.0 * total) / elapsed : 0.0,
+              p50 / 1000.0,
+              p99 / 1000.0);
     }
-    else
+  }
+}
+
+int read_data(void *context,
+              unsigned char *payload,
+              unsigned int payload_size)
+{
+  gmsk_transfer_t transfer = (gmsk_transfer_t) context;
+  struct pollfd input;
+  int n;
+
+  if(feof(transfer->file))
+  {
+    return(-1);
+  }
+
+  n = fread(payload, 1, payload_size, transfer->file);
+  if((n == 0) && (!feof(transfer->file)))
+  {
+    /* Nothing to read for now. Sleep until some data arrives, but not
+     * longer than the radio can wait for new samples. */
+    clearerr(transfer->file);
+    input.fd = fileno(transfer->file);
+    input.events = POLLIN;
+    if(poll(&input, 1, gmsk_transfer_get_idle_timeout(transfer)) > 0)
     {
-      send_to_radio(transfer, samples, n, last);
+      n = fread(payload, 1, payload_size, transfer->file);
     }
   }
+
+  return(n);
 }
 
-void send_frames(gmsk_transfer_t transfer)
-{
-  float bt = transfer->bt;
-  unsigned int samples_per_symbol = ceilf(1 / bt);
-  unsigned int filter_delay = samples_per_symbol + 1;
-  gmskframegen frame_generator = gmskframegen_create_set(samples_per_symbol,
-                                                         filter_delay,
-                                                         bt);
-  float resampling_ratio = (float) transfer->sample_rate / (transfer->bit_rate *
-                                                            samples_per_symbol);
-  msresamp_crcf resampler = msresamp_crcf_create(resampling_ratio, 60);
-  unsigned int delay = ceilf(msresamp_crcf_get_delay(resampler));
-  unsigned int header_size = 8;
-  unsigned char header[header_size];
-  /* Try to make frames of approximately 100 ms, but containing at least
-   * 16 bytes and at most 8000 bytes of payload */
-  unsigned int byte_rate = transfer->bit_rate / 8;
-  unsigned int payload_size = MIN(MAX(byte_rate * 0.1, 16), 8000);
-  int r;
-  unsigned int n;
-  unsigned int i;
-  /* Process data by blocks of 50 ms */
-  unsigned int frame_samples_size = ceilf((transfer->bit_rate *
-                                           samples_per_symbol) / 20.0);
-  unsigned int samples_size = ceilf((frame_samples_size + delay) * resampling_ratio);
-  int frame_complete;
-  float center_frequency = (float) transfer->frequency_offset / transfer->sample_rate;
-  nco_crcf oscillator = nco_crcf_create(LIQUID_NCO);
-  float maximum_amplitude = 1;
-  unsigned int counter = 0;
-  unsigned char *payload = malloc(payload_size);
-  complex float *frame_samples = malloc(frame_samples_size * sizeof(complex float));
-  complex float *samples = malloc(samples_size * sizeof(complex float));
+int write_data(void *context,
+               unsigned char *payload,
+               unsigned int payload_size)
+{
+  gmsk_transfer_t transfer = (gmsk_transfer_t) context;
 
-  if((payload == NULL) || (frame_samples == NULL) || (samples == NULL))
+  fwrite(payload, 1, payload_size, transfer->file);
+  if(transfer->file == stdout)
   {
-    fprintf(stderr, _("Error: Memory allocation failed\n"));
-    exit(EXIT_FAILURE);
+    fflush(transfer->file);
   }
 
-  nco_crcf_set_phase(oscillator, 0);
-  nco_crcf_set_frequency(oscillator, TAU * center_frequency);
+  return(payload_size);
+}
 
-  gmskframegen_set_header_len(frame_generator, header_size);
-  memcpy(header, transfer->id, 4);
-  set_counter(header, counter);
+void map_radio_file(gmsk_transfer_t transfer)
+{
+  int fd = fileno(transfer->radio_device.file);
+  struct stat file_stat;
+  void *map;
 
-  while((!stop) && (!transfer->stop))
+  transfer->file_map = NULL;
+  transfer->file_size = 0;
+  transfer->file_position = 0;
+  transfer->file_released = 0;
+  transfer->file_direct = 0;
+  /* Pipes and devices are still read and written with stdio */
+  if((fstat(fd, &file_stat) != 0) || (!S_ISREG(file_stat.st_mode)))
   {
-    r = transfer->data_callback(transfer->callback_context, payload, payload_size);
-    if(r < 0)
+    return;
+  }
+  if(transfer->emit)
+  {
+    transfer->file_direct = 1;
+    return;
+  }
+  if(file_stat.st_size == 0)
+  {
+    return;
+  }
+  map = mmap(NULL, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if(map == MAP_FAILED)
+  {
+    return;
+  }
+  madvise(map, file_stat.st_size, MADV_SEQUENTIAL);
+  transfer->file_map = map;
+  transfer->file_size = file_stat.st_size;
+  transfer->file_direct = 1;
+}
+
+void unmap_radio_file(gmsk_transfer_t transfer)
+{
+  if(transfer->file_map)
+  {
+    munmap(transfer->file_map, transfer->file_size);
+    transfer->file_map = NULL;
+  }
+  else if(transfer->file_direct && transfer->emit)
+  {
+    /* Remove the space reserved after the last samples */
+    if(ftruncate(fileno(transfer->radio_device.file),
+                 transfer->file_position) != 0)
     {
-      break;
+      fprintf(stderr, _("Error: Failed to truncate the samples file\n"));
     }
-    n = r;
+  }
+}
 
-    if(n > 0)
+/* Get at most 'samples_size' samples of 'sample_size' bytes from the mapped
+ * recording without copying them
+ * Return the number of samples available at 'data'. */
+unsigned int map_samples(gmsk_transfer_t transfer,
+                         void **data,
+                         unsigned int samples_size,
+                         unsigned int sample_size)
+{
+  size_t available = (transfer->file_size - transfer->file_position) /
+    sample_size;
+  size_t size;
+
+  /* The samples before the current position have been processed */
+  size = transfer->file_position - transfer->file_released;
+  if(size >= FILE_RELEASE_SIZE)
+  {
+    size -= size % FILE_RELEASE_SIZE;
+    madvise(transfer->file_map + transfer->file_released, size, MADV_DONTNEED);
+    transfer->file_released += size;
+  }
+
+  if(samples_size > available)
+  {
+    samples_size = available;
+  }
+  *data = transfer->file_map + transfer->file_position;
+  transfer->file_position += (size_t) samples_size * sample_size;
+
+  return(samples_size);
+}
+
+void write_radio_file(gmsk_transfer_t transfer,
+                      const void *data,
+                      size_t size)
+{
+  int fd = fileno(transfer->radio_device.file);
+  const unsigned char *d = data;
+  size_t step;
+  ssize_t r;
+
+  /* Reserve the space in large steps instead of extending the file at
+   * each write */
+  if(transfer->file_position + size > transfer->file_size)
+  {
+    step = MAX(FILE_PREALLOCATION_SIZE, size);
+    if(posix_fallocate(fd, transfer->file_size, step) == 0)
     {
-      gmskframegen_assemble(frame_generator,
-                            header,
-                            payload,
-                            n,
-                            transfer->crc,
-                            transfer->inner_fec,
-                            transfer->outer_fec);
-      frame_complete = 0;
-      while(!frame_complete)
-      {
-        frame_complete = gmskframegen_write(frame_generator,
-                                            frame_samples,
-                                            frame_samples_size);
-        n = frame_samples_size;
-        if(frame_complete)
-        {
-          /* Don't send the padding 0 bytes */
-          while((n > 0) && (frame_samples[n - 1] == 0))
-          {
-            n--;
-          }
-        }
-        /* Reduce the amplitude of samples a little because the resampler
-         * may produce samples with an amplitude slightly greater than 1.0
-         * otherwise */
-        maximum_amplitude = 1;
-        for(i = 0; i < n; i++)
-        {
-          if(cabsf(frame_samples[i]) > maximum_amplitude)
-          {
-            maximum_amplitude = cabsf(frame_samples[i]);
-          }
-        }
-        liquid_vectorcf_mulscalar(frame_samples,
-                                  n,
-                                  0.75 / maximum_amplitude,
-                                  frame_samples);
-        msresamp_crcf_execute(resampler, frame_samples, n, samples, &n);
-        if(transfer->frequency_offset != 0)
-        {
-          nco_crcf_mix_block_up(oscillator, samples, samples, n);
-        }
-        send_to_radio(transfer, samples, n, 0);
-      }
-      counter++;
-      set_counter(header, counter);
+      transfer->file_size += step;
     }
-    else
+  }
+
+  while(size > 0)
+  {
+    r = pwrite(fd, d, size, transfer->file_position);
+    if(r <= 0)
     {
-      /* Underrun when reading from stdin. Send some dummy samples to get the
-       * remaining output samples for the end of current frame (because of
-       * resampler and filter delays) and send them */
-      send_dummy_samples(transfer,
-                         resampler,
-                         oscillator,
-                         samples,
-                         delay + filter_delay,
-                         0);
+      fprintf(stderr, _("Error: Failed to write the samples file\n"));
+      break;
     }
+    d += r;
+    size -= r;
+    transfer->file_position += r;
   }
+}
 
-  /* Send some dummy samples to get the remaining output samples (because of
-   * resampler and filter delays) */
-  send_dummy_samples(transfer,
-                     resampler,
-                     oscillator,
-                     samples,
-                     delay + filter_delay,
-                     1);
+void write_samples(gmsk_transfer_t transfer,
+                   const void *data,
+                   size_t size,
+                   FILE *output)
+{
+  if((transfer->radio_type == FILENAME) && transfer->file_direct)
+  {
+    write_radio_file(transfer, data, size);
+  }
+  else
+  {
+    fwrite(data, 1, size, output);
+  }
+}
 
-  free(samples);
-  free(frame_samples);
-  free(payload);
-  nco_crcf_destroy(oscillator);
-  msresamp_crcf_destroy(resampler);
-  gmskframegen_destroy(frame_generator);
+void write_iq_samples(gmsk_transfer_t transfer,
+                      complex float *samples,
+                      unsigned int samples_size,
+                      FILE *output)
+{
+  unsigned int n;
+  unsigned char data[FORMAT_BLOCK_SIZE * sizeof(complex float)];
+
+  if(transfer->sample_format == FORMAT_CF32)
+  {
+    write_samples(transfer,
+                  samples,
+                  samples_size * sizeof(complex float),
+                  output);
+    return;
+  }
+
+  while(samples_size > 0)
+  {
+    n = MIN(samples_size, FORMAT_BLOCK_SIZE);
+    samples_to_format(transfer, samples, n, data);
+    write_samples(transfer, data, n * transfer->sample_bytes, output);
+    samples += n;
+    samples_size -= n;
+  }
 }
 
-int frame_received(unsigned char *header,
-                   int header_valid,
-                   unsigned char *payload,
-                   unsigned int payload_size,
-                   int payload_valid,
-                   framesyncstats_s stats,
-                   void *user_data)
+unsigned int read_iq_samples(gmsk_transfer_t transfer,
+                             complex float *samples,
+                             unsigned int samples_size,
+                             FILE *input)
 {
-  gmsk_transfer_t transfer = (gmsk_transfer_t) user_data;
-  char id[5];
-  unsigned int counter;
+  unsigned int n = 0;
+  unsigned int size;
+  unsigned int r;
+  unsigned char data[FORMAT_BLOCK_SIZE * sizeof(complex float)];
+  void *mapped_data;
 
-  transfer->timeout_start = time(NULL);
-  memcpy(id, header, 4);
-  id[4] = '\0';
-  counter = get_counter(header);
+  if((transfer->radio_type == FILENAME) && transfer->file_map)
+  {
+    n = map_samples(transfer,
+                    &mapped_data,
+                    samples_size,
+                    transfer->sample_bytes);
+    samples_from_format(transfer, mapped_data, n, samples);
+    return(n);
+  }
 
-  if(!header_valid || !payload_valid)
+  if(transfer->sample_format == FORMAT_CF32)
   {
-    if(verbose)
+    return(fread(samples, sizeof(complex float), samples_size, input));
+  }
+
+  while(n < samples_size)
+  {
+    size = MIN(samples_size - n, FORMAT_BLOCK_SIZE);
+    r = fread(data, transfer->sample_bytes, size, input);
+    samples_from_format(transfer, data, r, &samples[n]);
+    n += r;
+    if(r < size)
     {
-      if(!header_valid)
-      {
-        fprintf(stderr, _("Frame %u for '%s': corrupted header\n"), counter, id);
-      }
-      if(!payload_valid)
-      {
-        fprintf(stderr, _("Frame %u for '%s': corrupted payload\n"), counter, id);
-      }
-      fflush(stderr);
+      break;
     }
   }
-  else if(memcmp(id, transfer->id, 4) != 0)
+  return(n);
+}
+
+/* Get a buffer for 'samples_size' samples in the sample format of the
+ * radio */
+unsigned char * get_stream_buffer(gmsk_transfer_t transfer,
+                                  unsigned int samples_size)
+{
+  if(samples_size > transfer->stream_buffer_size)
   {
-    if(verbose)
+    free(transfer->stream_buffer);
+    transfer->stream_buffer = malloc(samples_size * transfer->sample_bytes);
+    if(transfer->stream_buffer == NULL)
     {
-      fprintf(stderr, _("Frame %u for '%s': ignored\n"), counter, id);
-      fflush(stderr);
+      fprintf(stderr, _("Error: Memory allocation failed\n"));
+      exit(EXIT_FAILURE);
     }
+    transfer->stream_buffer_size = samples_size;
   }
-  else
+  return(transfer->stream_buffer);
+}
+
+void write_audio(gmsk_transfer_t transfer,
+                 complex float *samples,
+                 unsigned int samples_size,
+                 FILE *output)
+{
+  unsigned int n;
+  float audio_samples[2 * AUDIO_BLOCK_SIZE];
+  short int audio_samples_s16[2 * AUDIO_BLOCK_SIZE];
+
+  while(samples_size > 0)
   {
-    transfer->data_callback(transfer->callback_context, payload, payload_size);
+    n = MIN(samples_size, AUDIO_BLOCK_SIZE);
+    firhilbf_interp_execute_block(transfer->audio_converter,
+                                  samples,
+                                  n,
+                                  audio_samples);
+    convert_float_to_s16(audio_samples,
+                         audio_samples_s16,
+                         2 * n,
+                         transfer->audio_gain);
+    write_samples(transfer,
+                  audio_samples_s16,
+                  2 * n * sizeof(short int),
+                  output);
+    samples += n;
+    samples_size -= n;
   }
-  return(0);
 }
 
-void receive_frames(gmsk_transfer_t transfer)
+void audio_to_iq(firhilbf audio_converter,
+                 float gain,
+                 const short int *audio_samples_s16,
+                 unsigned int samples_size,
+                 complex float *samples)
 {
-  float bt = transfer->bt;
-  unsigned int samples_per_symbol = ceilf(1 / bt);
-  unsigned int filter_delay = samples_per_symbol + 1;
-  float dphi_max = (TAU * transfer->maximum_deviation) / transfer->bit_rate;
-  gmskframesync frame_synchronizer = gmskframesync_create_set2(samples_per_symbol,
-                                                               filter_delay,
-                                                               bt,
-                                                               dphi_max,
-                                                               frame_received,
-                                                               transfer);
-  float resampling_ratio = (transfer->bit_rate *
-                            samples_per_symbol) / (float) transfer->sample_rate;
-  msresamp_crcf resampler = msresamp_crcf_create(resampling_ratio, 60);
-  unsigned int delay = filter_delay + ceilf(msresamp_crcf_get_delay(resampler));
   unsigned int n;
-  /* Process data by blocks of 50 ms */
-  unsigned int frame_samples_size = ceilf((transfer->bit_rate *
-                                           samples_per_symbol) / 20.0);
-  unsigned int samples_size = floorf(frame_samples_size / resampling_ratio);
-  nco_crcf oscillator = nco_crcf_create(LIQUID_NCO);
-  complex float *frame_samples = malloc((frame_samples_size + delay) *
-                                        sizeof(complex float));
-  complex float *samples = malloc((samples_size + delay) *
-                                  sizeof(complex float));
+  float audio_samples[2 * AUDIO_BLOCK_SIZE];
 
-  if((frame_samples == NULL) || (samples == NULL))
+  while(samples_size > 0)
   {
-    fprintf(stderr, _("Error: Memory allocation failed\n"));
-    exit(EXIT_FAILURE);
+    n = MIN(samples_size, AUDIO_BLOCK_SIZE);
+    convert_s16_to_float(audio_samples_s16, audio_samples, 2 * n, gain);
+    firhilbf_decim_execute_block(audio_converter, audio_samples, n, samples);
+    audio_samples_s16 += 2 * n;
+    samples += n;
+    samples_size -= n;
   }
+}
 
-  nco_crcf_set_phase(oscillator, 0);
-  nco_crcf_set_frequency(oscillator, TAU * ((float) transfer->frequency_offset /
-                                            transfer->sample_rate));
+unsigned int read_audio(gmsk_transfer_t transfer,
+                        complex float *samples,
+                        unsigned int samples_size,
+                        FILE* input)
+{
+  unsigned int n = 0;
+  unsigned int size;
+  unsigned int r;
+  short int audio_samples_s16[2 * AUDIO_BLOCK_SIZE];
+  void *data;
 
-  while((!stop) && (!transfer->stop))
+  if((transfer->radio_type == FILENAME) && transfer->file_map)
   {
-    n = receive_from_radio(transfer, samples, samples_size);
-    if((n == 0) &&
-       ((transfer->radio_type == IO) || (transfer->radio_type == FILENAME)))
+    n = map_samples(transfer, &data, samples_size, 2 * sizeof(short int));
+    audio_to_iq(transfer->audio_converter,
+                transfer->audio_gain,
+                data,
+                n,
+                samples);
+    return(n);
+  }
+
+  while(n < samples_size)
+  {
+    size = MIN(samples_size - n, AUDIO_BLOCK_SIZE);
+    r = fread(audio_samples_s16, 2 * sizeof(short int), size, input);
+    audio_to_iq(transfer->audio_converter,
+                transfer->audio_gain,
+                audio_samples_s16,
+                r,
+                &samples[n]);
+    n += r;
+    if(r < size)
+    {
+      break;
+    }
+  }
+  return(n);
+}
+
+/* Write real samples of the direct audio engine */
+void send_audio_to_radio(gmsk_transfer_t transfer,
+                         float *audio,
+                         unsigned int audio_size)
+{
+  unsigned int n;
+  short int audio_samples_s16[AUDIO_BLOCK_SIZE];
+  FILE *output = (transfer->radio_type == IO) ?
+    stdout : transfer->radio_device.file;
+
+  advance_radio_time(transfer, audio_size, transfer->audio_sample_rate);
+  while(audio_size > 0)
+  {
+    n = MIN(audio_size, AUDIO_BLOCK_SIZE);
+    convert_float_to_s16(audio, audio_samples_s16, n, transfer->audio_gain);
+    write_samples(transfer, audio_samples_s16, n * sizeof(short int), output);
+    audio += n;
+    audio_size -= n;
+  }
+}
+
+/* Read real samples for the direct audio engine */
+unsigned int receive_audio_from_radio(gmsk_transfer_t transfer,
+                                      float *audio,
+                                      unsigned int audio_size)
+{
+  unsigned int n = 0;
+  unsigned int size;
+  unsigned int r;
+  short int audio_samples_s16[AUDIO_BLOCK_SIZE];
+  void *data;
+  FILE *input = (transfer->radio_type == IO) ?
+    stdin : transfer->radio_device.file;
+
+  if((transfer->radio_type == FILENAME) && transfer->file_map)
+  {
+    n = map_samples(transfer, &data, audio_size, sizeof(short int));
+    convert_s16_to_float(data, audio, n, transfer->audio_gain);
+    return(n);
+  }
+
+  while(n < audio_size)
+  {
+    size = MIN(audio_size - n, AUDIO_BLOCK_SIZE);
+    r = fread(audio_samples_s16, sizeof(short int), size, input);
+    convert_s16_to_float(audio_samples_s16, &audio[n], r, transfer->audio_gain);
+    n += r;
+    if(r < size)
+    {
+      break;
+    }
+  }
+  return(n);
+}
+
+/* Get at most 'samples_size' samples from the current buffer of the driver,
+ * and acquire a new one when it has been consumed
+ * Return the number of samples available at 'data'. They remain valid until
+ * the next call. */
+unsigned int acquire_read_samples(gmsk_transfer_t transfer,
+                                  const void **data,
+                                  unsigned int samples_size)
+{
+  const void *buffers[1];
+  int flags;
+  long long int timestamp;
+  int r;
+  unsigned int n;
+
+  if(transfer->read_acquired && (transfer->read_available == 0))
+  {
+    SoapySDRDevice_releaseReadBuffer(transfer->radio_device.soapysdr,
+                                     transfer->radio_stream.soapysdr,
+                                     transfer->read_handle);
+    transfer->read_acquired = 0;
+  }
+  if(!transfer->read_acquired)
+  {
+    r = SoapySDRDevice_acquireReadBuffer(transfer->radio_device.soapysdr,
+                                         transfer->radio_stream.soapysdr,
+                                         &transfer->read_handle,
+                                         buffers,
+                                         &flags,
+                                         &timestamp,
+                                         10000);
+    if(r < 0)
+    {
+      count_radio_error(transfer, r);
+      return(0);
+    }
+    transfer->read_acquired = 1;
+    transfer->read_buffer = buffers[0];
+    transfer->read_available = r;
+    transfer->read_time = (flags & SOAPY_SDR_HAS_TIME) ? timestamp : -1;
+    transfer->read_offset = 0;
+  }
+
+  n = MIN(samples_size, transfer->read_available);
+  transfer->block_time = (transfer->read_time < 0) ?
+    -1 :
+    transfer->read_time + ((transfer->read_offset * 1000000000LL) /
+                           (long long int) transfer->sample_rate);
+  transfer->read_offset += n;
+  *data = transfer->read_buffer;
+  transfer->read_buffer += n * transfer->sample_bytes;
+  transfer->read_available -= n;
+  return(n);
+}
+
+/* Acquire a buffer of the driver to write samples in it
+ * Return 0 on success and -1 on timeout. */
+int acquire_write_buffer(gmsk_transfer_t transfer)
+{
+  void *buffers[1];
+  int r;
+
+  if(transfer->write_acquired)
+  {
+    return(0);
+  }
+  r = SoapySDRDevice_acquireWriteBuffer(transfer->radio_device.soapysdr,
+                                        transfer->radio_stream.soapysdr,
+                                        &transfer->write_handle,
+                                        buffers,
+                                        10000);
+  if(r < 0)
+  {
+    count_radio_error(transfer, r);
+    return(-1);
+  }
+  transfer->write_acquired = 1;
+  transfer->write_buffer = buffers[0];
+  transfer->write_capacity = r;
+  return(0);
+}
+
+/* Get the flags and the time of the next write to the radio: the first
+ * samples of a timed transmission are sent at the start time */
+int get_write_time(gmsk_transfer_t transfer, long long int *time)
+{
+  if(transfer->start_time_pending)
+  {
+    transfer->start_time_pending = 0;
+    *time = transfer->scheduled_time;
+    return(SOAPY_SDR_HAS_TIME);
+  }
+  *time = 0;
+  return(0);
+}
+
+/* Give the first 'samples_size' samples of the acquired buffer to the
+ * driver */
+void release_write_buffer(gmsk_transfer_t transfer,
+                          unsigned int samples_size,
+                          int flags)
+{
+  long long int time;
+
+  flags |= get_write_time(transfer, &time);
+  SoapySDRDevice_releaseWriteBuffer(transfer->radio_device.soapysdr,
+                                    transfer->radio_stream.soapysdr,
+                                    transfer->write_handle,
+                                    samples_size,
+                                    &flags,
+                                    time);
+  transfer->write_acquired = 0;
+}
+
+/* Release the buffers of the driver still acquired at the end of a
+ * transfer */
+void release_radio_buffers(gmsk_transfer_t transfer)
+{
+  if(transfer->read_acquired)
+  {
+    SoapySDRDevice_releaseReadBuffer(transfer->radio_device.soapysdr,
+                                     transfer->radio_stream.soapysdr,
+                                     transfer->read_handle);
+    transfer->read_acquired = 0;
+  }
+  if(transfer->write_acquired)
+  {
+    release_write_buffer(transfer, 0, 0);
+  }
+}
+
+/* Get a buffer where the next 'samples_size' samples to send can be
+ * computed: directly in the memory of the driver when its buffers can be
+ * accessed and contain complex float samples, 'samples' otherwise */
+complex float * get_radio_buffer(gmsk_transfer_t transfer,
+                                 complex float *samples,
+                                 unsigned int samples_size)
+{
+  if((transfer->radio_type != SOAPYSDR) ||
+     (!transfer->direct_access) ||
+     (transfer->sample_format != FORMAT_CF32) ||
+     (acquire_write_buffer(transfer) < 0) ||
+     (transfer->write_capacity < samples_size))
+  {
+    return(samples);
+  }
+  return((complex float *) transfer->write_buffer);
+}
+
+/* Wait until the radio has sent all the samples
+ * The driver can signal the end of the burst with an acknowledgement or an
+ * underflow. When it doesn't, the end of the burst is estimated from the
+ * number of samples written since the radio was last idle. */
+void wait_end_of_burst(gmsk_transfer_t transfer)
+{
+  long long int deadline = atomic_load(&transfer->radio_time) +
+    (END_OF_BURST_MARGIN * 1000LL);
+  long long int remaining;
+  int flags;
+  size_t mask;
+  long long int timestamp;
+  int r;
+
+  while((!stop) && (!transfer->stop))
+  {
+    remaining = deadline - get_time_us();
+    if(remaining <= 0)
+    {
+      break;
+    }
+    flags = 0;
+    mask = 0;
+    r = SoapySDRDevice_readStreamStatus(transfer->radio_device.soapysdr,
+                                        transfer->radio_stream.soapysdr,
+                                        &mask,
+                                        &flags,
+                                        &timestamp,
+                                        remaining);
+    if((r == SOAPY_SDR_UNDERFLOW) ||
+       ((r == 0) && (flags & SOAPY_SDR_END_BURST)))
+    {
+      break;
+    }
+    if(r == SOAPY_SDR_NOT_SUPPORTED)
+    {
+      usleep(remaining);
+      break;
+    }
+  }
+}
+
+/* Count the underflows reported by the radio since the previous write,
+ * without waiting */
+void count_underflows(gmsk_transfer_t transfer)
+{
+  int flags;
+  size_t mask;
+  long long int timestamp;
+  int r;
+
+  do
+  {
+    flags = 0;
+    mask = 0;
+    r = SoapySDRDevice_readStreamStatus(transfer->radio_device.soapysdr,
+                                        transfer->radio_stream.soapysdr,
+                                        &mask,
+                                        &flags,
+                                        &timestamp,
+                                        0);
+    if(r == SOAPY_SDR_UNDERFLOW)
+    {
+      count_radio_error(transfer, r);
+    }
+  }
+  while(r == SOAPY_SDR_UNDERFLOW);
+}
+
+/* Number of zero samples completing the last buffer of a burst, because
+ * some drivers only send full buffers */
+unsigned int get_burst_padding(gmsk_transfer_t transfer)
+{
+  size_t mtu = SoapySDRDevice_getStreamMTU(transfer->radio_device.soapysdr,
+                                           transfer->radio_stream.soapysdr);
+
+  if(mtu == 0)
+  {
+    return(0);
+  }
+  return((mtu - (transfer->burst_samples % mtu)) % mtu);
+}
+
+/* Write samples to the radio through the buffers of the driver
+ * If 'samples' is NULL, zeros are written. */
+void write_radio_buffers(gmsk_transfer_t transfer,
+                         complex float *samples,
+                         unsigned int samples_size,
+                         int flags)
+{
+  unsigned int n;
+  /* With some flags (e.g. the end of a burst), a buffer must be given to the
+   * driver even if there are no samples */
+  int released = (flags == 0);
+
+  if(transfer->write_acquired &&
+     (samples == (complex float *) transfer->write_buffer))
+  {
+    /* The samples have been computed in the buffer */
+    release_write_buffer(transfer, samples_size, flags);
+    return;
+  }
+
+  while(((samples_size > 0) || (!released)) && (!stop) && (!transfer->stop))
+  {
+    if(acquire_write_buffer(transfer) < 0)
+    {
+      continue;
+    }
+    n = MIN(samples_size, transfer->write_capacity);
+    if(samples)
+    {
+      samples_to_format(transfer, samples, n, transfer->write_buffer);
+      samples += n;
+    }
+    else
+    {
+      bzero(transfer->write_buffer, n * transfer->sample_bytes);
+    }
+    release_write_buffer(transfer, n, flags);
+    released = 1;
+    samples_size -= n;
+  }
+}
+
+/* Wait until the radio would start sending the last 'samples_size' samples
+ * if it was sending them at the sample rate */
+void pace_samples(gmsk_transfer_t transfer, unsigned int samples_size)
+{
+  long long int delay = atomic_load(&transfer->radio_time) -
+    ((samples_size * 1000000LL) / transfer->sample_rate) -
+    get_time_us();
+
+  if(delay > 0)
+  {
+    usleep(delay);
+  }
+}
+
+void send_to_radio(gmsk_transfer_t transfer,
+                   complex float *samples,
+                   unsigned int samples_size,
+                   int last)
+{
+  unsigned int n;
+  unsigned int size;
+  int flags = 0;
+  long long int time;
+  int r;
+  const void *buffers[1];
+  unsigned char *data;
+
+  if(transfer->dump)
+  {
+    dump_samples(transfer, samples, samples_size);
+  }
+  advance_radio_time(transfer, samples_size, transfer->sample_rate);
+
+  switch(transfer->radio_type)
+  {
+  case IO:
+    if(transfer->audio_converter)
+    {
+      write_audio(transfer, samples, samples_size, stdout);
+    }
+    else
+    {
+      write_iq_samples(transfer, samples, samples_size, stdout);
+    }
+    break;
+
+  case FILENAME:
+    if(transfer->audio_converter)
+    {
+      write_audio(transfer, samples, samples_size, transfer->radio_device.file);
+    }
+    else
+    {
+      write_iq_samples(transfer,
+                       samples,
+                       samples_size,
+                       transfer->radio_device.file);
+    }
+    break;
+
+  case SOAPYSDR:
+    count_underflows(transfer);
+    if(transfer->direct_access)
+    {
+      write_radio_buffers(transfer, samples, samples_size, 0);
+      transfer->burst_samples += samples_size;
+      if(last)
+      {
+        /* The end of the burst is marked on the zeros completing the last
+         * buffer, or on an empty buffer when the last one is full */
+        size = get_burst_padding(transfer);
+        write_radio_buffers(transfer, NULL, size, SOAPY_SDR_END_BURST);
+        advance_radio_time(transfer, size, transfer->sample_rate);
+        wait_end_of_burst(transfer);
+        transfer->burst_samples = 0;
+      }
+      break;
+    }
+    if(transfer->sample_format == FORMAT_CF32)
+    {
+      data = (unsigned char *) samples;
+    }
+    else
+    {
+      data = get_stream_buffer(transfer, samples_size);
+      samples_to_format(transfer, samples, samples_size, data);
+    }
+    n = 0;
+    while((n < samples_size) && (!stop) && (!transfer->stop))
+    {
+      buffers[0] = &data[n * transfer->sample_bytes];
+      flags = get_write_time(transfer, &time);
+      r = SoapySDRDevice_writeStream(transfer->radio_device.soapysdr,
+                                     transfer->radio_stream.soapysdr,
+                                     buffers,
+                                     samples_size - n,
+                                     &flags,
+                                     time,
+                                     10000);
+      if(r > 0)
+      {
+        n += r;
+      }
+      else
+      {
+        count_radio_error(transfer, r);
+        if(time != 0)
+        {
+          /* Nothing was written, try again with the start time */
+          transfer->start_time_pending = 1;
+        }
+      }
+    }
+    transfer->burst_samples += samples_size;
+    if(last)
+    {
+      /* The end of the burst is marked on the zeros completing the last
+       * buffer, or on an empty write when the buffer is full */
+      size = get_burst_padding(transfer);
+      advance_radio_time(transfer, size, transfer->sample_rate);
+      data = get_stream_buffer(transfer, size);
+      bzero(data, size * transfer->sample_bytes);
+      buffers[0] = data;
+      do
+      {
+        flags = SOAPY_SDR_END_BURST | get_write_time(transfer, &time);
+        r = SoapySDRDevice_writeStream(transfer->radio_device.soapysdr,
+                                       transfer->radio_stream.soapysdr,
+                                       buffers,
+                                       size,
+                                       &flags,
+                                       time,
+                                       10000);
+        if(r > 0)
+        {
+          buffers[0] = &data[r * transfer->sample_bytes];
+          size -= r;
+        }
+        else
+        {
+          count_radio_error(transfer, r);
+        }
+      }
+      while((size > 0) && (!stop) && (!transfer->stop));
+      wait_end_of_burst(transfer);
+      transfer->burst_samples = 0;
+    }
+    break;
+
+  case LOOPBACK:
+    if(transfer->simulator)
+    {
+      if(simulator_is_paced(transfer->simulator))
+      {
+        pace_samples(transfer, samples_size);
+      }
+      samples = simulator_execute(transfer->simulator,
+                                  samples,
+                                  samples_size,
+                                  &samples_size);
+      if(samples == NULL)
+      {
+        fprintf(stderr, _("Error: Memory allocation failed\n"));
+        exit(EXIT_FAILURE);
+      }
+    }
+    /* The write ends early only if the receiver is gone */
+    ringbuffer_write_all(transfer->radio_device.loopback,
+                         samples,
+                         samples_size);
+    break;
+  }
+}
+
+/* The pseudo-radios have no clock, the time of the samples is computed from
+ * the number of samples read since the start of the transfer */
+void count_samples_read(gmsk_transfer_t transfer, unsigned int n)
+{
+  transfer->block_time = (transfer->samples_read * 1000000000.0) /
+    transfer->sample_rate;
+  transfer->samples_read += n;
+}
+
+unsigned int receive_from_radio(gmsk_transfer_t transfer,
+                                complex float *samples,
+                                unsigned int samples_size)
+{
+  unsigned int n = 0;
+  int flags;
+  long long int timestamp;
+  int r;
+  void *buffers[1];
+  const void *data;
+
+  switch(transfer->radio_type)
+  {
+  case IO:
+    if(transfer->audio_converter)
+    {
+      n = read_audio(transfer, samples, samples_size, stdin);
+    }
+    else
+    {
+      n = read_iq_samples(transfer, samples, samples_size, stdin);
+    }
+    break;
+
+  case FILENAME:
+    if(transfer->audio_converter)
+    {
+      n = read_audio(transfer,
+                     samples,
+                     samples_size,
+                     transfer->radio_device.file);
+    }
+    else
+    {
+      n = read_iq_samples(transfer,
+                          samples,
+                          samples_size,
+                          transfer->radio_device.file);
+    }
+    break;
+
+  case SOAPYSDR:
+    if(transfer->direct_access)
+    {
+      n = acquire_read_samples(transfer, &data, samples_size);
+      samples_from_format(transfer, data, n, samples);
+      break;
+    }
+    if(transfer->sample_format == FORMAT_CF32)
+    {
+      buffers[0] = samples;
+    }
+    else
+    {
+      buffers[0] = get_stream_buffer(transfer, samples_size);
+    }
+    r = SoapySDRDevice_readStream(transfer->radio_device.soapysdr,
+                                  transfer->radio_stream.soapysdr,
+                                  buffers,
+                                  samples_size,
+                                  &flags,
+                                  &timestamp,
+                                  10000);
+    if(r >= 0)
+    {
+      n = r;
+      if(transfer->sample_format != FORMAT_CF32)
+      {
+        samples_from_format(transfer, buffers[0], n, samples);
+      }
+      transfer->block_time = (flags & SOAPY_SDR_HAS_TIME) ? timestamp : -1;
+    }
+    else
+    {
+      count_radio_error(transfer, r);
+    }
+    break;
+
+  case LOOPBACK:
+    ringbuffer_wait_readable(transfer->radio_device.loopback,
+                             samples_size,
+                             100);
+    n = ringbuffer_read(transfer->radio_device.loopback, samples, samples_size);
+    break;
+  }
+  if(transfer->radio_type != SOAPYSDR)
+  {
+    count_samples_read(transfer, n);
+  }
+  return(n);
+}
+
+/* Return 1 when the radio won't give more samples, 0 otherwise */
+int end_of_samples(gmsk_transfer_t transfer, unsigned int n)
+{
+  switch(transfer->radio_type)
+  {
+  case IO:
+  case FILENAME:
+    return(n == 0);
+
+  case LOOPBACK:
+    return((n == 0) &&
+           ringbuffer_is_finished(transfer->radio_device.loopback));
+
+  default:
+    return(0);
+  }
+}
+
+/* Get samples from the radio without copying them when they are complex
+ * float samples in the mapped recording of a 'file' radio or in a buffer of
+ * the driver of a SoapySDR radio
+ * Return a pointer to the samples, which is either in the mapping, in the
+ * buffer of the driver or in 'samples'. The samples in the mapping or in
+ * the buffer must not be modified, and they are only valid until the next
+ * call. */
+complex float * receive_samples_from_radio(gmsk_transfer_t transfer,
+                                           complex float *samples,
+                                           unsigned int samples_size,
+                                           unsigned int *n)
+{
+  void *data;
+  const void *read_data;
+
+  if((transfer->radio_type == FILENAME) &&
+     transfer->file_map &&
+     (!transfer->audio_converter) &&
+     (transfer->sample_format == FORMAT_CF32))
+  {
+    *n = map_samples(transfer, &data, samples_size, sizeof(complex float));
+    count_samples_read(transfer, *n);
+    return(data);
+  }
+  if((transfer->radio_type == SOAPYSDR) &&
+     transfer->direct_access &&
+     (transfer->sample_format == FORMAT_CF32))
+  {
+    *n = acquire_read_samples(transfer, &read_data, samples_size);
+    return((complex float *) read_data);
+  }
+
+  *n = receive_from_radio(transfer, samples, samples_size);
+  return(samples);
+}
+
+/* The user header of a frame contains the id of the transfer followed by
+ * the counter of the frame */
+void set_counter(gmsk_transfer_t transfer,
+                 unsigned char *header,
+                 unsigned int counter)
+{
+  unsigned char *c = &header[transfer->header_size - COUNTER_SIZE];
+
+  c[0] = (counter >> 24) & 255;
+  c[1] = (counter >> 16) & 255;
+  c[2] = (counter >> 8) & 255;
+  c[3] = counter & 255;
+}
+
+unsigned int get_counter(gmsk_transfer_t transfer, unsigned char *header)
+{
+  unsigned char *c = &header[transfer->header_size - COUNTER_SIZE];
+
+  return((c[0] << 24) | (c[1] << 16) | (c[2] << 8) | c[3]);
+}
+
+void configure_frame_generator(gmsk_transfer_t transfer,
+                               gmskburstgen frame_generator)
+{
+  gmskburstgen_set_header_len(frame_generator, transfer->header_size);
+  gmskburstgen_set_preamble_len(frame_generator, transfer->preamble_size);
+  if(transfer->ramp_size >= 0)
+  {
+    gmskburstgen_set_ramp_len(frame_generator, transfer->ramp_size);
+  }
+}
+
+/* The objects of the modulation and demodulation are created during the
+ * first run of the transfer and reset during the next ones, to make the
+ * start of the next runs faster */
+gmskburstgen get_frame_generator(gmsk_transfer_t transfer,
+                                 unsigned int samples_per_symbol,
+                                 unsigned int filter_delay,
+                                 float bt)
+{
+  if(transfer->frame_generator)
+  {
+    gmskburstgen_reset(transfer->frame_generator);
+  }
+  else
+  {
+    transfer->frame_generator = gmskburstgen_create(samples_per_symbol,
+                                                    filter_delay,
+                                                    bt);
+  }
+  return(transfer->frame_generator);
+}
+
+msresamp_crcf get_resampler(gmsk_transfer_t transfer, float resampling_ratio)
+{
+  msresamp_crcf *resampler = transfer->emit ?
+    &transfer->tx_resampler :
+    &transfer->rx_resampler;
+
+  if(*resampler)
+  {
+    msresamp_crcf_reset(*resampler);
+  }
+  else
+  {
+    *resampler = msresamp_crcf_create(resampling_ratio, 60);
+  }
+  return(*resampler);
+}
+
+nco_crcf get_oscillator(gmsk_transfer_t transfer)
+{
+  if(transfer->oscillator)
+  {
+    nco_crcf_reset(transfer->oscillator);
+  }
+  else
+  {
+    transfer->oscillator = nco_crcf_create(LIQUID_NCO);
+  }
+  return(transfer->oscillator);
+}
+
+void free_dsp_objects(gmsk_transfer_t transfer)
+{
+  if(transfer->frame_generator)
+  {
+    gmskburstgen_destroy(transfer->frame_generator);
+  }
+  if(transfer->frame_synchronizer)
+  {
+    gmskframesync_destroy(transfer->frame_synchronizer);
+  }
+  if(transfer->tx_resampler)
+  {
+    msresamp_crcf_destroy(transfer->tx_resampler);
+  }
+  if(transfer->rx_resampler)
+  {
+    msresamp_crcf_destroy(transfer->rx_resampler);
+  }
+  if(transfer->oscillator)
+  {
+    nco_crcf_destroy(transfer->oscillator);
+  }
+}
+
+void send_dummy_samples(gmsk_transfer_t transfer,
+                        msresamp_crcf resampler,
+                        nco_crcf oscillator,
+                        complex float *samples,
+                        unsigned int delay,
+                        int last)
+{
+  unsigned int n;
+  complex float zero_samples[delay];
+
+  bzero(zero_samples, delay * sizeof(complex float));
+  msresamp_crcf_execute(resampler, zero_samples, delay, samples, &n);
+  if(transfer->frequency_offset != 0)
+  {
+    nco_crcf_mix_block_up(oscillator, samples, samples, n);
+  }
+  send_to_radio(transfer, samples, n, last);
+}
+
+/* Feed the radio with silence when there is no data to send and it is
+ * about to run out of samples */
+void send_silence(gmsk_transfer_t transfer,
+                  complex float *samples,
+                  unsigned int samples_size)
+{
+  unsigned int n = (transfer->sample_rate * IDLE_SILENCE_DURATION) / 1000;
+
+  if(gmsk_transfer_get_idle_timeout(transfer) > 0)
+  {
+    return;
+  }
+  n = MIN(MAX(n, 1), samples_size);
+  bzero(samples, n * sizeof(complex float));
+  send_to_radio(transfer, samples, n, 0);
+}
+
+unsigned int write_frame_samples(gmskburstgen frame_generator,
+                                 complex float *frame_samples,
+                                 unsigned int frame_samples_size,
+                                 int *frame_complete)
+{
+  unsigned int n = frame_samples_size;
+  unsigned int i;
+  float maximum_amplitude = 1;
+
+  *frame_complete = gmskburstgen_write(frame_generator,
+                                       frame_samples,
+                                       frame_samples_size);
+  if(*frame_complete)
+  {
+    /* Don't send the padding 0 bytes */
+    while((n > 0) && (frame_samples[n - 1] == 0))
+    {
+      n--;
+    }
+  }
+  /* Reduce the amplitude of samples a little because the resampler
+   * may produce samples with an amplitude slightly greater than 1.0
+   * otherwise */
+  for(i = 0; i < n; i++)
+  {
+    if(cabsf(frame_samples[i]) > maximum_amplitude)
+    {
+      maximum_amplitude = cabsf(frame_samples[i]);
+    }
+  }
+  liquid_vectorcf_mulscalar(frame_samples,
+                            n,
+                            0.75 / maximum_amplitude,
+                            frame_samples);
+
+  return(n);
+}
+
+/* Read the payload of the frame following the current one in the burst
+ * With frame aggregation, the frames share the preamble of the burst as long
+ * as the next payload is ready before the radio runs out of samples.
+ * Return the size of the payload, 0 if the current frame ends the burst, or
+ * -1 at the end of the data. */
+int read_burst_payload(gmsk_transfer_t transfer,
+                       unsigned char *payload,
+                       unsigned int payload_size,
+                       unsigned int *burst_size)
+{
+  int r = 0;
+
+  (*burst_size)++;
+  if((*burst_size < transfer->aggregation) && (!stop) && (!transfer->stop))
+  {
+    r = read_payload(transfer, payload, payload_size);
+  }
+  if(r <= 0)
+  {
+    *burst_size = 0;
+  }
+  return(r);
+}
+
+void send_frames(gmsk_transfer_t transfer)
+{
+  float bt = transfer->bt;
+  unsigned int samples_per_symbol = ceilf(1 / bt);
+  unsigned int filter_delay = samples_per_symbol + 1;
+  gmskburstgen frame_generator = get_frame_generator(transfer,
+                                                     samples_per_symbol,
+                                                     filter_delay,
+                                                     bt);
+  float resampling_ratio = (float) transfer->sample_rate / (transfer->bit_rate *
+                                                            samples_per_symbol);
+  msresamp_crcf resampler = get_resampler(transfer, resampling_ratio);
+  unsigned int delay = ceilf(msresamp_crcf_get_delay(resampler));
+  unsigned char header[MAXIMUM_HEADER_SIZE];
+  /* Try to make frames of approximately 100 ms, but containing at least
+   * 16 bytes and at most 8000 bytes of payload */
+  unsigned int byte_rate = transfer->bit_rate / 8;
+  unsigned int payload_size = MIN(MAX(byte_rate * 0.1, 16),
+                                  MAXIMUM_PAYLOAD_SIZE);
+  int r;
+  unsigned int n;
+  /* Process data by blocks of 50 ms */
+  unsigned int frame_samples_size = ceilf((transfer->bit_rate *
+                                           samples_per_symbol) / 20.0);
+  unsigned int samples_size = ceilf((frame_samples_size + delay) * resampling_ratio);
+  int frame_complete;
+  float center_frequency = (float) transfer->frequency_offset / transfer->sample_rate;
+  nco_crcf oscillator = get_oscillator(transfer);
+  unsigned int counter = 0;
+  unsigned int burst_size = 0;
+  int next = 0;
+  long long int payload_time;
+  unsigned char *payload = malloc(payload_size);
+  unsigned char *next_payload = malloc(payload_size);
+  unsigned char *swap;
+  complex float *frame_samples = malloc(frame_samples_size * sizeof(complex float));
+  complex float *samples = malloc(samples_size * sizeof(complex float));
+  complex float *output;
+  int flushed = 1;
+  long long int start;
+
+  if((payload == NULL) ||
+     (next_payload == NULL) ||
+     (frame_samples == NULL) ||
+     (samples == NULL))
+  {
+    fprintf(stderr, _("Error: Memory allocation failed\n"));
+    exit(EXIT_FAILURE);
+  }
+
+  nco_crcf_set_phase(oscillator, 0);
+  nco_crcf_set_frequency(oscillator, TAU * center_frequency);
+
+  configure_frame_generator(transfer, frame_generator);
+  memcpy(header, transfer->id, transfer->header_size - COUNTER_SIZE);
+  set_counter(transfer, header, counter);
+
+  while(((!stop) && (!transfer->stop)) || (next > 0))
+  {
+    start = start_stage(transfer);
+    if(next > 0)
+    {
+      /* The payload of the next frame of the burst has already been read */
+      swap = payload;
+      payload = next_payload;
+      next_payload = swap;
+      r = next;
+    }
+    else
+    {
+      r = read_payload(transfer, payload, payload_size);
+    }
+    if(r < 0)
+    {
+      break;
+    }
+    n = r;
+    payload_time = transfer->payload_time;
+
+    if(n > 0)
+    {
+      next = read_burst_payload(transfer, next_payload, payload_size, &burst_size);
+      end_stage(transfer, STAGE_DATA, &start);
+      gmskburstgen_assemble(frame_generator,
+                            header,
+                            payload,
+                            n,
+                            transfer->crc,
+                            transfer->inner_fec,
+                            transfer->outer_fec,
+                            next > 0);
+      end_stage(transfer, STAGE_ASSEMBLY, &start);
+      frame_complete = 0;
+      while(!frame_complete)
+      {
+        n = write_frame_samples(frame_generator,
+                                frame_samples,
+                                frame_samples_size,
+                                &frame_complete);
+        end_stage(transfer, STAGE_MODULATOR, &start);
+        output = get_radio_buffer(transfer, samples, samples_size);
+        msresamp_crcf_execute(resampler, frame_samples, n, output, &n);
+        end_stage(transfer, STAGE_RESAMPLER, &start);
+        if(transfer->frequency_offset != 0)
+        {
+          nco_crcf_mix_block_up(oscillator, output, output, n);
+          end_stage(transfer, STAGE_OSCILLATOR, &start);
+        }
+        send_to_radio(transfer, output, n, 0);
+        end_stage(transfer, STAGE_RADIO, &start);
+      }
+      record_latency(transfer,
+                     payload_time,
+                     atomic_load(&transfer->radio_time));
+      count_frame_sent(transfer, r);
+      counter++;
+      set_counter(transfer, header, counter);
+      flushed = 0;
+      if(next < 0)
+      {
+        break;
+      }
+    }
+    else if(!flushed)
+    {
+      /* Underrun when reading from stdin. Send some dummy samples to get the
+       * remaining output samples for the end of current frame (because of
+       * resampler and filter delays) and send them */
+      end_stage(transfer, STAGE_DATA, &start);
+      send_dummy_samples(transfer,
+                         resampler,
+                         oscillator,
+                         samples,
+                         delay + filter_delay,
+                         0);
+      end_stage(transfer, STAGE_RADIO, &start);
+      flushed = 1;
+    }
+    else
+    {
+      end_stage(transfer, STAGE_DATA, &start);
+      send_silence(transfer, samples, samples_size);
+      end_stage(transfer, STAGE_RADIO, &start);
+    }
+  }
+
+  /* Send some dummy samples to get the remaining output samples (because of
+   * resampler and filter delays) */
+  send_dummy_samples(transfer,
+                     resampler,
+                     oscillator,
+                     samples,
+                     delay + filter_delay,
+                     1);
+
+  free(samples);
+  free(frame_samples);
+  free(next_payload);
+  free(payload);
+}
+
+void send_frames_audio(gmsk_transfer_t transfer)
+{
+  float bt = transfer->bt;
+  /* The frames are generated directly at the audio sample rate */
+  unsigned int samples_per_symbol = transfer->audio_sample_rate /
+    transfer->bit_rate;
+  unsigned int filter_delay = ceilf(1 / bt) + 1;
+  gmskburstgen frame_generator = get_frame_generator(transfer,
+                                                     samples_per_symbol,
+                                                     filter_delay,
+                                                     bt);
+  audiomod_t modulator = audiomod_create((float) transfer->audio_frequency /
+                                         transfer->audio_sample_rate);
+  unsigned char header[MAXIMUM_HEADER_SIZE];
+  /* Try to make frames of approximately 100 ms, but containing at least
+   * 16 bytes and at most 8000 bytes of payload */
+  unsigned int byte_rate = transfer->bit_rate / 8;
+  unsigned int payload_size = MIN(MAX(byte_rate * 0.1, 16),
+                                  MAXIMUM_PAYLOAD_SIZE);
+  int r;
+  unsigned int n;
+  /* Process data by blocks of 50 ms */
+  unsigned int frame_samples_size = ceilf(transfer->audio_sample_rate / 20.0);
+  /* Silence sent after the frames to let the filters of the receiver
+   * output the end of the last frame */
+  unsigned int silence_size = filter_delay * samples_per_symbol;
+  int frame_complete;
+  unsigned int counter = 0;
+  unsigned int burst_size = 0;
+  int next = 0;
+  long long int payload_time;
+  unsigned char *payload = malloc(payload_size);
+  unsigned char *next_payload = malloc(payload_size);
+  unsigned char *swap;
+  complex float *frame_samples = malloc(frame_samples_size * sizeof(complex float));
+  float *audio = malloc(MAX(frame_samples_size, silence_size) * sizeof(float));
+
+  if((modulator == NULL) ||
+     (payload == NULL) ||
+     (next_payload == NULL) ||
+     (frame_samples == NULL) ||
+     (audio == NULL))
+  {
+    fprintf(stderr, _("Error: Memory allocation failed\n"));
+    exit(EXIT_FAILURE);
+  }
+
+  if(verbose)
+  {
+    fprintf(stderr, _("Info: Using direct audio engine\n"));
+  }
+  configure_frame_generator(transfer, frame_generator);
+  memcpy(header, transfer->id, transfer->header_size - COUNTER_SIZE);
+  set_counter(transfer, header, counter);
+
+  while(((!stop) && (!transfer->stop)) || (next > 0))
+  {
+    if(next > 0)
+    {
+      /* The payload of the next frame of the burst has already been read */
+      swap = payload;
+      payload = next_payload;
+      next_payload = swap;
+      r = next;
+    }
+    else
+    {
+      r = read_payload(transfer, payload, payload_size);
+    }
+    if(r < 0)
+    {
+      break;
+    }
+    n = r;
+    payload_time = transfer->payload_time;
+
+    if(n > 0)
+    {
+      next = read_burst_payload(transfer, next_payload, payload_size, &burst_size);
+      gmskburstgen_assemble(frame_generator,
+                            header,
+                            payload,
+                            n,
+                            transfer->crc,
+                            transfer->inner_fec,
+                            transfer->outer_fec,
+                            next > 0);
+      frame_complete = 0;
+      while(!frame_complete)
+      {
+        n = write_frame_samples(frame_generator,
+                                frame_samples,
+                                frame_samples_size,
+                                &frame_complete);
+        audiomod_execute(modulator, frame_samples, n, audio);
+        send_audio_to_radio(transfer, audio, n);
+      }
+      record_latency(transfer,
+                     payload_time,
+                     atomic_load(&transfer->radio_time));
+      count_frame_sent(transfer, r);
+      counter++;
+      set_counter(transfer, header, counter);
+      if(next < 0)
+      {
+        break;
+      }
+    }
+    else if(gmsk_transfer_get_idle_timeout(transfer) == 0)
+    {
+      /* Underrun when reading from stdin, and the radio needs samples */
+      n = (transfer->audio_sample_rate * IDLE_SILENCE_DURATION) / 1000;
+      n = MIN(n, frame_samples_size);
+      bzero(audio, n * sizeof(float));
+      send_audio_to_radio(transfer, audio, n);
+    }
+  }
+
+  bzero(audio, silence_size * sizeof(float));
+  send_audio_to_radio(transfer, audio, silence_size);
+
+  free(audio);
+  free(frame_samples);
+  free(next_payload);
+  free(payload);
+  audiomod_free(modulator);
+}
+
+typedef enum
+  {
+    SLOT_FREE,
+    SLOT_FILLED,
+    SLOT_ENCODING,
+    SLOT_READY
+  } tx_slot_state_t;
+
+typedef enum
+  {
+    SLOT_FRAME,
+    SLOT_FLUSH,
+    SLOT_SILENCE,
+    SLOT_END
+  } tx_slot_type_t;
+
+typedef struct
+{
+  tx_slot_state_t state;
+  tx_slot_type_t type;
+  unsigned char header[MAXIMUM_HEADER_SIZE];
+  unsigned char *payload;
+  unsigned int payload_size;
+  long long int payload_time;
+  complex float *frame_samples;
+  unsigned int frame_samples_count;
+  unsigned int frame_samples_capacity;
+} tx_slot_t;
+
+typedef struct
+{
+  gmsk_transfer_t transfer;
+  unsigned int samples_per_symbol;
+  unsigned int filter_delay;
+  float resampling_ratio;
+  msresamp_crcf resampler;
+  unsigned int delay;
+  unsigned int frame_samples_size;
+  unsigned int samples_size;
+  tx_slot_t *slots;
+  unsigned int slots_count;
+  unsigned int slots_used;
+  unsigned int slots_high_water;
+  unsigned int encode_index;
+  int encoders_done;
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+  ringbuffer_t samples_ring;
+} tx_pipeline_t;
+
+void encode_slot(tx_pipeline_t *pipeline,
+                 gmskburstgen frame_generator,
+                 tx_slot_t *slot)
+{
+  gmsk_transfer_t transfer = pipeline->transfer;
+  unsigned int size = pipeline->frame_samples_size;
+  int frame_complete = 0;
+
+  gmskburstgen_assemble(frame_generator,
+                        slot->header,
+                        slot->payload,
+                        slot->payload_size,
+                        transfer->crc,
+                        transfer->inner_fec,
+                        transfer->outer_fec,
+                        0);
+  slot->frame_samples_count = 0;
+  while(!frame_complete)
+  {
+    if(slot->frame_samples_count + size > slot->frame_samples_capacity)
+    {
+      slot->frame_samples_capacity = 2 * (slot->frame_samples_capacity + size);
+      slot->frame_samples = realloc(slot->frame_samples,
+                                    slot->frame_samples_capacity *
+                                    sizeof(complex float));
+      if(slot->frame_samples == NULL)
+      {
+        fprintf(stderr, _("Error: Memory allocation failed\n"));
+        exit(EXIT_FAILURE);
+      }
+    }
+    slot->frame_samples_count += write_frame_samples(frame_generator,
+                                                     &slot->frame_samples[slot->frame_samples_count],
+                                                     size,
+                                                     &frame_complete);
+  }
+}
+
+void * tx_encoder_thread(void *arg)
+{
+  tx_pipeline_t *pipeline = (tx_pipeline_t *) arg;
+  gmskburstgen frame_generator = gmskburstgen_create(pipeline->samples_per_symbol,
+                                                     pipeline->filter_delay,
+                                                     pipeline->transfer->bt);
+  tx_slot_t *slot;
+
+  configure_frame_generator(pipeline->transfer, frame_generator);
+
+  pthread_mutex_lock(&pipeline->mutex);
+  while(!pipeline->encoders_done)
+  {
+    slot = &pipeline->slots[pipeline->encode_index % pipeline->slots_count];
+    if(slot->state != SLOT_FILLED)
+    {
+      pthread_cond_wait(&pipeline->cond, &pipeline->mutex);
+      continue;
+    }
+    pipeline->encode_index++;
+    switch(slot->type)
+    {
+    case SLOT_FRAME:
+      slot->state = SLOT_ENCODING;
+      pthread_mutex_unlock(&pipeline->mutex);
+      encode_slot(pipeline, frame_generator, slot);
+      pthread_mutex_lock(&pipeline->mutex);
+      break;
+
+    case SLOT_END:
+      pipeline->encoders_done = 1;
+      break;
+
+    default:
+      break;
+    }
+    slot->state = SLOT_READY;
+    pthread_cond_broadcast(&pipeline->cond);
+  }
+  pthread_mutex_unlock(&pipeline->mutex);
+
+  gmskburstgen_destroy(frame_generator);
+  return(NULL);
+}
+
+void write_dummy_samples(gmsk_transfer_t transfer,
+                         msresamp_crcf resampler,
+                         nco_crcf oscillator,
+                         complex float *samples,
+                         unsigned int delay,
+                         ringbuffer_t ring)
+{
+  unsigned int n;
+  complex float zero_samples[delay];
+
+  bzero(zero_samples, delay * sizeof(complex float));
+  msresamp_crcf_execute(resampler, zero_samples, delay, samples, &n);
+  if(transfer->frequency_offset != 0)
+  {
+    nco_crcf_mix_block_up(oscillator, samples, samples, n);
+  }
+  ringbuffer_write_all(ring, samples, n);
+}
+
+void * tx_modulator_thread(void *arg)
+{
+  tx_pipeline_t *pipeline = (tx_pipeline_t *) arg;
+  gmsk_transfer_t transfer = pipeline->transfer;
+  msresamp_crcf resampler = pipeline->resampler;
+  unsigned int delay = pipeline->delay;
+  nco_crcf oscillator = nco_crcf_create(LIQUID_NCO);
+  unsigned int index = 0;
+  unsigned int i;
+  unsigned int n;
+  tx_slot_t *slot;
+  int end = 0;
+  complex float *samples = malloc(pipeline->samples_size * sizeof(complex float));
+
+  if(samples == NULL)
+  {
+    fprintf(stderr, _("Error: Memory allocation failed\n"));
+    exit(EXIT_FAILURE);
+  }
+
+  nco_crcf_set_phase(oscillator, 0);
+  nco_crcf_set_frequency(oscillator,
+                         TAU * ((float) transfer->frequency_offset /
+                                transfer->sample_rate));
+
+  while(!end)
+  {
+    slot = &pipeline->slots[index % pipeline->slots_count];
+    pthread_mutex_lock(&pipeline->mutex);
+    while(slot->state != SLOT_READY)
+    {
+      pthread_cond_wait(&pipeline->cond, &pipeline->mutex);
+    }
+    pthread_mutex_unlock(&pipeline->mutex);
+
+    switch(slot->type)
+    {
+    case SLOT_FRAME:
+      for(i = 0; i < slot->frame_samples_count; i += pipeline->frame_samples_size)
+      {
+        n = MIN(pipeline->frame_samples_size, slot->frame_samples_count - i);
+        msresamp_crcf_execute(resampler, &slot->frame_samples[i], n, samples, &n);
+        if(transfer->frequency_offset != 0)
+        {
+          nco_crcf_mix_block_up(oscillator, samples, samples, n);
+        }
+        ringbuffer_write_all(pipeline->samples_ring, samples, n);
+      }
+      /* The frame will be sent after the samples waiting in the ring */
+      record_latency(transfer,
+                     slot->payload_time,
+                     MAX(atomic_load(&transfer->radio_time), get_time_us()) +
+                     ((ringbuffer_get_readable(pipeline->samples_ring) *
+                       1000000LL) / transfer->sample_rate));
+      count_frame_sent(transfer, slot->payload_size);
+      break;
+
+    case SLOT_FLUSH:
+      /* Underrun when reading the data. Send some dummy samples to get the
+       * remaining output samples for the end of current frame (because of
+       * resampler and filter delays) */
+      write_dummy_samples(transfer,
+                          resampler,
+                          oscillator,
+                          samples,
+                          delay + pipeline->filter_delay,
+                          pipeline->samples_ring);
+      break;
+
+    case SLOT_SILENCE:
+      n = (transfer->sample_rate * IDLE_SILENCE_DURATION) / 1000;
+      n = MIN(MAX(n, 1), pipeline->samples_size);
+      bzero(samples, n * sizeof(complex float));
+      ringbuffer_write_all(pipeline->samples_ring, samples, n);
+      break;
+
+    case SLOT_END:
+      end = 1;
+      break;
+    }
+
+    pthread_mutex_lock(&pipeline->mutex);
+    slot->state = SLOT_FREE;
+    pipeline->slots_used--;
+    pthread_cond_broadcast(&pipeline->cond);
+    pthread_mutex_unlock(&pipeline->mutex);
+    index++;
+  }
+
+  /* Send some dummy samples to get the remaining output samples (because of
+   * resampler and filter delays) */
+  write_dummy_samples(transfer,
+                      resampler,
+                      oscillator,
+                      samples,
+                      delay + pipeline->filter_delay,
+                      pipeline->samples_ring);
+  ringbuffer_close(pipeline->samples_ring);
+
+  free(samples);
+  nco_crcf_destroy(oscillator);
+  return(NULL);
+}
+
+void * tx_streamer_thread(void *arg)
+{
+  tx_pipeline_t *pipeline = (tx_pipeline_t *) arg;
+  unsigned int n;
+  int last = 0;
+  complex float *samples = malloc(pipeline->samples_size * sizeof(complex float));
+  complex float *output;
+
+  if(samples == NULL)
+  {
+    fprintf(stderr, _("Error: Memory allocation failed\n"));
+    exit(EXIT_FAILURE);
+  }
+
+  while(!last)
+  {
+    ringbuffer_wait_readable(pipeline->samples_ring, 1, 100);
+    output = get_radio_buffer(pipeline->transfer,
+                              samples,
+                              pipeline->samples_size);
+    n = ringbuffer_read(pipeline->samples_ring, output, pipeline->samples_size);
+    last = ringbuffer_is_finished(pipeline->samples_ring);
+    if(last && (n == 0))
+    {
+      output[0] = 0;
+      n = 1;
+    }
+    if(n > 0)
+    {
+      send_to_radio(pipeline->transfer, output, n, last);
+    }
+  }
+
+  free(samples);
+  return(NULL);
+}
+
+void send_frames_pipelined(gmsk_transfer_t transfer)
+{
+  tx_pipeline_t pipeline;
+  unsigned int byte_rate = transfer->bit_rate / 8;
+  unsigned int payload_size = MIN(MAX(byte_rate * 0.1, 16),
+                                  MAXIMUM_PAYLOAD_SIZE);
+  unsigned int encoders_count;
+  unsigned int counter = 0;
+  unsigned int index = 0;
+  unsigned int i;
+  long int cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  pthread_t *encoder_threads;
+  pthread_t modulator_thread;
+  pthread_t streamer_thread;
+  tx_slot_t *slot;
+  int r;
+  int flushed = 1;
+
+  pipeline.transfer = transfer;
+  pipeline.samples_per_symbol = ceilf(1 / transfer->bt);
+  pipeline.filter_delay = pipeline.samples_per_symbol + 1;
+  pipeline.resampling_ratio = (float) transfer->sample_rate /
+    (transfer->bit_rate * pipeline.samples_per_symbol);
+  pipeline.resampler = msresamp_crcf_create(pipeline.resampling_ratio, 60);
+  pipeline.delay = ceilf(msresamp_crcf_get_delay(pipeline.resampler));
+  /* Process data by blocks of 50 ms */
+  pipeline.frame_samples_size = ceilf((transfer->bit_rate *
+                                       pipeline.samples_per_symbol) / 20.0);
+  pipeline.samples_size = ceilf((pipeline.frame_samples_size + pipeline.delay) *
+                                pipeline.resampling_ratio);
+  pipeline.slots_count = transfer->ring_size;
+  pipeline.slots_used = 0;
+  pipeline.slots_high_water = 0;
+  pipeline.encode_index = 0;
+  pipeline.encoders_done = 0;
+  pthread_mutex_init(&pipeline.mutex, NULL);
+  pthread_cond_init(&pipeline.cond, NULL);
+  pipeline.samples_ring = ringbuffer_create(sizeof(complex float),
+                                            transfer->ring_size *
+                                            pipeline.samples_size);
+  pipeline.slots = calloc(pipeline.slots_count, sizeof(tx_slot_t));
+  encoders_count = MAX(MIN(cpus, pipeline.slots_count), 1);
+  encoder_threads = malloc(encoders_count * sizeof(pthread_t));
+  if((pipeline.samples_ring == NULL) ||
+     (pipeline.slots == NULL) ||
+     (encoder_threads == NULL))
+  {
+    fprintf(stderr, _("Error: Memory allocation failed\n"));
+    exit(EXIT_FAILURE);
+  }
+  for(i = 0; i < pipeline.slots_count; i++)
+  {
+    pipeline.slots[i].state = SLOT_FREE;
+    memcpy(pipeline.slots[i].header,
+           transfer->id,
+           transfer->header_size - COUNTER_SIZE);
+    pipeline.slots[i].payload = malloc(payload_size);
+    if(pipeline.slots[i].payload == NULL)
+    {
+      fprintf(stderr, _("Error: Memory allocation failed\n"));
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  for(i = 0; i < encoders_count; i++)
+  {
+    if(pthread_create(&encoder_threads[i],
+                      NULL,
+                      tx_encoder_thread,
+                      &pipeline) != 0)
+    {
+      fprintf(stderr, _("Error: Failed to start pipeline threads\n"));
+      exit(EXIT_FAILURE);
+    }
+  }
+  if((pthread_create(&modulator_thread,
+                     NULL,
+                     tx_modulator_thread,
+                     &pipeline) != 0) ||
+     (pthread_create(&streamer_thread,
+                     NULL,
+                     tx_streamer_thread,
+                     &pipeline) != 0))
+  {
+    fprintf(stderr, _("Error: Failed to start pipeline threads\n"));
+    exit(EXIT_FAILURE);
+  }
+
+  /* The data is read by the calling thread, and the frames are queued for
+   * the encoders in the order of their counter */
+  do
+  {
+    slot = &pipeline.slots[index % pipeline.slots_count];
+    pthread_mutex_lock(&pipeline.mutex);
+    while(slot->state != SLOT_FREE)
+    {
+      pthread_cond_wait(&pipeline.cond, &pipeline.mutex);
+    }
+    pthread_mutex_unlock(&pipeline.mutex);
+
+    if(stop || transfer->stop)
+    {
+      r = -1;
+    }
+    else
+    {
+      r = read_payload(transfer, slot->payload, payload_size);
+    }
+    if(r < 0)
+    {
+      slot->type = SLOT_END;
+    }
+    else if((r == 0) && (!flushed))
+    {
+      slot->type = SLOT_FLUSH;
+      flushed = 1;
+    }
+    else if(r == 0)
+    {
+      if((ringbuffer_get_readable(pipeline.samples_ring) > 0) ||
+         (gmsk_transfer_get_idle_timeout(transfer) > 0))
+      {
+        /* The radio still has samples to send */
+        continue;
+      }
+      slot->type = SLOT_SILENCE;
+    }
+    else
+    {
+      slot->type = SLOT_FRAME;
+      slot->payload_size = r;
+      slot->payload_time = transfer->payload_time;
+      set_counter(transfer, slot->header, counter);
+      counter++;
+      flushed = 0;
+    }
+
+    pthread_mutex_lock(&pipeline.mutex);
+    slot->state = SLOT_FILLED;
+    pipeline.slots_used++;
+    if(pipeline.slots_used > pipeline.slots_high_water)
+    {
+      pipeline.slots_high_water = pipeline.slots_used;
+    }
+    pthread_cond_broadcast(&pipeline.cond);
+    pthread_mutex_unlock(&pipeline.mutex);
+    index++;
+  }
+  while(r >= 0);
+
+  for(i = 0; i < encoders_count; i++)
+  {
+    pthread_join(encoder_threads[i], NULL);
+  }
+  pthread_join(modulator_thread, NULL);
+  pthread_join(streamer_thread, NULL);
+
+  if(verbose)
+  {
+    fprintf(stderr,
+            _("Info: Pipeline high-water marks: frames %u/%u, samples %u/%u\n"),
+            pipeline.slots_high_water,
+            pipeline.slots_count,
+            ringbuffer_get_high_water(pipeline.samples_ring),
+            ringbuffer_get_capacity(pipeline.samples_ring));
+  }
+
+  for(i = 0; i < pipeline.slots_count; i++)
+  {
+    free(pipeline.slots[i].frame_samples);
+    free(pipeline.slots[i].payload);
+  }
+  free(pipeline.slots);
+  free(encoder_threads);
+  ringbuffer_free(pipeline.samples_ring);
+  msresamp_crcf_destroy(pipeline.resampler);
+  pthread_cond_destroy(&pipeline.cond);
+  pthread_mutex_destroy(&pipeline.mutex);
+}
+
+int check_frame(gmsk_transfer_t transfer,
+                unsigned char *header,
+                int header_valid,
+                int payload_valid,
+                unsigned int payload_size)
+{
+  char id[5];
+  unsigned int counter;
+
+  transfer->timeout_start = time(NULL);
+  memcpy(id, header, transfer->header_size - COUNTER_SIZE);
+  id[transfer->header_size - COUNTER_SIZE] = '\0';
+  counter = get_counter(transfer, header);
+
+  /* The payload of a frame for another transfer is not decoded, so the id
+   * must be checked before the payload */
+  if(!header_valid)
+  {
+    atomic_fetch_add_explicit(&transfer->stats.frames_corrupted_header,
+                              1,
+                              memory_order_relaxed);
+    if(verbose)
+    {
+      fprintf(stderr, _("Frame %u for '%s': corrupted header\n"), counter, id);
+      fflush(stderr);
+    }
+    return(0);
+  }
+  else if(memcmp(id, transfer->id, transfer->header_size - COUNTER_SIZE) != 0)
+  {
+    atomic_fetch_add_explicit(&transfer->stats.frames_ignored,
+                              1,
+                              memory_order_relaxed);
+    if(verbose)
+    {
+      fprintf(stderr, _("Frame %u for '%s': ignored\n"), counter, id);
+      fflush(stderr);
+    }
+    return(0);
+  }
+  else if(!payload_valid)
+  {
+    atomic_fetch_add_explicit(&transfer->stats.frames_corrupted_payload,
+                              1,
+                              memory_order_relaxed);
+    if(verbose)
+    {
+      fprintf(stderr, _("Frame %u for '%s': corrupted payload\n"), counter, id);
+      fflush(stderr);
+    }
+    return(0);
+  }
+  atomic_fetch_add_explicit(&transfer->stats.frames_received,
+                            1,
+                            memory_order_relaxed);
+  atomic_fetch_add_explicit(&transfer->stats.bytes_received,
+                            payload_size,
+                            memory_order_relaxed);
+  return(1);
+}
+
+/* Update the signal measures of the statistics with the ones of a frame
+ * whose payload was demodulated */
+void record_signal_stats(gmsk_transfer_t transfer, framesyncstats_s *stats)
+{
+  transfer_stats_t *s = &transfer->stats;
+  unsigned int samples_per_symbol = ceilf(1 / transfer->bt);
+  /* The frequency of the synchronizer is in radians per sample */
+  float cfo = (stats->cfo * transfer->bit_rate * samples_per_symbol) / TAU;
+
+  atomic_store_explicit(&s->rssi, stats->rssi, memory_order_relaxed);
+  atomic_store_explicit(&s->evm, stats->evm, memory_order_relaxed);
+  atomic_store_explicit(&s->cfo, cfo, memory_order_relaxed);
+  atomic_store_explicit(&s->rssi_sum,
+                        atomic_load_explicit(&s->rssi_sum,
+                                             memory_order_relaxed) +
+                        stats->rssi,
+                        memory_order_relaxed);
+  atomic_store_explicit(&s->evm_sum,
+                        atomic_load_explicit(&s->evm_sum,
+                                             memory_order_relaxed) +
+                        stats->evm,
+                        memory_order_relaxed);
+  atomic_store_explicit(&s->cfo_sum,
+                        atomic_load_explicit(&s->cfo_sum,
+                                             memory_order_relaxed) +
+                        cfo,
+                        memory_order_relaxed);
+  atomic_fetch_add_explicit(&s->measured_frames, 1, memory_order_relaxed);
+}
+
+/* Compute the time of the start of the frame on the clock of the radio from
+ * the time of the block of samples containing it */
+void set_frame_time(gmsk_transfer_t transfer, unsigned char *header)
+{
+  long long int frame_start;
+  unsigned int samples_per_symbol = ceilf(1 / transfer->bt);
+
+  if((transfer->block_time < 0) ||
+     transfer->payloads_ring ||
+     (transfer->frame_synchronizer == NULL))
+  {
+    transfer->frame_time = -1;
+    return;
+  }
+  frame_start = gmskframesync_get_frame_start(transfer->frame_synchronizer) -
+    transfer->block_start;
+  transfer->frame_time = transfer->block_time +
+    (frame_start * 1000000000.0) / (transfer->bit_rate * samples_per_symbol);
+  if(verbose)
+  {
+    fprintf(stderr,
+            _("Frame %u: received at %.6f s\n"),
+            get_counter(transfer, header),
+            transfer->frame_time / 1000000000.0);
+    fflush(stderr);
+  }
+}
+
+int frame_received(unsigned char *header,
+                   int header_valid,
+                   unsigned char *payload,
+                   unsigned int payload_size,
+                   int payload_valid,
+                   framesyncstats_s stats,
+                   void *user_data)
+{
+  gmsk_transfer_t transfer = (gmsk_transfer_t) user_data;
+  long long int start;
+
+  if(header_valid && (payload != NULL))
+  {
+    record_signal_stats(transfer, &stats);
+  }
+  if(!check_frame(transfer, header, header_valid, payload_valid, payload_size))
+  {
+    return(0);
+  }
+  set_frame_time(transfer, header);
+  if(transfer->payloads_ring)
+  {
+    /* Pipelined mode, the payload is delivered by another thread */
+    ringbuffer_write_all(transfer->payloads_ring,
+                         &payload_size,
+                         sizeof(payload_size));
+    ringbuffer_write_all(transfer->payloads_ring, payload, payload_size);
+  }
+  else
+  {
+    start = start_stage(transfer);
+    transfer->data_callback(transfer->callback_context, payload, payload_size);
+    transfer->callback_duration += end_stage(transfer, STAGE_DATA, &start);
+  }
+  return(0);
+}
+
+void configure_frame_synchronizer(gmsk_transfer_t transfer,
+                                  gmskframesync frame_synchronizer)
+{
+  gmskframesync_set_preamble_len(frame_synchronizer, transfer->preamble_size);
+  gmskframesync_set_header_len(frame_synchronizer, transfer->header_size);
+  /* Drop the frames for other transfers as soon as their header has been
+   * decoded instead of demodulating and decoding their payload */
+  gmskframesync_set_header_filter(frame_synchronizer,
+                                  (unsigned char *) transfer->id,
+                                  transfer->header_size - COUNTER_SIZE,
+                                  1);
+}
+
+/* See get_frame_generator() */
+gmskframesync get_frame_synchronizer(gmsk_transfer_t transfer,
+                                     unsigned int samples_per_symbol,
+                                     unsigned int filter_delay,
+                                     float bt,
+                                     float dphi_max)
+{
+  if(transfer->frame_synchronizer)
+  {
+    gmskframesync_reset(transfer->frame_synchronizer);
+  }
+  else
+  {
+    transfer->frame_synchronizer = gmskframesync_create_set2(samples_per_symbol,
+                                                             filter_delay,
+                                                             bt,
+                                                             dphi_max,
+                                                             frame_received,
+                                                             transfer);
+  }
+  return(transfer->frame_synchronizer);
+}
+
+squelch_t create_squelch(gmsk_transfer_t transfer)
+{
+  unsigned int sum_length;
+  unsigned int window_length;
+  unsigned int history_size;
+
+  squelch_free(transfer->squelch);
+  transfer->squelch = NULL;
+  if(transfer->squelch_threshold <= 0)
+  {
+    return(NULL);
+  }
+
+  /* Sum the samples over the duration of a bit to keep only the band of the
+   * signal, and measure the power over several bits */
+  sum_length = transfer->sample_rate / transfer->bit_rate;
+  if(sum_length == 0)
+  {
+    sum_length = 1;
+  }
+  window_length = sum_length * SQUELCH_WINDOW_BITS;
+  /* The history must contain the preamble even if it took a whole window
+   * and the delays of the filters to notice it */
+  history_size = ceilf(((float) transfer->sample_rate * SQUELCH_HISTORY_BITS) /
+                       transfer->bit_rate) + window_length;
+  transfer->squelch = squelch_create(sum_length,
+                                     window_length,
+                                     history_size,
+                                     transfer->squelch_threshold);
+  if(transfer->squelch == NULL)
+  {
+    fprintf(stderr, _("Error: Memory allocation failed\n"));
+    exit(EXIT_FAILURE);
+  }
+
+  return(transfer->squelch);
+}
+
+void print_squelch_info(gmsk_transfer_t transfer)
+{
+  unsigned long int samples;
+  unsigned long int gated_samples;
+
+  if(verbose && transfer->squelch)
+  {
+    squelch_get_counters(transfer->squelch, &samples, &gated_samples);
+    fprintf(stderr,
+            _("Info: Squelch: %lu of %lu samples gated (%.1f%%)\n"),
+            gated_samples,
+            samples,
+            (samples > 0) ? (100.0 * gated_samples) / samples : 0.0);
+  }
+}
+
+void receive_frames(gmsk_transfer_t transfer)
+{
+  float bt = transfer->bt;
+  unsigned int samples_per_symbol = ceilf(1 / bt);
+  unsigned int filter_delay = samples_per_symbol + 1;
+  float dphi_max = (TAU * transfer->maximum_deviation) / transfer->bit_rate;
+  gmskframesync frame_synchronizer = get_frame_synchronizer(transfer,
+                                                            samples_per_symbol,
+                                                            filter_delay,
+                                                            bt,
+                                                            dphi_max);
+  float resampling_ratio = (transfer->bit_rate *
+                            samples_per_symbol) / (float) transfer->sample_rate;
+  msresamp_crcf resampler = get_resampler(transfer, resampling_ratio);
+  unsigned int resampler_delay = ceilf(msresamp_crcf_get_delay(resampler));
+  unsigned int delay = filter_delay + resampler_delay;
+  unsigned int n;
+  unsigned int input_size;
+  int opened;
+  complex float *input;
+  squelch_t squelch = create_squelch(transfer);
+  unsigned int history_size = squelch ? squelch_get_history_size(squelch) : 0;
+  /* Process data by blocks of 50 ms */
+  unsigned int frame_samples_size = ceilf((transfer->bit_rate *
+                                           samples_per_symbol) / 20.0);
+  unsigned int samples_size = floorf(frame_samples_size / resampling_ratio);
+  nco_crcf oscillator = get_oscillator(transfer);
+  complex float *frame_samples = malloc((frame_samples_size + delay +
+                                         ceilf(history_size *
+                                               resampling_ratio)) *
+                                        sizeof(complex float));
+  complex float *samples = malloc((samples_size + delay) *
+                                  sizeof(complex float));
+  complex float *gated_samples = malloc((samples_size + history_size) *
+                                        sizeof(complex float));
+  long long int start;
+
+  if((frame_samples == NULL) || (samples == NULL) || (gated_samples == NULL))
+  {
+    fprintf(stderr, _("Error: Memory allocation failed\n"));
+    exit(EXIT_FAILURE);
+  }
+
+  nco_crcf_set_phase(oscillator, 0);
+  nco_crcf_set_frequency(oscillator, TAU * ((float) transfer->frequency_offset /
+                                            transfer->sample_rate));
+  configure_frame_synchronizer(transfer, frame_synchronizer);
+
+  while((!stop) && (!transfer->stop))
+  {
+    start = start_stage(transfer);
+    input = receive_samples_from_radio(transfer, samples, samples_size, &n);
+    end_stage(transfer, STAGE_RADIO, &start);
+    if(end_of_samples(transfer, n))
+    {
+      break;
+    }
+    if((transfer->timeout > 0) &&
+       (time(NULL) > transfer->timeout_start + transfer->timeout))
+    {
+      if(verbose)
+      {
+        fprintf(stderr, _("Timeout: %d s without frames\n"), transfer->timeout);
+      }
+      break;
+    }
+    if(transfer->dump)
+    {
+      dump_samples(transfer, input, n);
+      start = start_stage(transfer);
+    }
+    if(transfer->frequency_offset != 0)
+    {
+      nco_crcf_mix_block_down(oscillator, input, samples, n);
+      input = samples;
+      end_stage(transfer, STAGE_OSCILLATOR, &start);
+    }
+    input_size = n;
+    if(squelch)
+    {
+      /* Skip the resampler and the frame synchronizer while there is only
+       * noise */
+      n = squelch_execute(squelch,
+                          input,
+                          n,
+                          gated_samples,
+                          gmskframesync_is_frame_open(frame_synchronizer),
+                          &opened);
+      end_stage(transfer, STAGE_SQUELCH, &start);
+      if(opened)
+      {
+        /* Don't mix the samples from before the gate closed with the new
+         * ones */
+        msresamp_crcf_reset(resampler);
+        gmskframesync_reset(frame_synchronizer);
+      }
+      if(n == 0)
+      {
+        continue;
+      }
+      /* The gated samples end with the last samples received */
+      if(transfer->block_time >= 0)
+      {
+        transfer->block_time += (((long long int) input_size - n) *
+                                 1000000000.0) / transfer->sample_rate;
+      }
+      msresamp_crcf_execute(resampler, gated_samples, n, frame_samples, &n);
+    }
+    else
+    {
+      msresamp_crcf_execute(resampler, input, n, frame_samples, &n);
+    }
+    end_stage(transfer, STAGE_RESAMPLER, &start);
+    /* The first samples out of the resampler are still from the previous
+     * block */
+    transfer->block_start =
+      gmskframesync_get_num_samples(frame_synchronizer) + resampler_delay;
+    transfer->callback_duration = 0;
+    gmskframesync_execute_filtered(frame_synchronizer, frame_samples, n);
+    /* The time spent in the data callback is measured separately */
+    start += transfer->callback_duration;
+    end_stage(transfer, STAGE_SYNCHRONIZER, &start);
+  }
+
+  for(n = 0; n < delay; n++)
+  {
+    samples[n] = 0;
+  }
+  msresamp_crcf_execute(resampler, samples, delay, frame_samples, &n);
+  gmskframesync_execute_filtered(frame_synchronizer, frame_samples, n);
+  while(gmskframesync_is_frame_open(frame_synchronizer))
+  {
+    gmskframesync_execute_filtered(frame_synchronizer, samples, 1);
+  }
+  print_squelch_info(transfer);
+
+  free(gated_samples);
+  free(samples);
+  free(frame_samples);
+}
+
+void receive_frames_audio(gmsk_transfer_t transfer)
+{
+  float bt = transfer->bt;
+  unsigned int samples_per_symbol = ceilf(1 / bt);
+  unsigned int filter_delay = samples_per_symbol + 1;
+  float dphi_max = (TAU * transfer->maximum_deviation) / transfer->bit_rate;
+  gmskframesync frame_synchronizer = get_frame_synchronizer(transfer,
+                                                            samples_per_symbol,
+                                                            filter_delay,
+                                                            bt,
+                                                            dphi_max);
+  unsigned int decimation = transfer->audio_sample_rate /
+    (transfer->bit_rate * samples_per_symbol);
+  audiodemod_t demodulator = audiodemod_create((float) transfer->audio_frequency /
+                                               transfer->audio_sample_rate,
+                                               decimation);
+  unsigned int delay = filter_delay + audiodemod_get_delay(demodulator);
+  unsigned int n;
+  /* Process data by blocks of 50 ms */
+  unsigned int frame_samples_size = ceilf((transfer->bit_rate *
+                                           samples_per_symbol) / 20.0);
+  unsigned int audio_size = frame_samples_size * decimation;
+  float *audio = malloc(MAX(frame_samples_size, delay) * decimation *
+                        sizeof(float));
+  complex float *frame_samples = malloc(MAX(frame_samples_size, delay) *
+                                        sizeof(complex float));
+
+  if((demodulator == NULL) || (audio == NULL) || (frame_samples == NULL))
+  {
+    fprintf(stderr, _("Error: Memory allocation failed\n"));
+    exit(EXIT_FAILURE);
+  }
+
+  if(verbose)
+  {
+    fprintf(stderr, _("Info: Using direct audio engine\n"));
+  }
+  configure_frame_synchronizer(transfer, frame_synchronizer);
+
+  while((!stop) && (!transfer->stop))
+  {
+    n = receive_audio_from_radio(transfer, audio, audio_size);
+    if(n == 0)
+    {
+      break;
+    }
+    /* The time of the frames is not tracked by the audio engine */
+    transfer->block_time = -1;
+    if((transfer->timeout > 0) &&
+       (time(NULL) > transfer->timeout_start + transfer->timeout))
+    {
+      if(verbose)
+      {
+        fprintf(stderr, _("Timeout: %d s without frames\n"), transfer->timeout);
+      }
+      break;
+    }
+    /* An incomplete group of audio samples can only be at the end of the
+     * input */
+    n /= decimation;
+    audiodemod_execute(demodulator, audio, n, frame_samples);
+    gmskframesync_execute_filtered(frame_synchronizer, frame_samples, n);
+  }
+
+  bzero(audio, delay * decimation * sizeof(float));
+  audiodemod_execute(demodulator, audio, delay, frame_samples);
+  gmskframesync_execute_filtered(frame_synchronizer, frame_samples, delay);
+  bzero(frame_samples, sizeof(complex float));
+  while(gmskframesync_is_frame_open(frame_synchronizer))
+  {
+    gmskframesync_execute_filtered(frame_synchronizer, frame_samples, 1);
+  }
+
+  free(frame_samples);
+  free(audio);
+  audiodemod_free(demodulator);
+}
+
+typedef struct
+{
+  gmsk_transfer_t transfer;
+  msresamp_crcf resampler;
+  nco_crcf oscillator;
+  gmskframesync frame_synchronizer;
+  unsigned int delay;
+  unsigned int samples_size;
+  unsigned int frame_samples_size;
+  squelch_t squelch;
+  atomic_int frame_open;
+  ringbuffer_t samples_ring;
+  ringbuffer_t frame_samples_ring;
+  /* Positions in the frame samples at which the squelch opened */
+  ringbuffer_t resets_ring;
+  ringbuffer_t payloads_ring;
+} rx_pipeline_t;
+
+void * rx_front_end_thread(void *arg)
+{
+  rx_pipeline_t *pipeline = (rx_pipeline_t *) arg;
+  gmsk_transfer_t transfer = pipeline->transfer;
+  unsigned int n;
+  int opened;
+  unsigned long long int position = 0;
+  unsigned int history_size = pipeline->squelch ?
+    squelch_get_history_size(pipeline->squelch) : 0;
+  float resampling_ratio = (float) pipeline->frame_samples_size /
+    pipeline->samples_size;
+  complex float *samples = malloc((pipeline->samples_size + pipeline->delay) *
+                                  sizeof(complex float));
+  complex float *frame_samples = malloc((pipeline->frame_samples_size +
+                                         pipeline->delay +
+                                         ceilf(history_size *
+                                               resampling_ratio)) *
+                                        sizeof(complex float));
+  complex float *gated_samples = malloc((pipeline->samples_size +
+                                         history_size) *
+                                        sizeof(complex float));
+
+  if((samples == NULL) || (frame_samples == NULL) || (gated_samples == NULL))
+  {
+    fprintf(stderr, _("Error: Memory allocation failed\n"));
+    exit(EXIT_FAILURE);
+  }
+
+  while(!ringbuffer_is_finished(pipeline->samples_ring))
+  {
+    ringbuffer_wait_readable(pipeline->samples_ring, 1, 100);
+    n = ringbuffer_read(pipeline->samples_ring,
+                        samples,
+                        pipeline->samples_size);
+    if(n == 0)
+    {
+      continue;
+    }
+    if(transfer->frequency_offset != 0)
+    {
+      nco_crcf_mix_block_down(pipeline->oscillator, samples, samples, n);
+    }
+    if(pipeline->squelch)
+    {
+      /* The state of the frame synchronizer lags behind by the samples
+       * waiting in the ring, the hang time of the squelch covers them */
+      n = squelch_execute(pipeline->squelch,
+                          samples,
+                          n,
+                          gated_samples,
+                          atomic_load(&pipeline->frame_open),
+                          &opened);
+      if(opened)
+      {
+        /* Don't mix the samples from before the gate closed with the new
+         * ones. The marker is written before the samples following it, so
+         * that the frame synchronizer sees it in time. */
+        msresamp_crcf_reset(pipeline->resampler);
+        ringbuffer_write_all(pipeline->resets_ring, &position, 1);
+      }
+      if(n == 0)
+      {
+        continue;
+      }
+      msresamp_crcf_execute(pipeline->resampler,
+                            gated_samples,
+                            n,
+                            frame_samples,
+                            &n);
+    }
+    else
+    {
+      msresamp_crcf_execute(pipeline->resampler,
+                            samples,
+                            n,
+                            frame_samples,
+                            &n);
+    }
+    position += ringbuffer_write_all(pipeline->frame_samples_ring,
+                                     frame_samples,
+                                     n);
+  }
+
+  /* Get the remaining samples from the resampler */
+  for(n = 0; n < pipeline->delay; n++)
+  {
+    samples[n] = 0;
+  }
+  msresamp_crcf_execute(pipeline->resampler,
+                        samples,
+                        pipeline->delay,
+                        frame_samples,
+                        &n);
+  ringbuffer_write_all(pipeline->frame_samples_ring, frame_samples, n);
+  ringbuffer_close(pipeline->frame_samples_ring);
+
+  free(gated_samples);
+  free(frame_samples);
+  free(samples);
+  return(NULL);
+}
+
+void * rx_frame_sync_thread(void *arg)
+{
+  rx_pipeline_t *pipeline = (rx_pipeline_t *) arg;
+  unsigned int n;
+  unsigned long long int position = 0;
+  unsigned long long int reset_position = 0;
+  int reset_pending = 0;
+  complex float zero_sample = 0;
+  complex float *frame_samples = malloc(pipeline->frame_samples_size *
+                                        sizeof(complex float));
+
+  if(frame_samples == NULL)
+  {
+    fprintf(stderr, _("Error: Memory allocation failed\n"));
+    exit(EXIT_FAILURE);
+  }
+
+  while(!ringbuffer_is_finished(pipeline->frame_samples_ring))
+  {
+    ringbuffer_wait_readable(pipeline->frame_samples_ring, 1, 100);
+    /* A marker is visible once the samples following it are */
+    n = MIN(ringbuffer_get_readable(pipeline->frame_samples_ring),
+            pipeline->frame_samples_size);
+    if((!reset_pending) &&
+       (ringbuffer_read(pipeline->resets_ring, &reset_position, 1) == 1))
+    {
+      reset_pending = 1;
+    }
+    if(reset_pending)
+    {
+      if(position == reset_position)
+      {
+        /* The squelch has opened, the next samples begin with its
+         * history */
+        gmskframesync_reset(pipeline->frame_synchronizer);
+        reset_pending = 0;
+        continue;
+      }
+      n = MIN(n, reset_position - position);
+    }
+    n = ringbuffer_read(pipeline->frame_samples_ring, frame_samples, n);
+    position += n;
+    if(n > 0)
+    {
+      gmskframesync_execute_filtered(pipeline->frame_synchronizer,
+                                     frame_samples,
+                                     n);
+      atomic_store(&pipeline->frame_open,
+                   gmskframesync_is_frame_open(pipeline->frame_synchronizer));
+    }
+  }
+  while(gmskframesync_is_frame_open(pipeline->frame_synchronizer))
+  {
+    gmskframesync_execute_filtered(pipeline->frame_synchronizer,
+                                   &zero_sample,
+                                   1);
+  }
+  ringbuffer_close(pipeline->payloads_ring);
+
+  free(frame_samples);
+  return(NULL);
+}
+
+void * rx_delivery_thread(void *arg)
+{
+  rx_pipeline_t *pipeline = (rx_pipeline_t *) arg;
+  gmsk_transfer_t transfer = pipeline->transfer;
+  unsigned int payload_size;
+  unsigned char *payload = malloc(MAXIMUM_PAYLOAD_SIZE);
+
+  if(payload == NULL)
+  {
+    fprintf(stderr, _("Error: Memory allocation failed\n"));
+    exit(EXIT_FAILURE);
+  }
+
+  while(ringbuffer_read_all(pipeline->payloads_ring,
+                            &payload_size,
+                            sizeof(payload_size)) == sizeof(payload_size))
+  {
+    if(ringbuffer_read_all(pipeline->payloads_ring,
+                           payload,
+                           payload_size) < payload_size)
+    {
+      break;
+    }
+    transfer->data_callback(transfer->callback_context, payload, payload_size);
+  }
+
+  free(payload);
+  return(NULL);
+}
+
+void receive_frames_pipelined(gmsk_transfer_t transfer)
+{
+  float bt = transfer->bt;
+  unsigned int samples_per_symbol = ceilf(1 / bt);
+  unsigned int filter_delay = samples_per_symbol + 1;
+  float dphi_max = (TAU * transfer->maximum_deviation) / transfer->bit_rate;
+  float resampling_ratio = (transfer->bit_rate *
+                            samples_per_symbol) / (float) transfer->sample_rate;
+  rx_pipeline_t pipeline;
+  pthread_t front_end_thread;
+  pthread_t frame_sync_thread;
+  pthread_t delivery_thread;
+  unsigned int n;
+  complex float *samples;
+  complex float *input;
+
+  pipeline.transfer = transfer;
+  pipeline.frame_synchronizer = gmskframesync_create_set2(samples_per_symbol,
+                                                          filter_delay,
+                                                          bt,
+                                                          dphi_max,
+                                                          frame_received,
+                                                          transfer);
+  configure_frame_synchronizer(transfer, pipeline.frame_synchronizer);
+  pipeline.resampler = msresamp_crcf_create(resampling_ratio, 60);
+  pipeline.delay = filter_delay + ceilf(msresamp_crcf_get_delay(pipeline.resampler));
+  /* Process data by blocks of 50 ms */
+  pipeline.frame_samples_size = ceilf((transfer->bit_rate *
+                                       samples_per_symbol) / 20.0);
+  pipeline.samples_size = floorf(pipeline.frame_samples_size / resampling_ratio);
+  pipeline.oscillator = nco_crcf_create(LIQUID_NCO);
+  pipeline.squelch = create_squelch(transfer);
+  atomic_init(&pipeline.frame_open, 0);
+  pipeline.samples_ring = ringbuffer_create(sizeof(complex float),
+                                            transfer->ring_size *
+                                            pipeline.samples_size);
+  pipeline.frame_samples_ring = ringbuffer_create(sizeof(complex float),
+                                                  transfer->ring_size *
+                                                  (pipeline.frame_samples_size +
+                                                   pipeline.delay));
+  pipeline.resets_ring = ringbuffer_create(sizeof(unsigned long long int),
+                                           transfer->ring_size);
+  pipeline.payloads_ring = ringbuffer_create(1,
+                                             transfer->ring_size *
+                                             (MAXIMUM_PAYLOAD_SIZE +
+                                              sizeof(unsigned int)));
+  samples = malloc(pipeline.samples_size * sizeof(complex float));
+
+  if((samples == NULL) ||
+     (pipeline.samples_ring == NULL) ||
+     (pipeline.frame_samples_ring == NULL) ||
+     (pipeline.resets_ring == NULL) ||
+     (pipeline.payloads_ring == NULL))
+  {
+    fprintf(stderr, _("Error: Memory allocation failed\n"));
+    exit(EXIT_FAILURE);
+  }
+
+  nco_crcf_set_phase(pipeline.oscillator, 0);
+  nco_crcf_set_frequency(pipeline.oscillator,
+                         TAU * ((float) transfer->frequency_offset /
+                                transfer->sample_rate));
+
+  transfer->payloads_ring = pipeline.payloads_ring;
+  if((pthread_create(&front_end_thread,
+                     NULL,
+                     rx_front_end_thread,
+                     &pipeline) != 0) ||
+     (pthread_create(&frame_sync_thread,
+                     NULL,
+                     rx_frame_sync_thread,
+                     &pipeline) != 0) ||
+     (pthread_create(&delivery_thread,
+                     NULL,
+                     rx_delivery_thread,
+                     &pipeline) != 0))
+  {
+    fprintf(stderr, _("Error: Failed to start pipeline threads\n"));
+    exit(EXIT_FAILURE);
+  }
+
+  /* The radio is read by the calling thread */
+  while((!stop) && (!transfer->stop))
+  {
+    input = receive_samples_from_radio(transfer,
+                                       samples,
+                                       pipeline.samples_size,
+                                       &n);
+    if(end_of_samples(transfer, n))
+    {
+      break;
+    }
+    if((transfer->timeout > 0) &&
+       (time(NULL) > transfer->timeout_start + transfer->timeout))
+    {
+      if(verbose)
+      {
+        fprintf(stderr, _("Timeout: %d s without frames\n"), transfer->timeout);
+      }
+      break;
+    }
+    if(transfer->dump)
+    {
+      dump_samples(transfer, input, n);
+    }
+    ringbuffer_write_all(pipeline.samples_ring, input, n);
+  }
+  ringbuffer_close(pipeline.samples_ring);
+
+  pthread_join(front_end_thread, NULL);
+  pthread_join(frame_sync_thread, NULL);
+  pthread_join(delivery_thread, NULL);
+  transfer->payloads_ring = NULL;
+
+  if(verbose)
+  {
+    fprintf(stderr,
+            _("Info: Ring high-water marks: samples %u/%u, frame samples %u/%u, payloads %u/%u bytes\n"),
+            ringbuffer_get_high_water(pipeline.samples_ring),
+            ringbuffer_get_capacity(pipeline.samples_ring),
+            ringbuffer_get_high_water(pipeline.frame_samples_ring),
+            ringbuffer_get_capacity(pipeline.frame_samples_ring),
+            ringbuffer_get_high_water(pipeline.payloads_ring),
+            ringbuffer_get_capacity(pipeline.payloads_ring));
+  }
+  print_squelch_info(transfer);
+
+  free(samples);
+  ringbuffer_free(pipeline.payloads_ring);
+  ringbuffer_free(pipeline.resets_ring);
+  ringbuffer_free(pipeline.frame_samples_ring);
+  ringbuffer_free(pipeline.samples_ring);
+  nco_crcf_destroy(pipeline.oscillator);
+  msresamp_crcf_destroy(pipeline.resampler);
+  gmskframesync_destroy(pipeline.frame_synchronizer);
+}
+
+typedef struct rx_channelizer_s rx_channelizer_t;
+
+typedef struct
+{
+  rx_channelizer_t *channelizer;
+  unsigned int index;
+  msresamp_crcf resampler;
+  gmskframesync frame_synchronizer;
+  complex float *samples;
+  complex float *frame_samples;
+} rx_channel_t;
+
+typedef struct
+{
+  rx_channelizer_t *channelizer;
+  unsigned int index;
+  pthread_t thread;
+} rx_channel_worker_t;
+
+struct rx_channelizer_s
+{
+  gmsk_transfer_t transfer;
+  rx_channel_t *channels;
+  unsigned int channels_count;
+  rx_channel_worker_t *workers;
+  unsigned int workers_count;
+  unsigned int samples_count;
+  int done;
+  pthread_barrier_t start_barrier;
+  pthread_barrier_t end_barrier;
+  pthread_mutex_t delivery_mutex;
+};
+
+int channel_frame_received(unsigned char *header,
+                           int header_valid,
+                           unsigned char *payload,
+                           unsigned int payload_size,
+                           int payload_valid,
+                           framesyncstats_s stats,
+                           void *user_data)
+{
+  rx_channel_t *channel = (rx_channel_t *) user_data;
+  rx_channelizer_t *channelizer = channel->channelizer;
+  gmsk_transfer_t transfer = channelizer->transfer;
+
+  /* The synchronizers of the channels run on several threads, but the
+   * callbacks are called one at a time */
+  pthread_mutex_lock(&channelizer->delivery_mutex);
+  if(header_valid && (payload != NULL))
+  {
+    record_signal_stats(transfer, &stats);
+  }
+  if(check_frame(transfer, header, header_valid, payload_valid, payload_size))
+  {
+    if(transfer->channel_callback)
+    {
+      transfer->channel_callback(transfer->callback_context,
+                                 channel->index,
+                                 payload,
+                                 payload_size);
+    }
+    else
+    {
+      transfer->data_callback(transfer->callback_context,
+                              payload,
+                              payload_size);
+    }
+  }
+  pthread_mutex_unlock(&channelizer->delivery_mutex);
+  return(0);
+}
+
+void * rx_channel_thread(void *arg)
+{
+  rx_channel_worker_t *worker = (rx_channel_worker_t *) arg;
+  rx_channelizer_t *channelizer = worker->channelizer;
+  rx_channel_t *channel;
+  unsigned int i;
+  unsigned int n;
+
+  while(1)
+  {
+    pthread_barrier_wait(&channelizer->start_barrier);
+    if(channelizer->done)
+    {
+      break;
+    }
+    for(i = worker->index;
+        i < channelizer->channels_count;
+        i += channelizer->workers_count)
+    {
+      channel = &channelizer->channels[i];
+      msresamp_crcf_execute(channel->resampler,
+                            channel->samples,
+                            channelizer->samples_count,
+                            channel->frame_samples,
+                            &n);
+      gmskframesync_execute_filtered(channel->frame_synchronizer,
+                                     channel->frame_samples,
+                                     n);
+    }
+    pthread_barrier_wait(&channelizer->end_barrier);
+  }
+
+  return(NULL);
+}
+
+void receive_frames_channelized(gmsk_transfer_t transfer)
+{
+  float bt = transfer->bt;
+  unsigned int samples_per_symbol = ceilf(1 / bt);
+  unsigned int filter_delay = samples_per_symbol + 1;
+  float dphi_max = (TAU * transfer->maximum_deviation) / transfer->bit_rate;
+  unsigned int channels_count = transfer->channels;
+  unsigned int decimation = channels_count / 2;
+  float channel_sample_rate = (float) transfer->sample_rate / decimation;
+  float resampling_ratio = (transfer->bit_rate *
+                            samples_per_symbol) / channel_sample_rate;
+  long int cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  firpfbch2_crcf channelizer_bank = firpfbch2_crcf_create_kaiser(LIQUID_ANALYZER,
+                                                                 channels_count,
+                                                                 4,
+                                                                 60);
+  nco_crcf oscillator = nco_crcf_create(LIQUID_NCO);
+  rx_channelizer_t channelizer;
+  rx_channel_t *channel;
+  unsigned int delay;
+  unsigned int frame_samples_size;
+  unsigned int samples_size;
+  unsigned int i;
+  unsigned int j;
+  unsigned int n;
+  complex float zero_sample = 0;
+  complex float *samples;
+  complex float *outputs;
+
+  /* Process data by blocks of approximately 50 ms, containing a whole
+   * number of inputs of the channelizer */
+  samples_size = ceilf(transfer->sample_rate / 20.0 / decimation) * decimation;
+  channelizer.transfer = transfer;
+  channelizer.channels_count = channels_count;
+  channelizer.samples_count = 0;
+  channelizer.done = 0;
+  channelizer.workers_count = MAX(MIN(cpus, channels_count), 1);
+  channelizer.channels = calloc(channels_count, sizeof(rx_channel_t));
+  channelizer.workers = calloc(channelizer.workers_count,
+                               sizeof(rx_channel_worker_t));
+  samples = malloc(samples_size * sizeof(complex float));
+  outputs = malloc(channels_count * sizeof(complex float));
+  if((channelizer.channels == NULL) ||
+     (channelizer.workers == NULL) ||
+     (samples == NULL) ||
+     (outputs == NULL))
+  {
+    fprintf(stderr, _("Error: Memory allocation failed\n"));
+    exit(EXIT_FAILURE);
+  }
+  for(i = 0; i < channels_count; i++)
+  {
+    channel = &channelizer.channels[i];
+    channel->channelizer = &channelizer;
+    channel->index = i;
+    channel->frame_synchronizer = gmskframesync_create_set2(samples_per_symbol,
+                                                            filter_delay,
+                                                            bt,
+                                                            dphi_max,
+                                                            channel_frame_received,
+                                                            channel);
+    configure_frame_synchronizer(transfer, channel->frame_synchronizer);
+    channel->resampler = msresamp_crcf_create(resampling_ratio, 60);
+    delay = filter_delay + ceilf(msresamp_crcf_get_delay(channel->resampler));
+    frame_samples_size = ceilf((samples_size / decimation + delay) *
+                               resampling_ratio) + 1;
+    channel->samples = malloc((samples_size / decimation + delay) *
+                              sizeof(complex float));
+    channel->frame_samples = malloc(frame_samples_size * sizeof(complex float));
+    if((channel->samples == NULL) || (channel->frame_samples == NULL))
+    {
+      fprintf(stderr, _("Error: Memory allocation failed\n"));
+      exit(EXIT_FAILURE);
+    }
+  }
+  pthread_barrier_init(&channelizer.start_barrier,
+                       NULL,
+                       channelizer.workers_count + 1);
+  pthread_barrier_init(&channelizer.end_barrier,
+                       NULL,
+                       channelizer.workers_count + 1);
+  pthread_mutex_init(&channelizer.delivery_mutex, NULL);
+  for(i = 0; i < channelizer.workers_count; i++)
+  {
+    channelizer.workers[i].channelizer = &channelizer;
+    channelizer.workers[i].index = i;
+    if(pthread_create(&channelizer.workers[i].thread,
+                      NULL,
+                      rx_channel_thread,
+                      &channelizer.workers[i]) != 0)
+    {
+      fprintf(stderr, _("Error: Failed to start channel threads\n"));
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  nco_crcf_set_phase(oscillator, 0);
+  nco_crcf_set_frequency(oscillator, TAU * ((float) transfer->frequency_offset /
+                                            transfer->sample_rate));
+
+  while((!stop) && (!transfer->stop))
+  {
+    n = receive_from_radio(transfer, samples, samples_size);
+    if(end_of_samples(transfer, n))
+    {
+      break;
+    }
+    if((transfer->timeout > 0) &&
+       (time(NULL) > transfer->timeout_start + transfer->timeout))
+    {
+      if(verbose)
+      {
+        fprintf(stderr, _("Timeout: %d s without frames\n"), transfer->timeout);
+      }
+      break;
+    }
+    if(transfer->dump)
+    {
+      dump_samples(transfer, samples, n);
+    }
+    if(transfer->frequency_offset != 0)
+    {
+      nco_crcf_mix_block_down(oscillator, samples, samples, n);
+    }
+
+    /* Split the block into channels, then let the workers resample and
+     * synchronize them */
+    for(i = 0; i + decimation <= n; i += decimation)
+    {
+      firpfbch2_crcf_execute(channelizer_bank, &samples[i], outputs);
+      for(j = 0; j < channels_count; j++)
+      {
+        channelizer.channels[j].samples[i / decimation] = outputs[j];
+      }
+    }
+    channelizer.samples_count = i / decimation;
+    pthread_barrier_wait(&channelizer.start_barrier);
+    pthread_barrier_wait(&channelizer.end_barrier);
+  }
+
+  channelizer.done = 1;
+  pthread_barrier_wait(&channelizer.start_barrier);
+  for(i = 0; i < channelizer.workers_count; i++)
+  {
+    pthread_join(channelizer.workers[i].thread, NULL);
+  }
+
+  for(i = 0; i < channels_count; i++)
+  {
+    channel = &channelizer.channels[i];
+    delay = filter_delay + ceilf(msresamp_crcf_get_delay(channel->resampler));
+    for(j = 0; j < delay; j++)
+    {
+      channel->samples[j] = 0;
+    }
+    msresamp_crcf_execute(channel->resampler,
+                          channel->samples,
+                          delay,
+                          channel->frame_samples,
+                          &n);
+    gmskframesync_execute_filtered(channel->frame_synchronizer,
+                                   channel->frame_samples,
+                                   n);
+    while(gmskframesync_is_frame_open(channel->frame_synchronizer))
+    {
+      gmskframesync_execute_filtered(channel->frame_synchronizer,
+                                     &zero_sample,
+                                     1);
+    }
+
+    free(channel->frame_samples);
+    free(channel->samples);
+    msresamp_crcf_destroy(channel->resampler);
+    gmskframesync_destroy(channel->frame_synchronizer);
+  }
+
+  pthread_mutex_destroy(&channelizer.delivery_mutex);
+  pthread_barrier_destroy(&channelizer.end_barrier);
+  pthread_barrier_destroy(&channelizer.start_barrier);
+  free(outputs);
+  free(samples);
+  free(channelizer.workers);
+  free(channelizer.channels);
+  nco_crcf_destroy(oscillator);
+  firpfbch2_crcf_destroy(channelizer_bank);
+}
+
+/* Offline decoding of a recording
+ * The recording is split into chunks decoded in parallel by independent
+ * frame synchronizers. Consecutive chunks overlap by more than the length of
+ * the longest frame, so each frame is entirely contained in at least one
+ * chunk. A frame belongs to the chunk in which it ends after the overlap,
+ * and frames ending close to the boundary between two chunks, which can be
+ * decoded by both, are merged using their counter. */
+typedef struct
+{
+  unsigned long int position;
+  unsigned char header[8];
+  int header_valid;
+  int payload_valid;
+  unsigned char *payload;
+  unsigned int payload_size;
+  /* Signal measures, when the payload was demodulated */
+  int measured;
+  framesyncstats_s stats;
+} offline_frame_t;
+
+typedef struct
+{
+  /* Positions in samples from the beginning of the recording */
+  unsigned long int start;
+  unsigned long int end;
+  unsigned long int owned_start;
+  unsigned long int owned_end;
+  unsigned long int position;
+  offline_frame_t *frames;
+  unsigned int frames_count;
+  unsigned int frames_capacity;
+  int done;
+} offline_chunk_t;
+
+typedef struct
+{
+  gmsk_transfer_t transfer;
+  int fd;
+  off_t data_offset;
+  unsigned int sample_size;
+  unsigned long int tolerance;
+  offline_chunk_t *chunks;
+  unsigned int chunks_count;
+  unsigned int next_chunk;
+  unsigned int output_chunk;
+  unsigned int max_chunks_ahead;
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+} offline_decoder_t;
+
+int offline_frame_received(unsigned char *header,
+                           int header_valid,
+                           unsigned char *payload,
+                           unsigned int payload_size,
+                           int payload_valid,
+                           framesyncstats_s stats,
+                           void *user_data)
+{
+  offline_chunk_t *chunk = (offline_chunk_t *) user_data;
+  offline_frame_t *frame;
+
+  if(chunk->frames_count == chunk->frames_capacity)
+  {
+    chunk->frames_capacity = MAX(16, chunk->frames_capacity * 2);
+    chunk->frames = realloc(chunk->frames,
+                            chunk->frames_capacity * sizeof(offline_frame_t));
+    if(chunk->frames == NULL)
+    {
+      fprintf(stderr, _("Error: Memory allocation failed\n"));
+      exit(EXIT_FAILURE);
+    }
+  }
+  frame = &chunk->frames[chunk->frames_count];
+  frame->position = chunk->position;
+  memcpy(frame->header, header, 8);
+  frame->header_valid = header_valid;
+  frame->payload_valid = payload_valid;
+  frame->payload = NULL;
+  frame->payload_size = 0;
+  frame->measured = header_valid && (payload != NULL);
+  frame->stats = stats;
+  if(header_valid && payload_valid && (payload_size > 0))
+  {
+    frame->payload = malloc(payload_size);
+    if(frame->payload == NULL)
+    {
+      fprintf(stderr, _("Error: Memory allocation failed\n"));
+      exit(EXIT_FAILURE);
+    }
+    memcpy(frame->payload, payload, payload_size);
+    frame->payload_size = payload_size;
+  }
+  chunk->frames_count++;
+  return(0);
+}
+
+/* Give the samples to the frame synchronizer one symbol at a time to know
+ * where the frames end */
+void offline_synchronize(gmskframesync frame_synchronizer,
+                         offline_chunk_t *chunk,
+                         complex float *frame_samples,
+                         unsigned int frame_samples_size,
+                         unsigned int samples_per_symbol,
+                         unsigned long int *frame_position,
+                         float resampling_ratio)
+{
+  unsigned int i;
+  unsigned int n;
+
+  for(i = 0; i < frame_samples_size; i += n)
+  {
+    n = MIN(samples_per_symbol, frame_samples_size - i);
+    *frame_position += n;
+    chunk->position = chunk->start + (*frame_position / resampling_ratio);
+    gmskframesync_execute_filtered(frame_synchronizer, &frame_samples[i], n);
+  }
+}
+
+void decode_offline_chunk(offline_decoder_t *decoder, offline_chunk_t *chunk)
+{
+  gmsk_transfer_t transfer = decoder->transfer;
+  float bt = transfer->bt;
+  unsigned int samples_per_symbol = ceilf(1 / bt);
+  unsigned int filter_delay = samples_per_symbol + 1;
+  float dphi_max = (TAU * transfer->maximum_deviation) / transfer->bit_rate;
+  gmskframesync frame_synchronizer = gmskframesync_create_set2(samples_per_symbol,
+                                                               filter_delay,
+                                                               bt,
+                                                               dphi_max,
+                                                               offline_frame_received,
+                                                               chunk);
+  float resampling_ratio = (transfer->bit_rate *
+                            samples_per_symbol) / (float) transfer->sample_rate;
+  msresamp_crcf resampler = msresamp_crcf_create(resampling_ratio, 60);
+  unsigned int delay = filter_delay + ceilf(msresamp_crcf_get_delay(resampler));
+  /* Process data by blocks of 50 ms */
+  unsigned int frame_samples_size = ceilf((transfer->bit_rate *
+                                           samples_per_symbol) / 20.0);
+  unsigned int samples_size = floorf(frame_samples_size / resampling_ratio);
+  nco_crcf oscillator = nco_crcf_create(LIQUID_NCO);
+  firhilbf audio_converter = NULL;
+  unsigned long int position = chunk->start;
+  unsigned long int frame_position = 0;
+  unsigned int n;
+  ssize_t r;
+  complex float zero_sample = 0;
+  unsigned char *raw;
+  complex float *input;
+  unsigned char *raw_samples = malloc(samples_size * decoder->sample_size);
+  complex float *frame_samples = malloc((frame_samples_size + delay) *
+                                        sizeof(complex float));
+  complex float *samples = malloc((samples_size + delay) *
+                                  sizeof(complex float));
+
+  if((raw_samples == NULL) || (frame_samples == NULL) || (samples == NULL))
+  {
+    fprintf(stderr, _("Error: Memory allocation failed\n"));
+    exit(EXIT_FAILURE);
+  }
+
+  if(transfer->audio_converter)
+  {
+    audio_converter = firhilbf_create(25, 60);
+  }
+  nco_crcf_set_phase(oscillator, 0);
+  nco_crcf_set_frequency(oscillator, TAU * ((float) transfer->frequency_offset /
+                                            transfer->sample_rate));
+  configure_frame_synchronizer(transfer, frame_synchronizer);
+
+  while((position < chunk->end) && (!stop) && (!transfer->stop))
+  {
+    n = MIN(samples_size, chunk->end - position);
+    if(transfer->file_map)
+    {
+      raw = transfer->file_map + decoder->data_offset +
+        (position * decoder->sample_size);
+    }
+    else
+    {
+      r = pread(decoder->fd,
+                raw_samples,
+                n * decoder->sample_size,
+                decoder->data_offset + (position * decoder->sample_size));
+      if(r < (ssize_t) decoder->sample_size)
+      {
+        break;
+      }
+      n = r / decoder->sample_size;
+      raw = raw_samples;
+    }
+    if(audio_converter)
+    {
+      audio_to_iq(audio_converter,
+                  transfer->audio_gain,
+                  (short int *) raw,
+                  n,
+                  samples);
+      input = samples;
+    }
+    else if(transfer->sample_format != FORMAT_CF32)
+    {
+      samples_from_format(transfer, raw, n, samples);
+      input = samples;
+    }
+    else
+    {
+      input = (complex float *) raw;
+    }
+    if(transfer->frequency_offset != 0)
+    {
+      nco_crcf_mix_block_down(oscillator, input, samples, n);
+      input = samples;
+    }
+    position += n;
+    msresamp_crcf_execute(resampler, input, n, frame_samples, &n);
+    offline_synchronize(frame_synchronizer,
+                        chunk,
+                        frame_samples,
+                        n,
+                        samples_per_symbol,
+                        &frame_position,
+                        resampling_ratio);
+  }
+
+  for(n = 0; n < delay; n++)
+  {
+    samples[n] = 0;
+  }
+  msresamp_crcf_execute(resampler, samples, delay, frame_samples, &n);
+  offline_synchronize(frame_synchronizer,
+                      chunk,
+                      frame_samples,
+                      n,
+                      samples_per_symbol,
+                      &frame_position,
+                      resampling_ratio);
+  while(gmskframesync_is_frame_open(frame_synchronizer))
+  {
+    offline_synchronize(frame_synchronizer,
+                        chunk,
+                        &zero_sample,
+                        1,
+                        samples_per_symbol,
+                        &frame_position,
+                        resampling_ratio);
+  }
+
+  free(samples);
+  free(frame_samples);
+  free(raw_samples);
+  if(audio_converter)
+  {
+    firhilbf_destroy(audio_converter);
+  }
+  nco_crcf_destroy(oscillator);
+  msresamp_crcf_destroy(resampler);
+  gmskframesync_destroy(frame_synchronizer);
+}
+
+void * offline_decoder_thread(void *arg)
+{
+  offline_decoder_t *decoder = (offline_decoder_t *) arg;
+  unsigned int i;
+
+  while(1)
+  {
+    pthread_mutex_lock(&decoder->mutex);
+    /* Don't get too far ahead of the output to limit the memory used by
+     * the decoded frames */
+    while((decoder->next_chunk < decoder->chunks_count) &&
+          (decoder->next_chunk >= (decoder->output_chunk +
+                                   decoder->max_chunks_ahead)))
+    {
+      pthread_cond_wait(&decoder->cond, &decoder->mutex);
+    }
+    if(decoder->next_chunk >= decoder->chunks_count)
+    {
+      pthread_mutex_unlock(&decoder->mutex);
+      break;
+    }
+    i = decoder->next_chunk;
+    decoder->next_chunk++;
+    pthread_mutex_unlock(&decoder->mutex);
+
+    decode_offline_chunk(decoder, &decoder->chunks[i]);
+
+    pthread_mutex_lock(&decoder->mutex);
+    decoder->chunks[i].done = 1;
+    pthread_cond_broadcast(&decoder->cond);
+    pthread_mutex_unlock(&decoder->mutex);
+  }
+
+  return(NULL);
+}
+
+/* Return 1 if a frame has already been delivered with the previous chunk */
+int offline_frame_is_duplicate(offline_decoder_t *decoder,
+                               offline_chunk_t *previous_chunk,
+                               offline_chunk_t *chunk,
+                               offline_frame_t *frame)
+{
+  unsigned int i;
+  offline_frame_t *f;
+
+  if((previous_chunk == NULL) ||
+     (!frame->header_valid) ||
+     (!frame->payload_valid) ||
+     (frame->position >= chunk->owned_start + (2 * decoder->tolerance)))
+  {
+    return(0);
+  }
+  for(i = previous_chunk->frames_count; i > 0; i--)
+  {
+    f = &previous_chunk->frames[i - 1];
+    if(f->position < previous_chunk->owned_end - (2 * decoder->tolerance))
+    {
+      break;
+    }
+    if(f->header_valid &&
+       f->payload_valid &&
+       (f->position < previous_chunk->owned_end) &&
+       (memcmp(f->header,
+               frame->header,
+               decoder->transfer->header_size) == 0))
+    {
+      return(1);
+    }
+  }
+  return(0);
+}
+
+void free_offline_chunk(offline_chunk_t *chunk)
+{
+  unsigned int i;
+
+  for(i = 0; i < chunk->frames_count; i++)
+  {
+    free(chunk->frames[i].payload);
+  }
+  free(chunk->frames);
+  chunk->frames = NULL;
+  chunk->frames_count = 0;
+}
+
+void receive_frames_offline(gmsk_transfer_t transfer)
+{
+  offline_decoder_t decoder;
+  offline_chunk_t *chunk;
+  offline_chunk_t *previous_chunk = NULL;
+  offline_frame_t *frame;
+  struct stat file_stat;
+  unsigned int byte_rate = transfer->bit_rate / 8;
+  unsigned int payload_size = MIN(MAX(byte_rate * 0.1, 16),
+                                  MAXIMUM_PAYLOAD_SIZE);
+  unsigned int frame_bits;
+  unsigned long int samples_count;
+  unsigned long int overlap;
+  unsigned long int step;
+  unsigned long int boundary;
+  pthread_t *threads;
+  unsigned int threads_count;
+  unsigned int i;
+  unsigned int j;
+
+  decoder.transfer = transfer;
+  decoder.fd = fileno(transfer->radio_device.file);
+  decoder.data_offset = transfer->file_map ?
+    (off_t) transfer->file_position : ftello(transfer->radio_device.file);
+  decoder.sample_size = transfer->audio_converter ?
+    2 * sizeof(short int) : transfer->sample_bytes;
+  if((fstat(decoder.fd, &file_stat) != 0) ||
+     (!S_ISREG(file_stat.st_mode)) ||
+     (decoder.data_offset < 0))
+  {
+    if(verbose)
+    {
+      fprintf(stderr,
+              _("Info: Not a regular file, parallel decoding disabled\n"));
+    }
+    receive_frames(transfer);
+    return;
+  }
+  samples_count = (file_stat.st_size - decoder.data_offset) /
+    decoder.sample_size;
+  if(transfer->file_map)
+  {
+    /* The threads read different parts of the mapping at the same time */
+    madvise(transfer->file_map, transfer->file_size, MADV_NORMAL);
+  }
+
+  /* The overlap must contain the longest frame a transmitter can send, even
+   * with the forward error correction codes having the lowest rate, and the
+   * delays of the filters */
+  frame_bits = 8 * packetizer_compute_enc_msg_len(payload_size,
+                                                  LIQUID_CRC_32,
+                                                  LIQUID_FEC_REP5,
+                                                  LIQUID_FEC_REP5);
+  overlap = ceilf(((float) transfer->sample_rate *
+                   (frame_bits + OFFLINE_MARGIN_BITS)) / transfer->bit_rate);
+  decoder.tolerance = ceilf(((float) transfer->sample_rate *
+                             OFFLINE_TOLERANCE_BITS) / transfer->bit_rate);
+  step = MAX(transfer->sample_rate * OFFLINE_CHUNK_DURATION,
+             OFFLINE_CHUNK_OVERLAPS * overlap);
+  decoder.chunks_count = (samples_count > overlap) ?
+    ((samples_count - overlap + step - 1) / step) : 1;
+  decoder.chunks = calloc(decoder.chunks_count, sizeof(offline_chunk_t));
+  if(decoder.chunks == NULL)
+  {
+    fprintf(stderr, _("Error: Memory allocation failed\n"));
+    exit(EXIT_FAILURE);
+  }
+  for(i = 0; i < decoder.chunks_count; i++)
+  {
+    chunk = &decoder.chunks[i];
+    chunk->start = i * step;
+    /* Boundary between this chunk and the next one */
+    boundary = ((i + 1) * step) + overlap;
+    if(i == decoder.chunks_count - 1)
+    {
+      chunk->end = samples_count;
+      chunk->owned_end = ULONG_MAX;
+    }
+    else
+    {
+      chunk->end = MIN(boundary + (2 * decoder.tolerance), samples_count);
+      chunk->owned_end = boundary + decoder.tolerance;
+    }
+    chunk->owned_start = (i == 0) ? 0 : ((i * step) + overlap -
+                                         decoder.tolerance);
+  }
+
+  threads_count = MIN(transfer->jobs, decoder.chunks_count);
+  decoder.next_chunk = 0;
+  decoder.output_chunk = 0;
+  decoder.max_chunks_ahead = 2 * threads_count;
+  pthread_mutex_init(&decoder.mutex, NULL);
+  pthread_cond_init(&decoder.cond, NULL);
+  threads = malloc(threads_count * sizeof(pthread_t));
+  if(threads == NULL)
+  {
+    fprintf(stderr, _("Error: Memory allocation failed\n"));
+    exit(EXIT_FAILURE);
+  }
+  if(verbose)
+  {
+    fprintf(stderr,
+            _("Info: Decoding %lu samples in %u chunks on %u threads\n"),
+            samples_count,
+            decoder.chunks_count,
+            threads_count);
+  }
+  for(i = 0; i < threads_count; i++)
+  {
+    if(pthread_create(&threads[i],
+                      NULL,
+                      offline_decoder_thread,
+                      &decoder) != 0)
+    {
+      fprintf(stderr, _("Error: Failed to start decoding threads\n"));
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  /* Deliver the frames in the order of the recording */
+  for(i = 0; i < decoder.chunks_count; i++)
+  {
+    chunk = &decoder.chunks[i];
+    pthread_mutex_lock(&decoder.mutex);
+    while(!chunk->done)
+    {
+      pthread_cond_wait(&decoder.cond, &decoder.mutex);
+    }
+    pthread_mutex_unlock(&decoder.mutex);
+
+    /* When the transfer is interrupted, the threads stop decoding and the
+     * remaining chunks are skipped */
+    for(j = 0; (j < chunk->frames_count) && (!stop) && (!transfer->stop); j++)
+    {
+      frame = &chunk->frames[j];
+      if((frame->position < chunk->owned_start) ||
+         (frame->position >= chunk->owned_end) ||
+         offline_frame_is_duplicate(&decoder, previous_chunk, chunk, frame))
+      {
+        continue;
+      }
+      if(frame->measured)
+      {
+        record_signal_stats(transfer, &frame->stats);
+      }
+      if(check_frame(transfer,
+                     frame->header,
+                     frame->header_valid,
+                     frame->payload_valid,
+                     frame->payload_size))
+      {
+        transfer->data_callback(transfer->callback_context,
+                                frame->payload,
+                                frame->payload_size);
+      }
+    }
+
+    if(previous_chunk)
+    {
+      free_offline_chunk(previous_chunk);
+    }
+    previous_chunk = chunk;
+    pthread_mutex_lock(&decoder.mutex);
+    decoder.output_chunk++;
+    pthread_cond_broadcast(&decoder.cond);
+    pthread_mutex_unlock(&decoder.mutex);
+  }
+  if(previous_chunk)
+  {
+    free_offline_chunk(previous_chunk);
+  }
+
+  for(i = 0; i < threads_count; i++)
+  {
+    pthread_join(threads[i], NULL);
+  }
+  free(threads);
+  pthread_cond_destroy(&decoder.cond);
+  pthread_mutex_destroy(&decoder.mutex);
+  free(decoder.chunks);
+}
+
+/* Set the gain of the radio in the current direction of the transfer */
+void set_radio_gain(gmsk_transfer_t transfer, char *gain)
+{
+  int direction = transfer->emit ? SOAPY_SDR_TX : SOAPY_SDR_RX;
+  SoapySDRKwargs kwargs;
+  unsigned int n;
+  char *gain_name;
+  int gain_value;
+
+  if(strchr(gain, '='))
+  {
+    kwargs = SoapySDRKwargs_fromString(gain);
+    for(n = 0; n < kwargs.size; n++)
+    {
+      gain_name = kwargs.keys[n];
+      gain_value = strtoul(kwargs.vals[n], NULL, 10);
+      SOAPYSDR_CHECK(SoapySDRDevice_setGainElement(transfer->radio_device.soapysdr,
+                                                   direction,
+                                                   transfer->radio_channel,
+                                                   gain_name,
+                                                   gain_value));
+    }
+    SoapySDRKwargs_clear(&kwargs);
+  }
+  else
+  {
+    gain_value = strtoul(gain, NULL, 10);
+    SOAPYSDR_CHECK(SoapySDRDevice_setGain(transfer->radio_device.soapysdr,
+                                          direction,
+                                          transfer->radio_channel,
+                                          gain_value));
+  }
+}
+
+/* Get the name of a sample format for SoapySDR */
+char * get_soapysdr_format(sample_format_t sample_format)
+{
+  switch(sample_format)
+  {
+  case FORMAT_CS16:
+    return(SOAPY_SDR_CS16);
+
+  case FORMAT_CS8:
+    return(SOAPY_SDR_CS8);
+
+  default:
+    return(SOAPY_SDR_CF32);
+  }
+}
+
+/* Tune the radio in the current direction of the transfer and make
+ * a stream for this direction */
+SoapySDRStream * setup_radio_stream(gmsk_transfer_t transfer)
+{
+  int direction = transfer->emit ? SOAPY_SDR_TX : SOAPY_SDR_RX;
+  char *format = get_soapysdr_format(transfer->sample_format);
+
+  SOAPYSDR_CHECK(SoapySDRDevice_setSampleRate(transfer->radio_device.soapysdr,
+                                              direction,
+                                              transfer->radio_channel,
+                                              transfer->sample_rate));
+  SOAPYSDR_CHECK(SoapySDRDevice_setFrequency(transfer->radio_device.soapysdr,
+                                             direction,
+                                             transfer->radio_channel,
+                                             transfer->frequency - transfer->frequency_offset,
+                                             NULL));
+  return(SoapySDRDevice_setupStream(transfer->radio_device.soapysdr,
+                                    direction,
+                                    format,
+                                    &transfer->radio_channel,
+                                    1,
+                                    NULL));
+}
+
+gmsk_transfer_t gmsk_transfer_create_callback(char *radio_driver,
+                                              unsigned char emit,
+                                              int (*data_callback)(void *,
+                                                                   unsigned char *,
+                                                                   unsigned int),
+                                              void *callback_context,
+                                              unsigned long int sample_rate,
+                                              unsigned int bit_rate,
+                                              unsigned long int frequency,
+                                              long int frequency_offset,
+                                              unsigned int maximum_deviation,
+                                              char *gain,
+                                              float ppm,
+                                              float bt,
+                                              char *inner_fec,
+                                              char *outer_fec,
+                                              char *id,
+                                              char *dump,
+                                              unsigned int timeout,
+                                              unsigned char audio)
+{
+  int gain_value;
+  gmsk_transfer_t transfer = malloc(sizeof(struct gmsk_transfer_s));
+
+  if(transfer == NULL)
+  {
+    fprintf(stderr, _("Error: Memory allocation failed\n"));
+    return(NULL);
+  }
+  bzero(transfer, sizeof(struct gmsk_transfer_s));
+
+  if(strcasecmp(radio_driver, "io") == 0)
+  {
+    transfer->radio_type = IO;
+  }
+  else if(strncasecmp(radio_driver, "file=", 5) == 0)
+  {
+    transfer->radio_type = FILENAME;
+  }
+  else if((strcasecmp(radio_driver, "loopback") == 0) ||
+          (strcasecmp(radio_driver, "sim") == 0) ||
+          (strncasecmp(radio_driver, "sim=", 4) == 0))
+  {
+    transfer->radio_type = LOOPBACK;
+  }
+  else
+  {
+    transfer->radio_type = SOAPYSDR;
+  }
+
+  transfer->stop = 0;
+  transfer->emit = emit;
+  transfer->preamble_size = GMSKFRAME_PREAMBLE_DEFAULT;
+  transfer->header_size = MAXIMUM_HEADER_SIZE;
+  transfer->ramp_size = -1;
+  transfer->file = NULL;
+  transfer->sample_format = FORMAT_CF32;
+  transfer->sample_bytes = sizeof(complex float);
+  transfer->data_callback = data_callback;
+  transfer->callback_context = callback_context;
+
+  if(sample_rate != 0)
+  {
+    transfer->sample_rate = sample_rate * ((1000000.0 - ppm) / 1000000.0);
+  }
+  else
+  {
+    fprintf(stderr, _("Error: Invalid sample rate\n"));
+    free(transfer);
+    return(NULL);
+  }
+
+  if(frequency != 0)
+  {
+    transfer->frequency = frequency * ((1000000.0 - ppm) / 1000000.0);
+  }
+  else
+  {
+    fprintf(stderr, _("Error: Invalid frequency\n"));
+    free(transfer);
+    return(NULL);
+  }
+
+  transfer->frequency_offset = frequency_offset;
+  transfer->ppm = ppm;
+
+  if(audio)
+  {
+    if((transfer->radio_type == IO) || (transfer->radio_type == FILENAME))
+    {
+      transfer->audio_converter = firhilbf_create(25, 60);
+      transfer->audio_sample_rate = transfer->sample_rate;
+      transfer->audio_frequency = transfer->frequency;
+      /* The rate of audio samples is twice the rate of IQ samples */
+      transfer->sample_rate = transfer->sample_rate / 2;
+      /* -(sample_rate / 2) Hz IQ <=> 0 Hz audio
+       * (sample_rate / 2) Hz IQ <=> (sample_rate * 2) Hz audio */
+      transfer->frequency_offset = transfer->frequency - (transfer->sample_rate / 2);
+      transfer->frequency = 0;
+      gain_value = strtol(gain, NULL, 10);
+      transfer->audio_gain = powf(10, gain_value / 20.0);
+    }
+    else
+    {
+      fprintf(stderr, _("Error: This radio type only supports IQ samples\n"));
+      free(transfer);
+      return(NULL);
+    }
+  }
+  else
+  {
+    transfer->audio_converter = NULL;
+    transfer->audio_gain = 0;
+  }
+
+  if(bit_rate != 0)
+  {
+    transfer->bit_rate = bit_rate;
+  }
+  else
+  {
+    fprintf(stderr, _("Error: Invalid bit rate\n"));
+    free(transfer);
+    return(NULL);
+  }
+
+  if((bt > 0) && (bt < 1))
+  {
+    transfer->bt = bt;
+  }
+  else
+  {
+    fprintf(stderr, _("Error: BT must be between 0 and 1\n"));
+    free(transfer);
+    return(NULL);
+  }
+
+  if(maximum_deviation == 0)
+  {
+    transfer->maximum_deviation = transfer->bit_rate / 100;
+  }
+  else if(maximum_deviation > (transfer->bit_rate / 2))
+  {
+    fprintf(stderr, _("Error: Invalid maximum deviation (> bit rate / 2)\n"));
+    free(transfer);
+    return(NULL);
+  }
+  else
+  {
+    transfer->maximum_deviation = maximum_deviation;
+  }
+
+  transfer->crc = LIQUID_CRC_32;
+
+  transfer->inner_fec = liquid_getopt_str2fec(inner_fec);
+  if(transfer->inner_fec == LIQUID_FEC_UNKNOWN)
+  {
+    fprintf(stderr, _("Error: Invalid inner FEC\n"));
+    free(transfer);
+    return(NULL);
+  }
+
+  transfer->outer_fec = liquid_getopt_str2fec(outer_fec);
+  if(transfer->outer_fec == LIQUID_FEC_UNKNOWN)
+  {
+    fprintf(stderr, _("Error: Invalid outer FEC\n"));
+    free(transfer);
+    return(NULL);
+  }
+
+  if(strlen(id) <= 4)
+  {
+    strcpy(transfer->id, id);
+  }
+  else
+  {
+    fprintf(stderr, _("Error: Id must be at most 4 bytes long\n"));
+    free(transfer);
+    return(NULL);
+  }
+
+  if(dump)
+  {
+    transfer->dump = fopen(dump, "wb");
+    if(transfer->dump == NULL)
+    {
+      fprintf(stderr, _("Error: Failed to open '%s'\n"), dump);
+      free(transfer);
+      return(NULL);
+    }
+  }
+  else
+  {
+    transfer->dump = NULL;
+  }
+
+  transfer->timeout = timeout;
+
+  switch(transfer->radio_type)
+  {
+  case IO:
+    break;
+
+  case FILENAME:
+    if(emit)
+    {
+      transfer->radio_device.file = fopen(radio_driver + 5, "wb");
+    }
+    else
+    {
+      transfer->radio_device.file = fopen(radio_driver + 5, "rb");
+    }
+    if(transfer->radio_device.file == NULL)
+    {
+      fprintf(stderr, _("Error: Failed to open '%s'\n"), radio_driver + 5);
+      free(transfer);
+      return(NULL);
+    }
+    map_radio_file(transfer);
+    break;
+
+  case SOAPYSDR:
+    transfer->radio_device.soapysdr = SoapySDRDevice_makeStrArgs(radio_driver);
+    if(transfer->radio_device.soapysdr == NULL)
+    {
+      fprintf(stderr, _("Error: %s\n"), SoapySDRDevice_lastError());
+      free(transfer);
+      return(NULL);
+    }
+    set_radio_gain(transfer, gain);
+    transfer->radio_stream.soapysdr = setup_radio_stream(transfer);
+    if(transfer->radio_stream.soapysdr == NULL)
+    {
+      fprintf(stderr, _("Error: %s\n"), SoapySDRDevice_lastError());
+      SoapySDRDevice_unmake(transfer->radio_device.soapysdr);
+      free(transfer);
+      return(NULL);
+    }
+    break;
+
+  case LOOPBACK:
+    transfer->radio_device.loopback = ringbuffer_create(sizeof(complex float),
+                                                        (transfer->sample_rate *
+                                                         LOOPBACK_DURATION) /
+                                                        1000);
+    if(transfer->radio_device.loopback == NULL)
+    {
+      fprintf(stderr, _("Error: Memory allocation failed\n"));
+      free(transfer);
+      return(NULL);
+    }
+    /* The 'sim' pseudo-radio is a 'loopback' pseudo-radio passing the
+     * samples through a channel simulator */
+    if(strncasecmp(radio_driver, "sim", 3) == 0)
+    {
+      transfer->simulator = simulator_create((radio_driver[3] == '=') ?
+                                             radio_driver + 4 :
+                                             "",
+                                             transfer->sample_rate);
+      if(transfer->simulator == NULL)
+      {
+        fprintf(stderr, _("Error: Invalid channel simulator parameters\n"));
+        ringbuffer_free(transfer->radio_device.loopback);
+        free(transfer);
+        return(NULL);
+      }
+    }
+    break;
+
+  default:
+    fprintf(stderr, _("Error: Unknown radio type\n"));
+    free(transfer);
+    return(NULL);
+    break;
+  }
+
+  return(transfer);
+}
+
+/* Use the internal callbacks reading the data to send from 'file' or
+ * writing the received data to 'file' (standard input or output if 'file'
+ * is NULL) */
+int open_data_file(gmsk_transfer_t transfer, char *file)
+{
+  int flags;
+
+  transfer->callback_context = transfer;
+  if(file)
+  {
+    if(transfer->emit)
+    {
+      transfer->file = fopen(file, "rb");
+    }
+    else
+    {
+      transfer->file = fopen(file, "wb");
+    }
+    if(transfer->file == NULL)
+    {
+      fprintf(stderr, _("Error: Failed to open '%s'\n"), file);
+      return(-1);
+    }
+  }
+  else
+  {
+    if(transfer->emit)
+    {
+      transfer->file = stdin;
+      flags = fcntl(STDIN_FILENO, F_GETFL);
+      fcntl(STDIN_FILENO, F_SETFL, flags | O_NONBLOCK);
+    }
+    else
+    {
+      transfer->file = stdout;
+    }
+  }
+
+  return(0);
+}
+
+gmsk_transfer_t gmsk_transfer_create(char *radio_driver,
+                                     unsigned char emit,
+                                     char *file,
+                                     unsigned long int sample_rate,
+                                     unsigned int bit_rate,
+                                     unsigned long int frequency,
+                                     long int frequency_offset,
+                                     unsigned int maximum_deviation,
+                                     char *gain,
+                                     float ppm,
+                                     float bt,
+                                     char *inner_fec,
+                                     char *outer_fec,
+                                     char *id,
+                                     char *dump,
+                                     unsigned int timeout,
+                                     unsigned char audio)
+{
+  gmsk_transfer_t transfer;
+
+  transfer = gmsk_transfer_create_callback(radio_driver,
+                                           emit,
+                                           emit ? read_data : write_data,
+                                           NULL,
+                                           sample_rate,
+                                           bit_rate,
+                                           frequency,
+                                           frequency_offset,
+                                           maximum_deviation,
+                                           gain,
+                                           ppm,
+                                           bt,
+                                           inner_fec,
+                                           outer_fec,
+                                           id,
+                                           dump,
+                                           timeout,
+                                           audio);
+  if(transfer == NULL)
+  {
+    return(NULL);
+  }
+
+  if(open_data_file(transfer, file) < 0)
+  {
+    free(transfer);
+    return(NULL);
+  }
+
+  return(transfer);
+}
+
+gmsk_transfer_t gmsk_transfer_create_shared_callback(gmsk_transfer_t peer,
+                                                     unsigned char emit,
+                                                     int (*data_callback)(void *,
+                                                                          unsigned char *,
+                                                                          unsigned int),
+                                                     void *callback_context,
+                                                     unsigned long int frequency,
+                                                     long int frequency_offset,
+                                                     char *gain,
+                                                     unsigned int channel)
+{
+  gmsk_transfer_t transfer;
+
+  emit = emit ? 1 : 0;
+  if((peer->radio_type != SOAPYSDR) && (peer->radio_type != LOOPBACK))
+  {
+    fprintf(stderr, _("Error: This radio type can't be shared\n"));
+    return(NULL);
+  }
+  if(emit == peer->emit)
+  {
+    fprintf(stderr,
+            _("Error: The transfers sharing a radio must go in opposite directions\n"));
+    return(NULL);
+  }
+  if((peer->radio_users != NULL) && (atomic_load(peer->radio_users) > 1))
+  {
+    fprintf(stderr, _("Error: This radio is already shared\n"));
+    return(NULL);
+  }
+  if(frequency == 0)
+  {
+    fprintf(stderr, _("Error: Invalid frequency\n"));
+    return(NULL);
+  }
+
+  transfer = malloc(sizeof(struct gmsk_transfer_s));
+  if(transfer == NULL)
+  {
+    fprintf(stderr, _("Error: Memory allocation failed\n"));
+    return(NULL);
+  }
+  bzero(transfer, sizeof(struct gmsk_transfer_s));
+
+  /* Same radio and same modulation parameters as the peer, only the
+   * frequencies and the gain can be different */
+  transfer->radio_type = peer->radio_type;
+  transfer->radio_device = peer->radio_device;
+  transfer->simulator = peer->simulator;
+  transfer->radio_channel = channel;
+  transfer->emit = emit;
+  transfer->sample_rate = peer->sample_rate;
+  transfer->bit_rate = peer->bit_rate;
+  transfer->ppm = peer->ppm;
+  transfer->frequency = frequency * ((1000000.0 - transfer->ppm) / 1000000.0);
+  transfer->frequency_offset = frequency_offset;
+  transfer->maximum_deviation = peer->maximum_deviation;
+  transfer->bt = peer->bt;
+  transfer->crc = peer->crc;
+  transfer->inner_fec = peer->inner_fec;
+  transfer->outer_fec = peer->outer_fec;
+  strcpy(transfer->id, peer->id);
+  transfer->timeout = peer->timeout;
+  transfer->preamble_size = peer->preamble_size;
+  transfer->header_size = peer->header_size;
+  transfer->ramp_size = peer->ramp_size;
+  transfer->sample_format = peer->sample_format;
+  transfer->sample_bytes = peer->sample_bytes;
+  transfer->data_callback = data_callback;
+  transfer->callback_context = callback_context;
+
+  if(transfer->radio_type == SOAPYSDR)
+  {
+    set_radio_gain(transfer, gain);
+    transfer->radio_stream.soapysdr = setup_radio_stream(transfer);
+    if(transfer->radio_stream.soapysdr == NULL)
+    {
+      fprintf(stderr, _("Error: %s\n"), SoapySDRDevice_lastError());
+      free(transfer);
+      return(NULL);
+    }
+  }
+
+  if(peer->radio_users == NULL)
+  {
+    peer->radio_users = malloc(sizeof(atomic_uint));
+    if(peer->radio_users == NULL)
+    {
+      fprintf(stderr, _("Error: Memory allocation failed\n"));
+      exit(EXIT_FAILURE);
+    }
+    atomic_init(peer->radio_users, 1);
+  }
+  atomic_fetch_add(peer->radio_users, 1);
+  transfer->radio_users = peer->radio_users;
+
+  return(transfer);
+}
+
+gmsk_transfer_t gmsk_transfer_create_shared(gmsk_transfer_t peer,
+                                            unsigned char emit,
+                                            char *file,
+                                            unsigned long int frequency,
+                                            long int frequency_offset,
+                                            char *gain,
+                                            unsigned int channel)
+{
+  gmsk_transfer_t transfer;
+
+  transfer = gmsk_transfer_create_shared_callback(peer,
+                                                  emit,
+                                                  emit ? read_data : write_data,
+                                                  NULL,
+                                                  frequency,
+                                                  frequency_offset,
+                                                  gain,
+                                                  channel);
+  if(transfer == NULL)
+  {
+    return(NULL);
+  }
+
+  if(open_data_file(transfer, file) < 0)
+  {
+    gmsk_transfer_free(transfer);
+    return(NULL);
+  }
+
+  return(transfer);
+}
+
+/* Return 1 if the transfer was the last one using its radio, 0 otherwise */
+int release_radio(gmsk_transfer_t transfer)
+{
+  if(transfer->radio_users == NULL)
+  {
+    return(1);
+  }
+  if(atomic_fetch_sub(transfer->radio_users, 1) == 1)
+  {
+    free(transfer->radio_users);
+    return(1);
+  }
+  return(0);
+}
+
+void gmsk_transfer_free(gmsk_transfer_t transfer)
+{
+  if(transfer)
+  {
+    /* The thread exporting the metrics reads the statistics until it is
+     * stopped */
+    metrics_free(transfer->metrics);
+    if(transfer->file)
+    {
+      fclose(transfer->file);
+    }
+    if(transfer->dump)
+    {
+      fclose(transfer->dump);
+    }
+    if(transfer->audio_converter)
+    {
+      firhilbf_destroy(transfer->audio_converter);
+    }
+    squelch_free(transfer->squelch);
+    profiler_free(transfer->profiler);
+    free_dsp_objects(transfer);
+    free(transfer->stream_buffer);
+    free(transfer->pending);
+    switch(transfer->radio_type)
+    {
+    case IO:
+      break;
+
+    case FILENAME:
+      unmap_radio_file(transfer);
+      fclose(transfer->radio_device.file);
+      break;
+
+    case SOAPYSDR:
+      if(transfer->stream_active)
+      {
+        SoapySDRDevice_deactivateStream(transfer->radio_device.soapysdr,
+                                        transfer->radio_stream.soapysdr,
+                                        0,
+                                        0);
+      }
+      if(transfer->radio_stream.soapysdr)
+      {
+        SoapySDRDevice_closeStream(transfer->radio_device.soapysdr,
+                                   transfer->radio_stream.soapysdr);
+      }
+      if(transfer->other_stream.soapysdr)
+      {
+        SoapySDRDevice_closeStream(transfer->radio_device.soapysdr,
+                                   transfer->other_stream.soapysdr);
+      }
+      if(release_radio(transfer))
+      {
+        SoapySDRDevice_unmake(transfer->radio_device.soapysdr);
+      }
+      break;
+
+    case LOOPBACK:
+      if(release_radio(transfer))
+      {
+        ringbuffer_free(transfer->radio_device.loopback);
+        simulator_free(transfer->simulator);
+      }
+      break;
+
+    default:
+      break;
+    }
+    free(transfer);
+  }
+}
+
+/* The direct audio engine needs a whole number of audio samples per symbol
+ * of the frame generator or synchronizer. The options working on the IQ
+ * samples of the complex pipeline use the Hilbert transform instead. */
+int use_audio_engine(gmsk_transfer_t transfer)
+{
+  unsigned int samples_per_symbol = ceilf(1 / transfer->bt);
+
+  if((!transfer->audio_converter) || transfer->dump)
+  {
+    return(0);
+  }
+  if(transfer->emit)
+  {
+    return((transfer->audio_sample_rate % transfer->bit_rate == 0) &&
+           (transfer->audio_sample_rate >= 2 * transfer->bit_rate));
+  }
+  if(transfer->squelch_threshold > 0)
+  {
+    return(0);
+  }
+  return(transfer->audio_sample_rate %
+         (transfer->bit_rate * samples_per_symbol) == 0);
+}
+
+/* Get the time on the clock of the radio at which the first samples of the
+ * transmission must be sent */
+void schedule_transmission(gmsk_transfer_t transfer)
+{
+  long long int now = SoapySDRDevice_getHardwareTime(transfer->radio_device.soapysdr,
+                                                     "");
+  long long int delay;
+
+  transfer->scheduled_time = transfer->start_time;
+  if(transfer->start_time_relative)
+  {
+    transfer->scheduled_time += now;
+  }
+  delay = transfer->scheduled_time - now;
+  if(delay < 0)
+  {
+    fprintf(stderr, _("Warning: The start time is already past\n"));
+    delay = 0;
+  }
+  transfer->start_time_pending = 1;
+  /* Nothing will be sent before the start time */
+  atomic_store(&transfer->radio_time, get_time_us() + (delay / 1000));
+  if(verbose)
+  {
+    fprintf(stderr,
+            _("Info: Transmission scheduled at %.6f s (in %.3f s)\n"),
+            transfer->scheduled_time / 1000000000.0,
+            delay / 1000000000.0);
+  }
+}
+
+void gmsk_transfer_start(gmsk_transfer_t transfer)
+{
+  int audio_engine = use_audio_engine(transfer);
+  long long int end_time;
+  long long int radio_time;
+
+  stop = 0;
+  transfer->stop = 0;
+
+  switch(transfer->radio_type)
+  {
+  case IO:
+    if(verbose)
+    {
+      fprintf(stderr, _("Info: Using IO pseudo-radio\n"));
+    }
+    break;
+
+  case FILENAME:
+    if(verbose)
+    {
+      fprintf(stderr, _("Info: Using FILENAME pseudo-radio\n"));
+    }
+    break;
+
+  case LOOPBACK:
+    if(verbose)
+    {
+      if(transfer->simulator)
+      {
+        fprintf(stderr, _("Info: Using SIM pseudo-radio\n"));
+      }
+      else
+      {
+        fprintf(stderr, _("Info: Using LOOPBACK pseudo-radio\n"));
+      }
+    }
+    break;
+
+  case SOAPYSDR:
+    if(transfer->radio_stream.soapysdr == NULL)
+    {
+      fprintf(stderr, _("Error: The radio has no stream\n"));
+      return;
+    }
+    if(!transfer->stream_active)
+    {
+      SoapySDRDevice_activateStream(transfer->radio_device.soapysdr,
+                                    transfer->radio_stream.soapysdr,
+                                    0,
+                                    0,
+                                    0);
+      transfer->stream_active = 1;
+    }
+    if(transfer->emit && (transfer->start_time != 0))
+    {
+      schedule_transmission(transfer);
+    }
+    /* Use the buffers of the driver directly instead of copying the
+     * samples when the driver allows it */
+    transfer->direct_access =
+      SoapySDRDevice_getNumDirectAccessBuffers(transfer->radio_device.soapysdr,
+                                               transfer->radio_stream.soapysdr) > 0;
+    if(verbose && transfer->direct_access)
+    {
+      fprintf(stderr, _("Info: Using direct access to the radio buffers\n"));
+    }
+    break;
+
+  default:
+    return;
+  }
+
+  if(transfer->direction_switched)
+  {
+    if(verbose)
     {
-      break;
+      fprintf(stderr,
+              _("Info: Turnaround: %.1f ms from the end of the %s to the start of the %s\n"),
+              (get_time_us() - transfer->end_time) / 1000.0,
+              transfer->emit ? _("reception") : _("transmission"),
+              transfer->emit ? _("transmission") : _("reception"));
     }
-    if((transfer->timeout > 0) &&
-       (time(NULL) > transfer->timeout_start + transfer->timeout))
+    transfer->direction_switched = 0;
+  }
+  transfer->timeout_start = time(NULL);
+  transfer->burst_samples = 0;
+  transfer->block_time = -1;
+  transfer->block_start = 0;
+  transfer->frame_time = -1;
+  transfer->samples_read = 0;
+  transfer->pending_size = 0;
+  transfer->latency_count = 0;
+  bzero(transfer->latency_histogram, sizeof(transfer->latency_histogram));
+  if(transfer->profiler)
+  {
+    profiler_reset(transfer->profiler);
+  }
+  if(transfer->audio_converter)
+  {
+    /* Like the resampler and the oscillator, the converter is reused by the
+     * next runs and must not keep the end of the previous one */
+    firhilbf_reset(transfer->audio_converter);
+  }
+  if(transfer->emit)
+  {
+    /* The frames of a burst can't be encoded in parallel because the state
+     * of the modulator goes from one frame to the next */
+    if((transfer->ring_size > 0) && (transfer->aggregation <= 1))
     {
-      if(verbose)
-      {
-        fprintf(stderr, _("Timeout: %d s without frames\n"), transfer->timeout);
-      }
-      break;
+      send_frames_pipelined(transfer);
     }
-    if(transfer->dump)
+    else if(audio_engine)
     {
-      dump_samples(transfer, samples, n);
+      send_frames_audio(transfer);
     }
-    if(transfer->frequency_offset != 0)
+    else
     {
-      nco_crcf_mix_block_down(oscillator, samples, samples, n);
+      send_frames(transfer);
     }
-    msresamp_crcf_execute(resampler, samples, n, frame_samples, &n);
-    gmskframesync_execute(frame_synchronizer, frame_samples, n);
+    print_latency_info(transfer);
   }
-
-  for(n = 0; n < delay; n++)
+  else if(transfer->channels > 1)
   {
-    samples[n] = 0;
+    receive_frames_channelized(transfer);
   }
-  msresamp_crcf_execute(resampler, samples, delay, frame_samples, &n);
-  gmskframesync_execute(frame_synchronizer, frame_samples, n);
-  while(gmskframesync_is_frame_open(frame_synchronizer))
+  else if((transfer->jobs > 1) && (transfer->radio_type == FILENAME))
   {
-    gmskframesync_execute(frame_synchronizer, samples, 1);
+    receive_frames_offline(transfer);
   }
-
-  free(samples);
-  free(frame_samples);
-  nco_crcf_destroy(oscillator);
-  msresamp_crcf_destroy(resampler);
-  gmskframesync_destroy(frame_synchronizer);
-}
-
-gmsk_transfer_t gmsk_transfer_create_callback(char *radio_driver,
-                                              unsigned char emit,
-                                              int (*data_callback)(void *,
-                                                                   unsigned char *,
-                                                                   unsigned int),
-                                              void *callback_context,
-                                              unsigned long int sample_rate,
-                                              unsigned int bit_rate,
-                                              unsigned long int frequency,
-                                              long int frequency_offset,
-                                              unsigned int maximum_deviation,
-                                              char *gain,
-                                              float ppm,
-                                              float bt,
-                                              char *inner_fec,
-                                              char *outer_fec,
-                                              char *id,
-                                              char *dump,
-                                              unsigned int timeout,
-                                              unsigned char audio)
-{
-  int direction;
-  SoapySDRKwargs kwargs;
-  unsigned int n;
-  char *gain_name;
-  int gain_value;
-  gmsk_transfer_t transfer = malloc(sizeof(struct gmsk_transfer_s));
-
-  if(transfer == NULL)
+  else if(transfer->ring_size > 0)
   {
-    fprintf(stderr, _("Error: Memory allocation failed\n"));
-    return(NULL);
+    receive_frames_pipelined(transfer);
   }
-  bzero(transfer, sizeof(struct gmsk_transfer_s));
-
-  if(strcasecmp(radio_driver, "io") == 0)
+  else if(audio_engine)
   {
-    transfer->radio_type = IO;
+    receive_frames_audio(transfer);
   }
-  else if(strncasecmp(radio_driver, "file=", 5) == 0)
+  else
   {
-    transfer->radio_type = FILENAME;
+    receive_frames(transfer);
   }
-  else
+  print_profiling_info(transfer);
+
+  switch(transfer->radio_type)
   {
-    transfer->radio_type = SOAPYSDR;
+  case IO:
+    if(transfer->emit)
+    {
+      fflush(stdout);
+    }
+    break;
+
+  case FILENAME:
+    if(transfer->emit)
+    {
+      fflush(transfer->radio_device.file);
+    }
+    break;
+
+  case SOAPYSDR:
+    release_radio_buffers(transfer);
+    transfer->start_time_pending = 0;
+    break;
+
+  case LOOPBACK:
+    /* Like the end of a file, the end of the transmission ends the
+     * reception, and the end of the reception makes the transmitter stop
+     * waiting for some space in the ring */
+    ringbuffer_close(transfer->radio_device.loopback);
+    break;
+
+  default:
+    break;
   }
 
-  transfer->stop = 0;
-  transfer->emit = emit;
-  transfer->file = NULL;
-  transfer->data_callback = data_callback;
-  transfer->callback_context = callback_context;
+  /* A transmission ends when the radio has sent its last samples */
+  end_time = get_time_us();
+  radio_time = atomic_load(&transfer->radio_time);
+  transfer->end_time = (transfer->emit && (radio_time > end_time)) ?
+    radio_time :
+    end_time;
+}
 
-  if(sample_rate != 0)
+void gmsk_transfer_reset(gmsk_transfer_t transfer)
+{
+  transfer->stop = 0;
+  /* More data may have been added to the inputs since the end of the
+   * previous run */
+  if(transfer->file)
   {
-    transfer->sample_rate = sample_rate * ((1000000.0 - ppm) / 1000000.0);
+    clearerr(transfer->file);
   }
-  else
+  switch(transfer->radio_type)
   {
-    fprintf(stderr, _("Error: Invalid sample rate\n"));
-    free(transfer);
-    return(NULL);
+  case IO:
+    if(!transfer->emit)
+    {
+      clearerr(stdin);
+    }
+    break;
+
+  case FILENAME:
+    clearerr(transfer->radio_device.file);
+    break;
+
+  case SOAPYSDR:
+    if(transfer->stream_active)
+    {
+      SoapySDRDevice_deactivateStream(transfer->radio_device.soapysdr,
+                                      transfer->radio_stream.soapysdr,
+                                      0,
+                                      0);
+      transfer->stream_active = 0;
+    }
+    break;
+
+  case LOOPBACK:
+    /* The ring was closed at the end of the previous run */
+    ringbuffer_reset(transfer->radio_device.loopback);
+    break;
+
+  default:
+    break;
   }
+}
 
-  if(frequency != 0)
+int gmsk_transfer_switch_direction(gmsk_transfer_t transfer,
+                                   unsigned char emit,
+                                   char *gain,
+                                   int (*data_callback)(void *,
+                                                        unsigned char *,
+                                                        unsigned int),
+                                   void *callback_context)
+{
+  radio_stream_t stream;
+  int gain_value;
+
+  if((transfer->radio_type == FILENAME) || (transfer->radio_type == LOOPBACK))
   {
-    transfer->frequency = frequency * ((1000000.0 - ppm) / 1000000.0);
+    fprintf(stderr, _("Error: This radio type can't change direction\n"));
+    return(-1);
   }
-  else
+  if(transfer->radio_users && (atomic_load(transfer->radio_users) > 1))
   {
-    fprintf(stderr, _("Error: Invalid frequency\n"));
-    free(transfer);
-    return(NULL);
+    fprintf(stderr, _("Error: A shared radio can't change direction\n"));
+    return(-1);
   }
 
-  transfer->frequency_offset = frequency_offset;
+  gmsk_transfer_reset(transfer);
+  emit = emit ? 1 : 0;
+  if(emit != transfer->emit)
+  {
+    if(transfer->radio_type == SOAPYSDR)
+    {
+      /* The stream of the other direction is made the first time, and then
+       * kept with the tuning of the radio */
+      stream = transfer->radio_stream;
+      transfer->radio_stream = transfer->other_stream;
+      transfer->other_stream = stream;
+      transfer->emit = emit;
+      if(transfer->radio_stream.soapysdr == NULL)
+      {
+        transfer->radio_stream.soapysdr = setup_radio_stream(transfer);
+        if(transfer->radio_stream.soapysdr == NULL)
+        {
+          fprintf(stderr, _("Error: %s\n"), SoapySDRDevice_lastError());
+          transfer->other_stream = transfer->radio_stream;
+          transfer->radio_stream = stream;
+          transfer->emit = !emit;
+          return(-1);
+        }
+      }
+    }
+    transfer->emit = emit;
+    transfer->direction_switched = 1;
+  }
 
-  if(audio)
+  transfer->data_callback = data_callback;
+  transfer->callback_context = callback_context;
+  if(gain)
   {
-    if((transfer->radio_type == IO) || (transfer->radio_type == FILENAME))
+    if(transfer->audio_converter)
     {
-      transfer->audio_converter = firhilbf_create(25, 60);
-      /* The rate of audio samples is twice the rate of IQ samples */
-      transfer->sample_rate = transfer->sample_rate / 2;
-      /* -(sample_rate / 2) Hz IQ <=> 0 Hz audio
-       * (sample_rate / 2) Hz IQ <=> (sample_rate * 2) Hz audio */
-      transfer->frequency_offset = transfer->frequency - (transfer->sample_rate / 2);
-      transfer->frequency = 0;
       gain_value = strtol(gain, NULL, 10);
       transfer->audio_gain = powf(10, gain_value / 20.0);
     }
-    else
+    else if(transfer->radio_type == SOAPYSDR)
     {
-      fprintf(stderr, _("Error: This radio type only supports IQ samples\n"));
-      free(transfer);
-      return(NULL);
+      set_radio_gain(transfer, gain);
     }
   }
-  else
+
+  return(0);
+}
+
+int gmsk_transfer_set_pipeline(gmsk_transfer_t transfer,
+                               unsigned int ring_size)
+{
+  transfer->ring_size = ring_size;
+  return(0);
+}
+
+int gmsk_transfer_set_coalescing_delay(gmsk_transfer_t transfer,
+                                       unsigned int delay)
+{
+  if((delay > 0) && (!transfer->emit))
   {
-    transfer->audio_converter = NULL;
-    transfer->audio_gain = 0;
+    fprintf(stderr,
+            _("Error: The coalescing delay can only be used in transmit mode\n"));
+    return(-1);
   }
-
-  if(bit_rate != 0)
+  if((delay > 0) && (transfer->pending == NULL))
   {
-    transfer->bit_rate = bit_rate;
+    transfer->pending = malloc(MAXIMUM_PAYLOAD_SIZE);
+    if(transfer->pending == NULL)
+    {
+      fprintf(stderr, _("Error: Memory allocation failed\n"));
+      return(-1);
+    }
   }
-  else
+  transfer->coalescing_delay = delay;
+  return(0);
+}
+
+int gmsk_transfer_set_aggregation(gmsk_transfer_t transfer,
+                                  unsigned int frames)
+{
+  if((frames > 1) && (!transfer->emit))
   {
-    fprintf(stderr, _("Error: Invalid bit rate\n"));
-    free(transfer);
-    return(NULL);
+    fprintf(stderr,
+            _("Error: Frame aggregation can only be used in transmit mode\n"));
+    return(-1);
   }
+  transfer->aggregation = frames;
+  return(0);
+}
 
-  if((bt > 0) && (bt < 1))
+int gmsk_transfer_set_framing(gmsk_transfer_t transfer,
+                              unsigned int preamble_size,
+                              unsigned int header_size,
+                              int ramp_size)
+{
+  msequence preamble = gmskburstgen_create_preamble(preamble_size);
+
+  if(preamble == NULL)
   {
-    transfer->bt = bt;
+    fprintf(stderr, _("Error: Invalid preamble size\n"));
+    return(-1);
   }
-  else
+  msequence_destroy(preamble);
+  if((header_size < COUNTER_SIZE) || (header_size > MAXIMUM_HEADER_SIZE))
   {
-    fprintf(stderr, _("Error: BT must be between 0 and 1\n"));
-    free(transfer);
-    return(NULL);
+    fprintf(stderr, _("Error: Invalid header size\n"));
+    return(-1);
   }
-
-  if(maximum_deviation == 0)
+  if(strlen(transfer->id) > header_size - COUNTER_SIZE)
   {
-    transfer->maximum_deviation = transfer->bit_rate / 100;
+    fprintf(stderr, _("Error: The id doesn't fit in the header\n"));
+    return(-1);
   }
-  else if(maximum_deviation > (transfer->bit_rate / 2))
+  if(ramp_size > (int) preamble_size)
   {
-    fprintf(stderr, _("Error: Invalid maximum deviation (> bit rate / 2)\n"));
-    free(transfer);
-    return(NULL);
+    fprintf(stderr, _("Error: Invalid ramp size\n"));
+    return(-1);
   }
-  else
+  transfer->preamble_size = preamble_size;
+  transfer->header_size = header_size;
+  transfer->ramp_size = (ramp_size < 0) ? -1 : ramp_size;
+  /* The frame generator and synchronizer kept from a previous run are made
+   * again with the new lengths by the next run */
+  if(transfer->frame_generator)
   {
-    transfer->maximum_deviation = maximum_deviation;
+    gmskburstgen_destroy(transfer->frame_generator);
+    transfer->frame_generator = NULL;
   }
-
-  transfer->crc = LIQUID_CRC_32;
-
-  transfer->inner_fec = liquid_getopt_str2fec(inner_fec);
-  if(transfer->inner_fec == LIQUID_FEC_UNKNOWN)
+  if(transfer->frame_synchronizer)
   {
-    fprintf(stderr, _("Error: Invalid inner FEC\n"));
-    free(transfer);
-    return(NULL);
+    gmskframesync_destroy(transfer->frame_synchronizer);
+    transfer->frame_synchronizer = NULL;
   }
+  return(0);
+}
 
-  transfer->outer_fec = liquid_getopt_str2fec(outer_fec);
-  if(transfer->outer_fec == LIQUID_FEC_UNKNOWN)
+int gmsk_transfer_set_jobs(gmsk_transfer_t transfer, unsigned int jobs)
+{
+  long int cpus;
+
+  if(jobs == 1)
   {
-    fprintf(stderr, _("Error: Invalid outer FEC\n"));
-    free(transfer);
-    return(NULL);
+    transfer->jobs = 1;
+    return(0);
   }
-
-  if(strlen(id) <= 4)
+  if(transfer->emit || (transfer->radio_type != FILENAME))
   {
-    strcpy(transfer->id, id);
+    fprintf(stderr,
+            _("Error: Parallel decoding can only be used to receive from a file\n"));
+    return(-1);
   }
-  else
+  if(jobs == 0)
   {
-    fprintf(stderr, _("Error: Id must be at most 4 bytes long\n"));
-    free(transfer);
-    return(NULL);
+    cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    jobs = (cpus > 0) ? cpus : 1;
   }
+  transfer->jobs = jobs;
+  return(0);
+}
 
-  if(dump)
+int gmsk_transfer_set_sample_format(gmsk_transfer_t transfer, char *format)
+{
+  sample_format_t sample_format;
+  sample_format_t previous_format = transfer->sample_format;
+  unsigned int sample_bytes;
+  char **formats;
+  size_t formats_count;
+  size_t i;
+  int direction;
+  int supported = 0;
+
+  if(strcasecmp(format, "cf32") == 0)
   {
-    transfer->dump = fopen(dump, "wb");
-    if(transfer->dump == NULL)
-    {
-      fprintf(stderr, _("Error: Failed to open '%s'\n"), dump);
-      free(transfer);
-      return(NULL);
-    }
+    sample_format = FORMAT_CF32;
+    sample_bytes = sizeof(complex float);
+  }
+  else if(strcasecmp(format, "cs16") == 0)
+  {
+    sample_format = FORMAT_CS16;
+    sample_bytes = 2 * sizeof(short int);
+  }
+  else if(strcasecmp(format, "cs8") == 0)
+  {
+    sample_format = FORMAT_CS8;
+    sample_bytes = 2 * sizeof(signed char);
   }
   else
   {
-    transfer->dump = NULL;
+    fprintf(stderr, _("Error: Unknown sample format\n"));
+    return(-1);
   }
 
-  transfer->timeout = timeout;
-
-  switch(transfer->radio_type)
+  if(sample_format == transfer->sample_format)
   {
-  case IO:
-    break;
+    return(0);
+  }
+  if(transfer->audio_converter)
+  {
+    fprintf(stderr,
+            _("Error: The sample format can't be changed in audio mode\n"));
+    return(-1);
+  }
 
-  case FILENAME:
-    if(emit)
+  if(transfer->radio_type == SOAPYSDR)
+  {
+    direction = transfer->emit ? SOAPY_SDR_TX : SOAPY_SDR_RX;
+    formats = SoapySDRDevice_getStreamFormats(transfer->radio_device.soapysdr,
+                                              direction,
+                                              transfer->radio_channel,
+                                              &formats_count);
+    for(i = 0; i < formats_count; i++)
     {
-      transfer->radio_device.file = fopen(radio_driver + 5, "wb");
+      if(strcasecmp(formats[i], get_soapysdr_format(sample_format)) == 0)
+      {
+        supported = 1;
+      }
     }
-    else
+    SoapySDRStrings_clear(&formats, formats_count);
+    if(!supported)
     {
-      transfer->radio_device.file = fopen(radio_driver + 5, "rb");
+      fprintf(stderr,
+              _("Error: This sample format is not supported by the radio\n"));
+      return(-1);
     }
-    if(transfer->radio_device.file == NULL)
+    if(transfer->other_stream.soapysdr)
     {
-      fprintf(stderr, _("Error: Failed to open '%s'\n"), radio_driver + 5);
-      free(transfer);
-      return(NULL);
+      /* The stream of the other direction will be made again with the new
+       * format when the direction changes */
+      SoapySDRDevice_closeStream(transfer->radio_device.soapysdr,
+                                 transfer->other_stream.soapysdr);
+      transfer->other_stream.soapysdr = NULL;
     }
-    break;
-
-  case SOAPYSDR:
-    transfer->radio_device.soapysdr = SoapySDRDevice_makeStrArgs(radio_driver);
-    if(transfer->radio_device.soapysdr == NULL)
+    /* The new stream will be activated by the next start */
+    if(transfer->stream_active)
     {
-      fprintf(stderr, _("Error: %s\n"), SoapySDRDevice_lastError());
-      free(transfer);
-      return(NULL);
-    }
-    direction = emit ? SOAPY_SDR_TX : SOAPY_SDR_RX;
-    SOAPYSDR_CHECK(SoapySDRDevice_setSampleRate(transfer->radio_device.soapysdr,
-                                                direction,
-                                                0,
-                                                transfer->sample_rate));
-    SOAPYSDR_CHECK(SoapySDRDevice_setFrequency(transfer->radio_device.soapysdr,
-                                               direction,
-                                               0,
-                                               transfer->frequency - transfer->frequency_offset,
-                                               NULL));
-    if(strchr(gain, '='))
-    {
-      kwargs = SoapySDRKwargs_fromString(gain);
-      for(n = 0; n < kwargs.size; n++)
-      {
-        gain_name = kwargs.keys[n];
-        gain_value = strtoul(kwargs.vals[n], NULL, 10);
-        SOAPYSDR_CHECK(SoapySDRDevice_setGainElement(transfer->radio_device.soapysdr,
-                                                     direction,
-                                                     0,
-                                                     gain_name,
-                                                     gain_value));
-      }
-      SoapySDRKwargs_clear(&kwargs);
+      SoapySDRDevice_deactivateStream(transfer->radio_device.soapysdr,
+                                      transfer->radio_stream.soapysdr,
+                                      0,
+                                      0);
+      transfer->stream_active = 0;
     }
-    else
-    {
-      gain_value = strtoul(gain, NULL, 10);
-      SOAPYSDR_CHECK(SoapySDRDevice_setGain(transfer->radio_device.soapysdr,
-                                            direction,
-                                            0,
-                                            gain_value));
-    }
-    transfer->radio_stream.soapysdr = SoapySDRDevice_setupStream(transfer->radio_device.soapysdr,
-                                                                 direction,
-                                                                 SOAPY_SDR_CF32,
-                                                                 NULL,
-                                                                 0,
-                                                                 NULL);
+    SoapySDRDevice_closeStream(transfer->radio_device.soapysdr,
+                               transfer->radio_stream.soapysdr);
+    transfer->sample_format = sample_format;
+    transfer->radio_stream.soapysdr = setup_radio_stream(transfer);
     if(transfer->radio_stream.soapysdr == NULL)
     {
       fprintf(stderr, _("Error: %s\n"), SoapySDRDevice_lastError());
-      SoapySDRDevice_unmake(transfer->radio_device.soapysdr);
-      free(transfer);
-      return(NULL);
+      /* Keep using the previous format */
+      transfer->sample_format = previous_format;
+      transfer->radio_stream.soapysdr = setup_radio_stream(transfer);
+      if(transfer->radio_stream.soapysdr == NULL)
+      {
+        fprintf(stderr,
+                _("Error: Failed to make the stream of the radio again: %s\n"),
+                SoapySDRDevice_lastError());
+      }
+      return(-1);
     }
-    break;
+  }
 
-  default:
-    fprintf(stderr, _("Error: Unknown radio type\n"));
-    free(transfer);
-    return(NULL);
-    break;
+  free(transfer->stream_buffer);
+  transfer->stream_buffer = NULL;
+  transfer->stream_buffer_size = 0;
+  transfer->sample_format = sample_format;
+  transfer->sample_bytes = sample_bytes;
+  return(0);
+}
+
+int gmsk_transfer_set_squelch(gmsk_transfer_t transfer, float threshold)
+{
+  if(threshold <= 0)
+  {
+    transfer->squelch_threshold = 0;
+    return(0);
+  }
+  if(transfer->emit)
+  {
+    fprintf(stderr, _("Error: Squelch can only be used in receive mode\n"));
+    return(-1);
   }
+  transfer->squelch_threshold = threshold;
+  return(0);
+}
 
-  return(transfer);
+void gmsk_transfer_get_squelch_counters(gmsk_transfer_t transfer,
+                                        unsigned long int *samples,
+                                        unsigned long int *gated_samples)
+{
+  if(transfer->squelch)
+  {
+    squelch_get_counters(transfer->squelch, samples, gated_samples);
+  }
+  else
+  {
+    *samples = 0;
+    *gated_samples = 0;
+  }
 }
 
-gmsk_transfer_t gmsk_transfer_create(char *radio_driver,
-                                     unsigned char emit,
-                                     char *file,
-                                     unsigned long int sample_rate,
-                                     unsigned int bit_rate,
-                                     unsigned long int frequency,
-                                     long int frequency_offset,
-                                     unsigned int maximum_deviation,
-                                     char *gain,
-                                     float ppm,
-                                     float bt,
-                                     char *inner_fec,
-                                     char *outer_fec,
-                                     char *id,
-                                     char *dump,
-                                     unsigned int timeout,
-                                     unsigned char audio)
+int gmsk_transfer_set_start_time(gmsk_transfer_t transfer,
+                                 long long int time,
+                                 unsigned char relative)
 {
-  int flags;
-  gmsk_transfer_t transfer;
+  if(time == 0)
+  {
+    transfer->start_time = 0;
+    transfer->start_time_relative = 0;
+    return(0);
+  }
+  if(!transfer->emit)
+  {
+    fprintf(stderr,
+            _("Error: A start time can only be used in transmit mode\n"));
+    return(-1);
+  }
+  if(gmsk_transfer_get_hardware_time(transfer) < 0)
+  {
+    fprintf(stderr, _("Error: The radio has no hardware time\n"));
+    return(-1);
+  }
+  if(time < 0)
+  {
+    fprintf(stderr, _("Error: Invalid start time\n"));
+    return(-1);
+  }
+  transfer->start_time = time;
+  transfer->start_time_relative = relative;
+  return(0);
+}
 
-  transfer = gmsk_transfer_create_callback(radio_driver,
-                                           emit,
-                                           emit ? read_data : write_data,
-                                           NULL,
-                                           sample_rate,
-                                           bit_rate,
-                                           frequency,
-                                           frequency_offset,
-                                           maximum_deviation,
-                                           gain,
-                                           ppm,
-                                           bt,
-                                           inner_fec,
-                                           outer_fec,
-                                           id,
-                                           dump,
-                                           timeout,
-                                           audio);
-  if(transfer == NULL)
+long long int gmsk_transfer_get_hardware_time(gmsk_transfer_t transfer)
+{
+  if((transfer->radio_type != SOAPYSDR) ||
+     (!SoapySDRDevice_hasHardwareTime(transfer->radio_device.soapysdr, "")))
   {
-    return(NULL);
+    return(-1);
   }
+  return(SoapySDRDevice_getHardwareTime(transfer->radio_device.soapysdr, ""));
+}
 
-  transfer->callback_context = transfer;
-  if(file)
+long long int gmsk_transfer_get_frame_time(gmsk_transfer_t transfer)
+{
+  return(transfer->frame_time);
+}
+
+int gmsk_transfer_set_profiling(gmsk_transfer_t transfer,
+                                unsigned char enable)
+{
+  if(!enable)
   {
-    if(emit)
-    {
-      transfer->file = fopen(file, "rb");
-    }
-    else
-    {
-      transfer->file = fopen(file, "wb");
-    }
-    if(transfer->file == NULL)
-    {
-      fprintf(stderr, _("Error: Failed to open '%s'\n"), file);
-      free(transfer);
-      return(NULL);
-    }
+    profiler_free(transfer->profiler);
+    transfer->profiler = NULL;
+    return(0);
   }
-  else
+  if(transfer->profiler == NULL)
   {
-    if(emit)
-    {
-      transfer->file = stdin;
-      flags = fcntl(STDIN_FILENO, F_GETFL);
-      fcntl(STDIN_FILENO, F_SETFL, flags | O_NONBLOCK);
-    }
-    else
+    transfer->profiler = profiler_create(STAGES_SIZE);
+    if(transfer->profiler == NULL)
     {
-      transfer->file = stdout;
+      fprintf(stderr, _("Error: Memory allocation failed\n"));
+      return(-1);
     }
   }
-
-  return(transfer);
+  return(0);
 }
 
-void gmsk_transfer_free(gmsk_transfer_t transfer)
+const char * gmsk_transfer_get_stage_time(gmsk_transfer_t transfer,
+                                          unsigned int stage,
+                                          unsigned long int *calls,
+                                          unsigned long long int *total,
+                                          unsigned long long int *p50,
+                                          unsigned long long int *p99)
 {
-  if(transfer)
+  if(stage >= STAGES_SIZE)
   {
-    if(transfer->file)
+    return(NULL);
+  }
+  if(transfer->profiler)
+  {
+    profiler_get_stage(transfer->profiler, stage, calls, total, p50, p99);
+  }
+  else
+  {
+    if(calls)
     {
-      fclose(transfer->file);
+      *calls = 0;
     }
-    if(transfer->dump)
+    if(total)
     {
-      fclose(transfer->dump);
+      *total = 0;
     }
-    if(transfer->audio_converter)
+    if(p50)
     {
-      firhilbf_destroy(transfer->audio_converter);
+      *p50 = 0;
     }
-    switch(transfer->radio_type)
+    if(p99)
     {
-    case IO:
-      break;
+      *p99 = 0;
+    }
+  }
+  return(stage_names[stage]);
+}
 
-    case FILENAME:
-      fclose(transfer->radio_device.file);
-      break;
+void gmsk_transfer_get_stats(gmsk_transfer_t transfer,
+                             gmsk_transfer_stats_t *stats)
+{
+  transfer_stats_t *s = &transfer->stats;
+  unsigned long int measured_frames;
 
-    case SOAPYSDR:
-      SoapySDRDevice_deactivateStream(transfer->radio_device.soapysdr,
-                                      transfer->radio_stream.soapysdr,
-                                      0,
-                                      0);
-      SoapySDRDevice_closeStream(transfer->radio_device.soapysdr,
-                                 transfer->radio_stream.soapysdr);
-      SoapySDRDevice_unmake(transfer->radio_device.soapysdr);
-      break;
+  stats->frames_received = atomic_load_explicit(&s->frames_received,
+                                                memory_order_relaxed);
+  stats->frames_corrupted_header =
+    atomic_load_explicit(&s->frames_corrupted_header, memory_order_relaxed);
+  stats->frames_corrupted_payload =
+    atomic_load_explicit(&s->frames_corrupted_payload, memory_order_relaxed);
+  stats->frames_ignored = atomic_load_explicit(&s->frames_ignored,
+                                               memory_order_relaxed);
+  stats->bytes_received = atomic_load_explicit(&s->bytes_received,
+                                               memory_order_relaxed);
+  stats->frames_sent = atomic_load_explicit(&s->frames_sent,
+                                            memory_order_relaxed);
+  stats->bytes_sent = atomic_load_explicit(&s->bytes_sent,
+                                           memory_order_relaxed);
+  stats->overflows = atomic_load_explicit(&s->overflows, memory_order_relaxed);
+  stats->underflows = atomic_load_explicit(&s->underflows,
+                                           memory_order_relaxed);
+  stats->timeouts = atomic_load_explicit(&s->timeouts, memory_order_relaxed);
+  stats->rssi = atomic_load_explicit(&s->rssi, memory_order_relaxed);
+  stats->evm = atomic_load_explicit(&s->evm, memory_order_relaxed);
+  stats->cfo = atomic_load_explicit(&s->cfo, memory_order_relaxed);
+  measured_frames = atomic_load_explicit(&s->measured_frames,
+                                         memory_order_relaxed);
+  if(measured_frames > 0)
+  {
+    stats->rssi_average = atomic_load_explicit(&s->rssi_sum,
+                                               memory_order_relaxed) /
+      measured_frames;
+    stats->evm_average = atomic_load_explicit(&s->evm_sum,
+                                              memory_order_relaxed) /
+      measured_frames;
+    stats->cfo_average = atomic_load_explicit(&s->cfo_sum,
+                                              memory_order_relaxed) /
+      measured_frames;
+  }
+  else
+  {
+    stats->rssi_average = 0;
+    stats->evm_average = 0;
+    stats->cfo_average = 0;
+  }
+}
 
-    default:
-      break;
-    }
-    free(transfer);
+int gmsk_transfer_set_metrics_file(gmsk_transfer_t transfer,
+                                   char *filename,
+                                   unsigned int period)
+{
+  metrics_free(transfer->metrics);
+  transfer->metrics = NULL;
+  if(filename == NULL)
+  {
+    return(0);
+  }
+  if(period == 0)
+  {
+    fprintf(stderr, _("Error: Invalid period for the metrics file\n"));
+    return(-1);
   }
+  transfer->metrics = metrics_create(transfer, filename, period);
+  if(transfer->metrics == NULL)
+  {
+    fprintf(stderr, _("Error: Failed to write the metrics file\n"));
+    return(-1);
+  }
+  return(0);
 }
 
-void gmsk_transfer_start(gmsk_transfer_t transfer)
+int gmsk_transfer_set_channels(gmsk_transfer_t transfer,
+                               unsigned int channels,
+                               int (*channel_callback)(void *,
+                                                       unsigned int,
+                                                       unsigned char *,
+                                                       unsigned int))
 {
-  stop = 0;
-  transfer->stop = 0;
+  unsigned int samples_per_symbol = ceilf(1 / transfer->bt);
 
-  switch(transfer->radio_type)
+  if(channels <= 1)
   {
-  case IO:
-    if(verbose)
-    {
-      fprintf(stderr, _("Info: Using IO pseudo-radio\n"));
-    }
-    break;
+    transfer->channels = 0;
+    transfer->channel_callback = NULL;
+    return(0);
+  }
+  if(transfer->emit)
+  {
+    fprintf(stderr, _("Error: Channels can only be used in receive mode\n"));
+    return(-1);
+  }
+  if((channels % 2) != 0)
+  {
+    fprintf(stderr, _("Error: The number of channels must be even\n"));
+    return(-1);
+  }
+  /* Each channel is sampled at (2 * sample_rate / channels) */
+  if((2.0 * transfer->sample_rate) / channels <
+     transfer->bit_rate * samples_per_symbol)
+  {
+    fprintf(stderr,
+            _("Error: Too many channels for this sample rate and bit rate\n"));
+    return(-1);
+  }
 
-  case FILENAME:
-    if(verbose)
-    {
-      fprintf(stderr, _("Info: Using FILENAME pseudo-radio\n"));
-    }
-    break;
+  transfer->channels = channels;
+  transfer->channel_callback = channel_callback;
+  return(0);
+}
 
-  case SOAPYSDR:
-    SoapySDRDevice_activateStream(transfer->radio_device.soapysdr,
-                                  transfer->radio_stream.soapysdr,
-                                  0,
-                                  0,
-                                  0);
-    break;
+long int gmsk_transfer_get_channel_frequency(gmsk_transfer_t transfer,
+                                             unsigned int channel)
+{
+  long int frequency;
+  long int spacing;
 
-  default:
-    return;
+  if(transfer->audio_converter)
+  {
+    frequency = transfer->frequency_offset + (transfer->sample_rate / 2);
+  }
+  else
+  {
+    frequency = transfer->frequency;
+  }
+  if(transfer->channels <= 1)
+  {
+    return(frequency);
   }
 
-  transfer->timeout_start = time(NULL);
-  if(transfer->emit)
+  spacing = transfer->sample_rate / transfer->channels;
+  if(channel < transfer->channels / 2)
   {
-    send_frames(transfer);
+    return(frequency + (channel * spacing));
   }
   else
   {
-    receive_frames(transfer);
+    return(frequency - ((transfer->channels - channel) * spacing));
   }
 }
 
@@ -23,6 +23,44 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 typedef struct gmsk_transfer_s *gmsk_transfer_t;
 
+/* Statistics of a transfer since its creation
+ *  - frames_received: frames whose data was delivered
+ *  - frames_corrupted_header: frames with a corrupted header
+ *  - frames_corrupted_payload: frames with a corrupted payload
+ *  - frames_ignored: frames with another id
+ *  - bytes_received: bytes of data delivered
+ *  - frames_sent: frames sent in transmit mode
+ *  - bytes_sent: bytes of data sent in transmit mode
+ *  - overflows: samples lost by the radio in receive mode
+ *  - underflows: samples missing for the radio in transmit mode
+ *  - timeouts: reads or writes of samples that timed out
+ *  - rssi, rssi_average: received signal strength of the last frame and
+ *    average over all the frames (in dB, relative to full scale)
+ *  - evm, evm_average: error vector magnitude of the demodulated symbols
+ *    of the last frame and average over all the frames (in dB)
+ *  - cfo, cfo_average: carrier frequency offset of the last frame and
+ *    average over all the frames (in Hertz)
+ */
+typedef struct
+{
+  unsigned long int frames_received;
+  unsigned long int frames_corrupted_header;
+  unsigned long int frames_corrupted_payload;
+  unsigned long int frames_ignored;
+  unsigned long long int bytes_received;
+  unsigned long int frames_sent;
+  unsigned long long int bytes_sent;
+  unsigned long int overflows;
+  unsigned long int underflows;
+  unsigned long int timeouts;
+  float rssi;
+  float rssi_average;
+  float evm;
+  float evm_average;
+  float cfo;
+  float cfo_average;
+} gmsk_transfer_stats_t;
+
 /* Set the verbosity level
  *  - v: if not 0, print some debug messages to stderr
  */
@@ -32,7 +70,8 @@ void gmsk_transfer_set_verbose(unsigned char v);
 unsigned char gmsk_transfer_is_verbose();
 
 /* Initialize a new transfer
- *  - radio_driver: radio to use (e.g. "io" or "driver=hackrf")
+ *  - radio_driver: radio to use (e.g. "io", "loopback", "sim=snr=10" or
+ *    "driver=hackrf")
  *  - emit: 1 for transmit mode; 0 for receive mode
  *  - file: in transmit mode, read data from this file
  *          in receive mode, write data to this file
@@ -89,7 +128,9 @@ gmsk_transfer_t gmsk_transfer_create(char *radio_driver,
  *
  * When emitting, the callback must try to read 'payload_size' bytes from
  * somewhere and put them into 'payload'. It must return the number of bytes
- * read, or -1 if the input stream is finished.
+ * read, or -1 if the input stream is finished. When no data is available,
+ * it can wait for some during gmsk_transfer_get_idle_timeout() milliseconds
+ * before returning 0.
  * When receiving, the callback must take 'payload_size' bytes from 'payload'
  * and write them somewhere. It must return only when all the bytes have been
  * written. The returned value should be the number of bytes written, but
@@ -118,12 +159,384 @@ gmsk_transfer_t gmsk_transfer_create_callback(char *radio_driver,
                                               unsigned int timeout,
                                               unsigned char audio);
 
+/* Initialize a new transfer using the radio of another transfer
+ *  - peer: transfer whose radio is used; it must go in the other direction
+ *  - emit: 1 for transmit mode; 0 for receive mode
+ *  - file: in transmit mode, read data from this file
+ *          in receive mode, write data to this file
+ *          if NULL, use stdin or stdout instead
+ *  - frequency: center frequency of the transfer in Hertz
+ *  - frequency_offset: set the frequency of the radio frequency_offset Hz
+ *    lower than the frequency of the transfer
+ *  - gain: gain of the radio transceiver in this direction
+ *  - channel: channel of the radio used in this direction
+ *
+ * The new transfer has its own stream on the device of the peer, which
+ * allows a full-duplex radio to transmit and receive at the same time in
+ * the same process, each transfer being started in its own thread. The
+ * other parameters (sample rate, bit rate, FEC, id, framing, ...) are copied
+ * from the peer. The radio is closed when both transfers have been freed.
+ * Only SoapySDR radios and the 'loopback' pseudo-radio can be shared.
+ * The 'loopback' pseudo-radio passes the samples of the transmitter to the
+ * receiver without changing them, so both transfers must use the same
+ * frequency and frequency offset; the end of the transmission ends the
+ * reception.
+ * The 'sim' pseudo-radio works like the 'loopback' pseudo-radio, but the
+ * samples go through a channel simulator. Its parameters are given after
+ * 'sim=' as a comma separated list, for example
+ * "sim=snr=12,cfo=50,drift=20,multipath=5,fading=1,seed=3,paced":
+ *  - snr: signal to noise ratio in dB
+ *  - cfo: carrier frequency offset in Hertz
+ *  - drift: difference between the sample clocks of the receiver and of the
+ *    transmitter in ppm
+ *  - multipath: delay spread of the echoes in microseconds
+ *  - fading: maximum Doppler frequency of the Rayleigh fading in Hertz
+ *  - seed: seed of the random number generator
+ *  - paced: send the samples at the sample rate instead of as fast as
+ *    possible
+ * If the transfer initialization fails, the function returns NULL.
+ */
+gmsk_transfer_t gmsk_transfer_create_shared(gmsk_transfer_t peer,
+                                            unsigned char emit,
+                                            char *file,
+                                            unsigned long int frequency,
+                                            long int frequency_offset,
+                                            char *gain,
+                                            unsigned int channel);
+
+/* Initialize a new transfer using the radio of another transfer and
+ * a callback
+ * The parameters are the same as gmsk_transfer_create_shared() except that
+ * the 'file' string is replaced by the 'data_callback' function pointer and
+ * the 'callback_context' pointer, which are used like in
+ * gmsk_transfer_create_callback().
+ */
+gmsk_transfer_t gmsk_transfer_create_shared_callback(gmsk_transfer_t peer,
+                                                     unsigned char emit,
+                                                     int (*data_callback)(void *,
+                                                                          unsigned char *,
+                                                                          unsigned int),
+                                                     void *callback_context,
+                                                     unsigned long int frequency,
+                                                     long int frequency_offset,
+                                                     char *gain,
+                                                     unsigned int channel);
+
+/* Get the number of milliseconds during which the data callback can wait
+ * for some data in transmit mode before the radio must be fed with silence
+ * When the callback returns 0 and this time is 0, a short block of silence
+ * is sent to the radio. */
+int gmsk_transfer_get_idle_timeout(gmsk_transfer_t transfer);
+
+/* Wait a little for more data before making a frame in transmit mode
+ *  - delay: maximum time in milliseconds during which data read from the
+ *    data callback can wait for more data filling the payload of a frame;
+ *    0 sends the data in a frame as soon as it is read
+ *
+ * When the payload is full or when the oldest data has waited for 'delay'
+ * ms, a frame is sent with the data available at that time.
+ * This function must be called before gmsk_transfer_start().
+ * It returns 0 on success and -1 on failure.
+ */
+int gmsk_transfer_set_coalescing_delay(gmsk_transfer_t transfer,
+                                       unsigned int delay);
+
+/* Send several frames behind the same preamble in transmit mode
+ *  - frames: maximum number of frames in a burst; 0 or 1 sends each frame
+ *    with its own preamble
+ *
+ * A frame is followed by another one in the same burst only if the data of
+ * the next frame is available before the radio runs out of samples. Each
+ * frame keeps its own header, CRC and counter.
+ * The frames of a burst are not encoded by the pipelined transmit path.
+ * This function must be called before gmsk_transfer_start().
+ * It returns 0 on success and -1 on failure.
+ */
+int gmsk_transfer_set_aggregation(gmsk_transfer_t transfer,
+                                  unsigned int frames);
+
+/* Set the lengths of the parts of the frames
+ *  - preamble_size: number of symbols of the preamble (15, 31, 63, 127 or
+ *    255, 63 by default)
+ *  - header_size: number of bytes of the header (from 4 to 8, 8 by default);
+ *    the header contains the id of the transfer, which can't be longer than
+ *    'header_size' - 4 bytes, and the counter of the frame
+ *  - ramp_size: number of symbols of the ramps at the start and at the end of
+ *    a burst in transmit mode (at most 'preamble_size'); a negative value
+ *    uses the delay of the modulation filter
+ *
+ * A short preamble reduces the overhead of the frames, but also the
+ * probability of detecting them when the signal is weak. The transmitter
+ * and the receiver must use the same preamble and header sizes.
+ * This function must be called before gmsk_transfer_start().
+ * It returns 0 on success and -1 on failure.
+ */
+int gmsk_transfer_set_framing(gmsk_transfer_t transfer,
+                              unsigned int preamble_size,
+                              unsigned int header_size,
+                              int ramp_size);
+
+/* Get statistics on the latency of the last transmission
+ *  - p50: if not NULL, set to the median latency in milliseconds
+ *  - p99: if not NULL, set to the 99th percentile of the latency in
+ *    milliseconds
+ *
+ * The latency of a frame is the time between the reading of the first byte
+ * of its payload from the data callback and the estimated time at which
+ * the radio has sent the end of the frame.
+ * The function returns the number of frames measured.
+ */
+unsigned long int gmsk_transfer_get_latency(gmsk_transfer_t transfer,
+                                            unsigned int *p50,
+                                            unsigned int *p99);
+
+/* Measure the time spent in each stage of the transmit or receive loop
+ *  - enable: 1 to measure the time, 0 to stop measuring it
+ *
+ * The stages are the radio (including the time spent waiting for it), the
+ * data callback, the assembly of the frames (with the FEC encoding), the
+ * modulator, the oscillator shifting the frequency, the squelch, the
+ * resampler and the frame synchronizer (with the FEC decoding, but without
+ * the data callback). Only the default transmit and receive paths are
+ * measured, not the pipelined, multi-channel, parallel decoding and audio
+ * ones. When verbose mode is active, a summary is printed at the end of the
+ * transfer. When profiling is disabled, the clock is not read at all.
+ * This function must be called before gmsk_transfer_start().
+ * It returns 0 on success and -1 on failure.
+ */
+int gmsk_transfer_set_profiling(gmsk_transfer_t transfer,
+                                unsigned char enable);
+
+/* Get the time spent in a stage of the transmit or receive loop
+ *  - stage: index of the stage, starting from 0
+ *  - calls: if not NULL, set to the number of times the stage was run
+ *  - total: if not NULL, set to the total time spent in the stage in
+ *    nanoseconds
+ *  - p50: if not NULL, set to the median time of a run of the stage in
+ *    nanoseconds
+ *  - p99: if not NULL, set to the 99th percentile of the time of a run of
+ *    the stage in nanoseconds
+ *
+ * The times are measured since the start of the current or last transfer,
+ * and they can be read while the transfer is running. The percentiles
+ * come from a histogram with a precision of 25%.
+ * The function returns the name of the stage, or NULL if there is no stage
+ * with this index.
+ */
+const char * gmsk_transfer_get_stage_time(gmsk_transfer_t transfer,
+                                          unsigned int stage,
+                                          unsigned long int *calls,
+                                          unsigned long long int *total,
+                                          unsigned long long int *p50,
+                                          unsigned long long int *p99);
+
+/* Get the statistics of a transfer
+ *  - stats: set to the statistics since the creation of the transfer
+ *
+ * The statistics are updated without locks by the threads of the transfer,
+ * so this function can be called at any time, even while the transfer is
+ * running. The signal measures (RSSI, EVM and CFO) come from the frames
+ * whose payload was demodulated, and are 0 until there is one.
+ */
+void gmsk_transfer_get_stats(gmsk_transfer_t transfer,
+                             gmsk_transfer_stats_t *stats);
+
+/* Export the statistics of a transfer to a file
+ *  - filename: file written in the text format of Prometheus (for example
+ *    for the textfile collector of node_exporter); NULL stops the export
+ *  - period: number of seconds between two updates of the file
+ *
+ * The statistics (see gmsk_transfer_get_stats()) are written to a temporary
+ * file renamed to 'filename', so that a reader never sees a partial file.
+ * The file is written immediately, then every 'period' seconds by another
+ * thread until the transfer is freed, and a last time when it is freed.
+ * It returns 0 on success and -1 on failure.
+ */
+int gmsk_transfer_set_metrics_file(gmsk_transfer_t transfer,
+                                   char *filename,
+                                   unsigned int period);
+
+/* Use a pipelined transmit or receive path
+ *  - ring_size: in receive mode, capacity of the rings between the stages of
+ *    the pipeline, in blocks of 50 ms of samples; in transmit mode, number of
+ *    frames that can be encoded in advance; 0 disables the pipeline
+ *
+ * In receive mode, the radio capture, the front-end DSP (frequency shift and
+ * resampling), the frame synchronization and the delivery of the payloads to
+ * the callback run on separate threads, so that a slow callback or a slow
+ * FEC decoder doesn't stop the reading of the samples from the radio.
+ * In transmit mode, the next frames are assembled and modulated by worker
+ * threads while the current frame is being sent to the radio.
+ * When verbose mode is active, the highest fill levels of the queues are
+ * printed at the end of the transfer.
+ * This function must be called before gmsk_transfer_start().
+ * It returns 0 on success and -1 on failure.
+ */
+int gmsk_transfer_set_pipeline(gmsk_transfer_t transfer,
+                               unsigned int ring_size);
+
+/* Skip the processing of the samples when there is only noise
+ *  - threshold: power in the band of the signal above the noise floor that
+ *    opens the gate (in dB); 0 disables the squelch
+ *
+ * The noise floor is estimated continuously. While the gate is closed,
+ * the samples don't go through the resampler and the frame synchronizer,
+ * but the last ones are kept so that the beginning of a frame is not lost
+ * when the gate opens. The squelch is not used in multi-channel mode.
+ * This function must be called before gmsk_transfer_start().
+ * It returns 0 on success and -1 on failure.
+ */
+int gmsk_transfer_set_squelch(gmsk_transfer_t transfer, float threshold);
+
+/* Get the number of samples received by the last reception with a squelch,
+ * and how many of them were skipped because the gate was closed */
+void gmsk_transfer_get_squelch_counters(gmsk_transfer_t transfer,
+                                        unsigned long int *samples,
+                                        unsigned long int *gated_samples);
+
+/* Start the transmission at a given time of the clock of the radio
+ *  - time: time in nanoseconds; 0 starts the transmission immediately
+ *  - relative: if 1, the time is relative to the start of the transfer
+ *    instead of being an absolute time of the clock of the radio
+ *
+ * The first samples of the transmission are written with this timestamp,
+ * and the radio sends them when its clock reaches it. This can only be
+ * used in transmit mode with a SoapySDR radio having a hardware clock.
+ * This function must be called before gmsk_transfer_start().
+ * It returns 0 on success and -1 on failure.
+ */
+int gmsk_transfer_set_start_time(gmsk_transfer_t transfer,
+                                 long long int time,
+                                 unsigned char relative);
+
+/* Get the current time of the clock of the radio in nanoseconds, or -1 if
+ * the radio has no hardware clock */
+long long int gmsk_transfer_get_hardware_time(gmsk_transfer_t transfer);
+
+/* Get the time at which the start of the frame being delivered was received
+ *
+ * This function is meant to be called from the data callback in receive
+ * mode. The time is in nanoseconds on the clock of the radio, using the
+ * timestamps of the samples given by the driver. For the pseudo-radios, it
+ * is the time since the start of the transfer computed from the number of
+ * samples received. It returns -1 if the time is not known, which is the
+ * case with the pipelined, multi-channel, parallel decoding and audio
+ * receive paths.
+ */
+long long int gmsk_transfer_get_frame_time(gmsk_transfer_t transfer);
+
+/* Receive on several channels at the same time
+ *  - channels: number of channels; it must be even, and 0 or 1 disables the
+ *    multi-channel mode
+ *  - channel_callback: function called with the data received on a channel;
+ *    if NULL, the data callback of the transfer is used instead
+ *
+ * The samples received from the radio are split by a polyphase channelizer
+ * into 'channels' channels spaced by (sample_rate / channels) Hz. Channel 0
+ * is centered on the frequency of the transfer, channels 1 to
+ * (channels / 2 - 1) are above it, and the next channels are below it.
+ * A frame synchronizer runs for each channel on a pool of threads.
+ * The channel callback must have the following type:
+ *
+ *  int callback(void *context,
+ *               unsigned int channel,
+ *               unsigned char *payload,
+ *               unsigned int payload_size)
+ *
+ * It is used like the data callback in receive mode, but it also gets the
+ * index of the channel on which the payload was received. The callbacks are
+ * never called by several threads at the same time.
+ * This function must be called before gmsk_transfer_start(). The pipelined
+ * receive path is not used in multi-channel mode.
+ * It returns 0 on success and -1 on failure.
+ */
+int gmsk_transfer_set_channels(gmsk_transfer_t transfer,
+                               unsigned int channels,
+                               int (*channel_callback)(void *,
+                                                       unsigned int,
+                                                       unsigned char *,
+                                                       unsigned int));
+
+/* Get the center frequency of a channel in Hertz */
+long int gmsk_transfer_get_channel_frequency(gmsk_transfer_t transfer,
+                                             unsigned int channel);
+
+/* Decode a recording on several threads
+ *  - jobs: number of threads; 0 uses one thread per processor, and 1
+ *    disables the parallel decoding
+ *
+ * The parallel decoding can only be used to receive from a 'file' radio
+ * containing a complete recording. The recording is split into overlapping
+ * chunks which are decoded at the same time by independent frame
+ * synchronizers, and the data are delivered in the order of the recording.
+ * This function must be called before gmsk_transfer_start().
+ * It returns 0 on success and -1 on failure.
+ */
+int gmsk_transfer_set_jobs(gmsk_transfer_t transfer, unsigned int jobs);
+
+/* Set the format of the IQ samples sent to or received from the radio
+ *  - format: "cf32" (complex float, the default), "cs16" (complex signed
+ *    16-bit integers) or "cs8" (complex signed 8-bit integers)
+ *
+ * The samples are converted from or to complex float for the processing,
+ * and the dump file uses the same format. The format can't be changed in
+ * audio mode.
+ * This function must be called before gmsk_transfer_start().
+ * It returns 0 on success and -1 on failure.
+ */
+int gmsk_transfer_set_sample_format(gmsk_transfer_t transfer, char *format);
+
 /* Cleanup after a finished transfer */
 void gmsk_transfer_free(gmsk_transfer_t transfer);
 
 /* Start a transfer and return when finished */
 void gmsk_transfer_start(gmsk_transfer_t transfer);
 
+/* Prepare a finished transfer to be started again
+ *
+ * The radio stays open and tuned, and the objects of the modulation or
+ * demodulation are kept, so that the next call to gmsk_transfer_start()
+ * doesn't have to create them again. The stream of the radio is stopped
+ * until the transfer is started again, and in receive mode the samples
+ * received in the meantime are not processed.
+ * The parameters of the transfer can be changed by the setters before the
+ * transfer is started again; the frame generator and synchronizer are made
+ * again when the framing changes. The sample rate, the bit rate and the BT
+ * given when the transfer was created can't be changed.
+ * With the 'loopback' and 'sim' pseudo-radios, the samples waiting in the
+ * radio are dropped, and both transfers sharing the radio must be reset
+ * before one of them is started again.
+ * This function must not be called while gmsk_transfer_start() is running.
+ */
+void gmsk_transfer_reset(gmsk_transfer_t transfer);
+
+/* Change the direction of a finished transfer for half-duplex operation
+ *  - emit: 1 to transmit, 0 to receive
+ *  - gain: gain of the radio in the new direction (same format as in
+ *    gmsk_transfer_create_callback()), or NULL to keep the previous gain of
+ *    this direction
+ *  - data_callback: data callback used in the new direction
+ *  - callback_context: context passed to the data callback
+ *
+ * The radio keeps a stream for each direction. The first time the transfer
+ * goes in a direction, the radio is tuned and the stream is made; the next
+ * switches only stop one stream and start the other, and the objects of the
+ * modulation and demodulation are kept.
+ * When verbose mode is active, the time between the end of the previous run
+ * and the start of the next one in the other direction is printed.
+ * The direction can't be changed with the 'file' pseudo-radio.
+ * The transfer is reset like by gmsk_transfer_reset().
+ * This function must not be called while gmsk_transfer_start() is running.
+ * It returns 0 on success and -1 on failure.
+ */
+int gmsk_transfer_switch_direction(gmsk_transfer_t transfer,
+                                   unsigned char emit,
+                                   char *gain,
+                                   int (*data_callback)(void *,
+                                                        unsigned char *,
+                                                        unsigned int),
+                                   void *callback_context);
+
 /* Interrupt a transfer */
 void gmsk_transfer_stop(gmsk_transfer_t transfer);
 
@@ -0,0 +1,434 @@
+/*
+This file is part of gmsk-transfer, a program to send or receive data
+by software defined radio using the GMSK modulation.
+
+Copyright 2022 Guillaume LE VAILLANT
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+This file includes a variation of the code from the liquid-dsp library to
+create a gmskframegen object. The original code has the following license:
+
+Copyright (c) 2007 - 2022 Joseph Gaeddert
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include <complex.h>
+#include <liquid/liquid.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "gmskburstgen.h"
+
+#define GMSKFRAME_H_USER_DEFAULT 8
+
+// gmskburstgen object structure
+struct gmskburstgen_s {
+    gmskmod mod;                    // GMSK modulator
+    unsigned int k;                 // filter samples/symbol
+    unsigned int m;                 // filter semi-length (symbols)
+    float BT;                       // filter bandwidth-time product
+
+    // preamble
+    unsigned int preamble_len;      // number of symbols in preamble
+    msequence ms_preamble;          // preamble p/n sequence generator
+
+    // header
+    unsigned int header_user_len;   // length of user-defined header
+    unsigned int header_dec_len;    // length of header (decoded)
+    unsigned int header_enc_len;    // length of header (encoded)
+    unsigned char * header_dec;     // header data (decoded bytes)
+    unsigned char * header_enc;     // header data (encoded bytes)
+    packetizer p_header;            // header packetizer
+
+    // payload
+    unsigned int payload_dec_len;   // payload length (num un-encoded bytes)
+    unsigned int payload_enc_len;   // length of encoded payload
+    unsigned char * payload_enc;    // payload data (encoded bytes)
+    packetizer p_payload;           // payload packetizer
+
+    // ramps
+    unsigned int ramp_len;          // number of symbols of the ramps
+    unsigned int tail_len;          // number of symbols in tail
+
+    // framing state
+    enum {
+        STATE_PREAMBLE=0,           // write p/n sequence
+        STATE_HEADER,               // write header data
+        STATE_PAYLOAD,              // write payload data
+        STATE_TAIL,                 // write tail (ramp down)
+    } state;
+    int frame_assembled;            // frame assembled and not written yet?
+    int frame_more;                 // another frame follows in the burst?
+    int burst_open;                 // previous frame followed by this one?
+    unsigned int symbol_counter;    // counter: num of symbols written
+    float complex * buf;            // samples of current symbol, [size: k x 1]
+    unsigned int buf_index;         // index of next sample in buf
+};
+
+// create GMSK burst generator
+//  _k          :   samples/symbol
+//  _m          :   filter delay (symbols)
+//  _BT         :   excess bandwidth factor
+gmskburstgen gmskburstgen_create(unsigned int _k,
+                                 unsigned int _m,
+                                 float        _BT)
+{
+    gmskburstgen q = (gmskburstgen) malloc(sizeof(struct gmskburstgen_s));
+    q->k  = _k;         // samples/symbol
+    q->m  = _m;         // filter delay (symbols)
+    q->BT = _BT;        // filter bandwidth-time product
+
+    // create modulator
+    q->mod = gmskmod_create(q->k, q->m, q->BT);
+    q->buf = (float complex*) malloc(q->k*sizeof(float complex));
+
+    // same p/n sequence as the one of liquid-dsp by default
+    q->preamble_len = GMSKFRAME_PREAMBLE_DEFAULT;
+    q->ms_preamble  = gmskburstgen_create_preamble(q->preamble_len);
+
+    // flush the modulator and ramp down at the end of the burst
+    q->ramp_len = q->m;
+    q->tail_len = q->m + q->ramp_len;
+
+    // create/allocate header objects/arrays
+    q->frame_assembled = 0;
+    q->header_dec = NULL;
+    q->header_enc = NULL;
+    q->p_header   = NULL;
+    gmskburstgen_set_header_len(q, GMSKFRAME_H_USER_DEFAULT);
+
+    // create/allocate payload objects/arrays
+    q->payload_dec_len = 1;
+    q->p_payload = packetizer_create(q->payload_dec_len,
+                                     LIQUID_CRC_NONE,
+                                     LIQUID_FEC_NONE,
+                                     LIQUID_FEC_NONE);
+    q->payload_enc_len = packetizer_get_enc_msg_len(q->p_payload);
+    q->payload_enc = (unsigned char*) malloc(q->payload_enc_len*sizeof(unsigned char));
+
+    // reset generator
+    gmskburstgen_reset(q);
+
+    return q;
+}
+
+// create the p/n sequence of a preamble
+//  _len        :   number of symbols in the preamble (2^n - 1, with n
+//                  between 4 and 8)
+msequence gmskburstgen_create_preamble(unsigned int _len)
+{
+    switch (_len) {
+    case 63:
+        // sequence used by liquid-dsp
+        return msequence_create(6, 0x6d, 1);
+    case 15:
+    case 31:
+    case 127:
+    case 255:
+        return msequence_create_default(liquid_nextpow2(_len + 1));
+    default:
+        return NULL;
+    }
+}
+
+// destroy GMSK burst generator
+int gmskburstgen_destroy(gmskburstgen _q)
+{
+    gmskmod_destroy(_q->mod);
+    msequence_destroy(_q->ms_preamble);
+    packetizer_destroy(_q->p_header);
+    packetizer_destroy(_q->p_payload);
+    free(_q->header_dec);
+    free(_q->header_enc);
+    free(_q->payload_enc);
+    free(_q->buf);
+    free(_q);
+    return LIQUID_OK;
+}
+
+// reset GMSK burst generator, closing the current burst
+int gmskburstgen_reset(gmskburstgen _q)
+{
+    gmskmod_reset(_q->mod);
+    msequence_reset(_q->ms_preamble);
+
+    _q->state           = STATE_PREAMBLE;
+    _q->frame_assembled = 0;
+    _q->frame_more      = 0;
+    _q->burst_open      = 0;
+    _q->symbol_counter  = 0;
+    _q->buf_index       = _q->k;
+    return LIQUID_OK;
+}
+
+// set the length of the user-defined header
+//  _q          :   burst generator object
+//  _len        :   number of bytes of the user header
+int gmskburstgen_set_header_len(gmskburstgen _q,
+                                unsigned int _len)
+{
+    if (_q->frame_assembled)
+        return liquid_error(LIQUID_EICONFIG,"gmskburstgen_set_header_len(), frame is already assembled; must reset() first");
+
+    _q->header_user_len = _len;
+    _q->header_dec_len  = GMSKFRAME_H_DEC + _q->header_user_len;
+    _q->header_dec = (unsigned char*) realloc(_q->header_dec, _q->header_dec_len*sizeof(unsigned char));
+
+    if (_q->p_header != NULL)
+        packetizer_destroy(_q->p_header);
+    _q->p_header = packetizer_create(_q->header_dec_len,
+                                     GMSKFRAME_H_CRC,
+                                     GMSKFRAME_H_FEC,
+                                     LIQUID_FEC_NONE);
+    _q->header_enc_len = packetizer_get_enc_msg_len(_q->p_header);
+    _q->header_enc = (unsigned char*) realloc(_q->header_enc, _q->header_enc_len*sizeof(unsigned char));
+    return LIQUID_OK;
+}
+
+// set the number of symbols of the preamble
+//  _q          :   burst generator object
+//  _len        :   number of symbols in the preamble (15, 31, 63, 127 or 255)
+int gmskburstgen_set_preamble_len(gmskburstgen _q,
+                                  unsigned int _len)
+{
+    if (_q->frame_assembled)
+        return liquid_error(LIQUID_EICONFIG,"gmskburstgen_set_preamble_len(), frame is already assembled; must reset() first");
+    msequence ms = gmskburstgen_create_preamble(_len);
+    if (ms == NULL)
+        return liquid_error(LIQUID_EICONFIG,"gmskburstgen_set_preamble_len(), invalid preamble length %u", _len);
+    if (_q->ramp_len > _len)
+        return liquid_error(LIQUID_EICONFIG,"gmskburstgen_set_preamble_len(), preamble shorter than the ramp");
+
+    msequence_destroy(_q->ms_preamble);
+    _q->ms_preamble  = ms;
+    _q->preamble_len = _len;
+    return LIQUID_OK;
+}
+
+// set the number of symbols of the ramps at the start and at the end of a
+// burst
+//  _q          :   burst generator object
+//  _len        :   number of symbols of the ramps (at most the length of
+//                  the preamble)
+int gmskburstgen_set_ramp_len(gmskburstgen _q,
+                              unsigned int _len)
+{
+    if (_q->frame_assembled)
+        return liquid_error(LIQUID_EICONFIG,"gmskburstgen_set_ramp_len(), frame is already assembled; must reset() first");
+    if (_len > _q->preamble_len)
+        return liquid_error(LIQUID_EICONFIG,"gmskburstgen_set_ramp_len(), ramp longer than the preamble");
+
+    _q->ramp_len = _len;
+    _q->tail_len = _q->m + _q->ramp_len;
+    return LIQUID_OK;
+}
+
+// encode header, using the same format as gmskframegen
+static int gmskburstgen_encode_header(gmskburstgen          _q,
+                                      const unsigned char * _header,
+                                      crc_scheme            _check,
+                                      fec_scheme            _fec0,
+                                      fec_scheme            _fec1)
+{
+    // first 'n' bytes user data
+    unsigned int n = _q->header_user_len;
+    if (_header == NULL)
+        memset(_q->header_dec, 0x00, n);
+    else
+        memmove(_q->header_dec, _header, n);
+
+    // first byte is for expansion/version validation
+    _q->header_dec[n+0] = GMSKFRAME_VERSION;
+
+    // add payload length
+    _q->header_dec[n+1] = (_q->payload_dec_len >> 8) & 0xff;
+    _q->header_dec[n+2] = (_q->payload_dec_len     ) & 0xff;
+
+    // add CRC, forward error-correction schemes
+    //  CRC     : most-significant 3 bits of [n+3]
+    //  fec0    : least-significant 5 bits of [n+3]
+    //  fec1    : least-significant 5 bits of [n+4]
+    //  more    : most-significant bit of [n+4]
+    _q->header_dec[n+3]  = (_check & 0x07) << 5;
+    _q->header_dec[n+3] |= (_fec0) & 0x1f;
+    _q->header_dec[n+4]  = (_fec1) & 0x1f;
+    if (_q->frame_more)
+        _q->header_dec[n+4] |= GMSKFRAME_H_MORE;
+
+    // run packet encoder
+    packetizer_encode(_q->p_header, _q->header_dec, _q->header_enc);
+
+    // scramble header
+    scramble_data(_q->header_enc, _q->header_enc_len);
+    return LIQUID_OK;
+}
+
+// assemble the next frame of the burst
+int gmskburstgen_assemble(gmskburstgen          _q,
+                          const unsigned char * _header,
+                          const unsigned char * _payload,
+                          unsigned int          _payload_len,
+                          crc_scheme            _check,
+                          fec_scheme            _fec0,
+                          fec_scheme            _fec1,
+                          int                   _more)
+{
+    if (_q->frame_assembled)
+        return liquid_error(LIQUID_EICONFIG,"gmskburstgen_assemble(), previous frame has not been written");
+
+    // re-create payload packetizer
+    _q->payload_dec_len = _payload_len;
+    _q->p_payload = packetizer_recreate(_q->p_payload,
+                                        _q->payload_dec_len,
+                                        _check,
+                                        _fec0,
+                                        _fec1);
+    _q->payload_enc_len = packetizer_get_enc_msg_len(_q->p_payload);
+    _q->payload_enc = (unsigned char*) realloc(_q->payload_enc, _q->payload_enc_len*sizeof(unsigned char));
+
+    // encode header and payload
+    _q->frame_more = _more ? 1 : 0;
+    gmskburstgen_encode_header(_q, _header, _check, _fec0, _fec1);
+    packetizer_encode(_q->p_payload, _payload, _q->payload_enc);
+
+    // the frames following another one in the burst reuse its preamble
+    _q->state           = _q->burst_open ? STATE_HEADER : STATE_PREAMBLE;
+    _q->symbol_counter  = 0;
+    _q->frame_assembled = 1;
+    return LIQUID_OK;
+}
+
+// amplitude of the signal at the start and at the end of the burst
+static float gmskburstgen_ramp(gmskburstgen _q,
+                               unsigned int _i)
+{
+    return 0.5f - 0.5f*cosf(M_PI * (float)_i / (float)(_q->ramp_len*_q->k));
+}
+
+// compute the samples of the next symbol of the frame
+//  returns 1 if it is the last symbol of the frame, 0 otherwise
+static int gmskburstgen_write_symbol(gmskburstgen _q)
+{
+    unsigned int i;
+    unsigned char bit;
+    unsigned int len;
+
+    switch (_q->state) {
+    case STATE_PREAMBLE:
+        bit = msequence_advance(_q->ms_preamble);
+        gmskmod_modulate(_q->mod, bit, _q->buf);
+
+        // ramp up during the first symbols
+        if (_q->symbol_counter < _q->ramp_len) {
+            for (i=0; i<_q->k; i++)
+                _q->buf[i] *= gmskburstgen_ramp(_q, _q->symbol_counter*_q->k + i);
+        }
+        len = _q->preamble_len;
+        break;
+    case STATE_HEADER:
+        bit = (_q->header_enc[_q->symbol_counter/8] >> (7 - _q->symbol_counter%8)) & 0x01;
+        gmskmod_modulate(_q->mod, bit, _q->buf);
+        len = 8*_q->header_enc_len;
+        break;
+    case STATE_PAYLOAD:
+        bit = (_q->payload_enc[_q->symbol_counter/8] >> (7 - _q->symbol_counter%8)) & 0x01;
+        gmskmod_modulate(_q->mod, bit, _q->buf);
+        len = 8*_q->payload_enc_len;
+        break;
+    case STATE_TAIL:
+    default:
+        // flush the last bits of the payload from the modulator, then ramp
+        // down during the last symbols
+        bit = rand() & 0x01;
+        gmskmod_modulate(_q->mod, bit, _q->buf);
+        if (_q->symbol_counter >= _q->m) {
+            for (i=0; i<_q->k; i++)
+                _q->buf[i] *= gmskburstgen_ramp(_q, (_q->tail_len - _q->symbol_counter)*_q->k - i - 1);
+        }
+        len = _q->tail_len;
+        break;
+    }
+
+    _q->symbol_counter++;
+    if (_q->symbol_counter < len)
+        return 0;
+
+    // go to next section of the frame
+    _q->symbol_counter = 0;
+    switch (_q->state) {
+    case STATE_PREAMBLE:
+        msequence_reset(_q->ms_preamble);
+        _q->state = STATE_HEADER;
+        return 0;
+    case STATE_HEADER:
+        _q->state = STATE_PAYLOAD;
+        return 0;
+    case STATE_PAYLOAD:
+        if (_q->frame_more) {
+            // the next frame starts right after this one
+            _q->burst_open = 1;
+            return 1;
+        }
+        _q->state = STATE_TAIL;
+        return 0;
+    case STATE_TAIL:
+    default:
+        gmskburstgen_reset(_q);
+        return 1;
+    }
+}
+
+// write samples of the assembled frame, padding the buffer with zeros
+// after the end of the frame
+//  _q          :   burst generator object
+//  _buf        :   output buffer, [size: _buf_len x 1]
+//  _buf_len    :   number of samples to write
+int gmskburstgen_write(gmskburstgen    _q,
+                       float complex * _buf,
+                       unsigned int    _buf_len)
+{
+    unsigned int i;
+    for (i=0; i<_buf_len; i++) {
+        if (_q->buf_index == _q->k) {
+            if (!_q->frame_assembled) {
+                _buf[i] = 0.0f;
+                continue;
+            }
+            if (gmskburstgen_write_symbol(_q))
+                _q->frame_assembled = 0;
+            _q->buf_index = 0;
+        }
+        _buf[i] = _q->buf[_q->buf_index++];
+    }
+    return !_q->frame_assembled && _q->buf_index == _q->k;
+}
@@ -0,0 +1,109 @@
+/*
+This file is part of gmsk-transfer, a program to send or receive data
+by software defined radio using the GMSK modulation.
+
+Copyright 2022 Guillaume LE VAILLANT
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef GMSKBURSTGEN_H
+#define GMSKBURSTGEN_H
+
+#include <liquid/liquid.h>
+
+// The frames have the same format as the ones of the gmskframegen object of
+// liquid-dsp, but several frames can be sent in a burst behind a single
+// preamble. The bits of the byte containing the outer FEC scheme in the
+// header that are not used by liquid-dsp indicate whether another frame
+// follows in the same burst.
+#define GMSKFRAME_VERSION           (4)
+#define GMSKFRAME_H_DEC             (5)
+#define GMSKFRAME_H_CRC             (LIQUID_CRC_32)
+#define GMSKFRAME_H_FEC             (LIQUID_FEC_HAMMING128)
+#define GMSKFRAME_H_MORE            (0x80)
+#define GMSKFRAME_PREAMBLE_DEFAULT  (63)
+
+typedef struct gmskburstgen_s * gmskburstgen;
+
+// create GMSK burst generator
+//  _k          :   samples/symbol
+//  _m          :   filter delay (symbols)
+//  _BT         :   excess bandwidth factor
+gmskburstgen gmskburstgen_create(unsigned int _k,
+                                 unsigned int _m,
+                                 float        _BT);
+
+// create the p/n sequence of a preamble, shared with gmskframesync
+//  _len        :   number of symbols in the preamble (15, 31, 63, 127 or 255)
+//  returns NULL if the length is not valid
+msequence gmskburstgen_create_preamble(unsigned int _len);
+
+// destroy GMSK burst generator
+int gmskburstgen_destroy(gmskburstgen _q);
+
+// reset GMSK burst generator, closing the current burst
+int gmskburstgen_reset(gmskburstgen _q);
+
+// set the length of the user-defined header
+//  _q          :   burst generator object
+//  _len        :   number of bytes of the user header
+int gmskburstgen_set_header_len(gmskburstgen _q,
+                                unsigned int _len);
+
+// set the number of symbols of the preamble
+//  _q          :   burst generator object
+//  _len        :   number of symbols in the preamble (15, 31, 63, 127 or 255)
+int gmskburstgen_set_preamble_len(gmskburstgen _q,
+                                  unsigned int _len);
+
+// set the number of symbols of the ramps at the start and at the end of a
+// burst (by default, the filter delay)
+//  _q          :   burst generator object
+//  _len        :   number of symbols of the ramps (at most the length of
+//                  the preamble)
+int gmskburstgen_set_ramp_len(gmskburstgen _q,
+                              unsigned int _len);
+
+// assemble the next frame of the burst
+//  _q          :   burst generator object
+//  _header     :   user header
+//  _payload    :   payload data, [size: _payload_len x 1]
+//  _payload_len:   number of bytes of payload
+//  _check      :   payload validity check
+//  _fec0       :   payload FEC (inner)
+//  _fec1       :   payload FEC (outer)
+//  _more       :   1 if another frame follows this one in the burst; the
+//                  frame is then written without tail, and the next one
+//                  without preamble
+int gmskburstgen_assemble(gmskburstgen          _q,
+                          const unsigned char * _header,
+                          const unsigned char * _payload,
+                          unsigned int          _payload_len,
+                          crc_scheme            _check,
+                          fec_scheme            _fec0,
+                          fec_scheme            _fec1,
+                          int                   _more);
+
+// write samples of the assembled frame, padding the buffer with zeros
+// after the end of the frame
+//  _q          :   burst generator object
+//  _buf        :   output buffer, [size: _buf_len x 1]
+//  _buf_len    :   number of samples to write
+//  returns 1 when the whole frame has been written, 0 otherwise
+int gmskburstgen_write(gmskburstgen    _q,
+                       float complex * _buf,
+                       unsigned int    _buf_len);
+
+#endif
@@ -44,10 +44,15 @@ THE SOFTWARE.
 
 #include <complex.h>
 #include <liquid/liquid.h>
+#include <math.h>
 #include <stdlib.h>
+#include <string.h>
+#include "gmskburstgen.h"
+#include "gmskframesync.h"
 
 #define GMSKFRAME_H_USER_DEFAULT 8
 #define GMSKFRAMESYNC_PREFILTER 1
+#define GMSKFRAMESYNC_HEADER_FILTER_MAX 16
 
 // gmskframesync object structure
 struct gmskframesync_s {
@@ -121,8 +126,67 @@ struct gmskframesync_s {
     unsigned int preamble_counter;  // counter: num of p/n syms received
     unsigned int header_counter;    // counter: num of header syms received
     unsigned int payload_counter;   // counter: num of payload syms received
+
+    // early rejection of frames (only used by gmskframesync_execute_filtered)
+    unsigned char header_filter[GMSKFRAMESYNC_HEADER_FILTER_MAX*GMSKFRAME_H_USER_DEFAULT];
+    unsigned int header_filter_len; // number of bytes compared
+    unsigned int header_filter_num; // number of accepted user headers
+    int header_checked;             // user header of current frame checked?
+    unsigned int num_rejected;      // counter: num of frames rejected
+
+    // frame detector parameters
+    float dphi_max;                 // maximum carrier offset allowable
+
+    // position of the frames (only used by gmskframesync_execute_filtered)
+    unsigned long long int num_samples; // counter: num of samples processed
+    unsigned long long int frame_start; // index of first sample of frame
+
+    // statistics of the soft symbols of the payload, for the EVM estimate
+    float evm_sum;                  // sum of the magnitudes
+    float evm_sum2;                 // sum of the squared magnitudes
 };
 
+// create the frame detector for a preamble of _len symbols
+static int gmskframesync_create_detector(gmskframesync _q,
+                                         unsigned int  _len)
+{
+    msequence ms = gmskburstgen_create_preamble(_len);
+    if (ms == NULL)
+        return liquid_error(LIQUID_EICONFIG,"gmskframesync_set_preamble_len(), invalid preamble length %u", _len);
+
+    unsigned int i;
+    _q->preamble_len = _len;
+    _q->preamble_pn = (float*)realloc(_q->preamble_pn, _q->preamble_len*sizeof(float));
+    _q->preamble_rx = (float*)realloc(_q->preamble_rx, _q->preamble_len*sizeof(float));
+    float complex preamble_samples[_q->preamble_len*_q->k];
+    gmskmod mod = gmskmod_create(_q->k, _q->m, _q->BT);
+
+    for (i=0; i<_q->preamble_len + _q->m; i++) {
+        unsigned char bit = msequence_advance(ms);
+
+        // save p/n sequence
+        if (i < _q->preamble_len)
+            _q->preamble_pn[i] = bit ? 1.0f : -1.0f;
+
+        // modulate/interpolate
+        if (i < _q->m) gmskmod_modulate(mod, bit, &preamble_samples[0]);
+        else           gmskmod_modulate(mod, bit, &preamble_samples[(i-_q->m)*_q->k]);
+    }
+
+    gmskmod_destroy(mod);
+    msequence_destroy(ms);
+
+    // create frame detector
+    float threshold = 0.5f;     // detection threshold
+    if (_q->frame_detector != NULL)
+        detector_cccf_destroy(_q->frame_detector);
+    if (_q->buffer != NULL)
+        windowcf_destroy(_q->buffer);
+    _q->frame_detector = detector_cccf_create(preamble_samples, _q->preamble_len*_q->k, threshold, _q->dphi_max);
+    _q->buffer = windowcf_create(_q->k*(_q->preamble_len+_q->m));
+    return LIQUID_OK;
+}
+
 // create GMSK frame synchronizer
 //  _k          :   samples/symbol
 //  _m          :   filter delay (symbols)
@@ -149,35 +213,13 @@ gmskframesync gmskframesync_create_set2(unsigned int       _k,
     q->prefilter = iirfilt_crcf_create_lowpass(3, 0.5f*(1 + q->BT) / (float)(q->k));
 #endif
 
-    unsigned int i;
-
     // frame detector
-    q->preamble_len = 63;
-    q->preamble_pn = (float*)malloc(q->preamble_len*sizeof(float));
-    q->preamble_rx = (float*)malloc(q->preamble_len*sizeof(float));
-    float complex preamble_samples[q->preamble_len*q->k];
-    msequence ms = msequence_create(6, 0x6d, 1);
-    gmskmod mod = gmskmod_create(q->k, q->m, q->BT);
-
-    for (i=0; i<q->preamble_len + q->m; i++) {
-        unsigned char bit = msequence_advance(ms);
-
-        // save p/n sequence
-        if (i < q->preamble_len)
-            q->preamble_pn[i] = bit ? 1.0f : -1.0f;
-
-        // modulate/interpolate
-        if (i < q->m) gmskmod_modulate(mod, bit, &preamble_samples[0]);
-        else          gmskmod_modulate(mod, bit, &preamble_samples[(i-q->m)*q->k]);
-    }
-
-    gmskmod_destroy(mod);
-    msequence_destroy(ms);
-
-    // create frame detector
-    float threshold = 0.5f;     // detection threshold
-    q->frame_detector = detector_cccf_create(preamble_samples, q->preamble_len*q->k, threshold, _dphi_max);
-    q->buffer = windowcf_create(q->k*(q->preamble_len+q->m));
+    q->dphi_max       = _dphi_max;
+    q->preamble_pn    = NULL;
+    q->preamble_rx    = NULL;
+    q->frame_detector = NULL;
+    q->buffer         = NULL;
+    gmskframesync_create_detector(q, GMSKFRAME_PREAMBLE_DEFAULT);
 
     // create symbol timing recovery filters
     q->npfb = 32;   // number of filters in the bank
@@ -207,6 +249,14 @@ gmskframesync gmskframesync_create_set2(unsigned int       _k,
     q->payload_dec = (unsigned char*) malloc(q->payload_dec_len*sizeof(unsigned char));
     q->payload_enc = (unsigned char*) malloc(q->payload_enc_len*sizeof(unsigned char));
 
+    // accept all frames
+    q->header_filter_len = 0;
+    q->header_filter_num = 0;
+    q->header_checked    = 0;
+    q->num_rejected      = 0;
+    q->num_samples       = 0;
+    q->frame_start       = 0;
+
     // reset synchronizer
     gmskframesync_reset(q);
 
@@ -216,3 +266,298 @@ gmskframesync gmskframesync_create_set2(unsigned int       _k,
     // return synchronizer object
     return q;
 }
+
+// set the number of symbols of the preamble
+//  _q          :   frame synchronizer object
+//  _len        :   number of symbols in the preamble (15, 31, 63, 127 or 255)
+int gmskframesync_set_preamble_len(gmskframesync _q,
+                                   unsigned int  _len)
+{
+    if (_len == _q->preamble_len)
+        return LIQUID_OK;
+
+    int r = gmskframesync_create_detector(_q, _len);
+    if (r != LIQUID_OK)
+        return r;
+    return gmskframesync_reset(_q);
+}
+
+// set the list of accepted user headers
+//  _q          :   frame synchronizer object
+//  _headers    :   accepted headers, _num blocks of _len bytes (copied)
+//  _len        :   number of bytes compared at the start of the user header
+//  _num        :   number of accepted headers (0 to accept all frames)
+int gmskframesync_set_header_filter(gmskframesync         _q,
+                                    const unsigned char * _headers,
+                                    unsigned int          _len,
+                                    unsigned int          _num)
+{
+    if (_len > GMSKFRAME_H_USER_DEFAULT || _len > _q->header_user_len)
+        return liquid_error(LIQUID_EICONFIG,"gmskframesync_set_header_filter(), filter length exceeds user header length");
+    if (_num > GMSKFRAMESYNC_HEADER_FILTER_MAX)
+        return liquid_error(LIQUID_EICONFIG,"gmskframesync_set_header_filter(), too many headers (max %u)", GMSKFRAMESYNC_HEADER_FILTER_MAX);
+
+    if (_len == 0)
+        _num = 0;
+    memcpy(_q->header_filter, _headers, _len*_num);
+    _q->header_filter_len = _len;
+    _q->header_filter_num = _num;
+    return LIQUID_OK;
+}
+
+// check the user header of the frame being received against the filter
+static int gmskframesync_header_accepted(gmskframesync _q)
+{
+    unsigned int i;
+    for (i=0; i<_q->header_filter_num; i++) {
+        if (memcmp(_q->header_dec,
+                   &_q->header_filter[i*_q->header_filter_len],
+                   _q->header_filter_len) == 0)
+            return 1;
+    }
+    return 0;
+}
+
+// update instantaneous frequency estimate
+static void gmskframesync_update_fi(gmskframesync _q,
+                                    float complex _x)
+{
+    // compute differential phase
+    _q->fi_hat = cargf(conjf(_q->x_prime)*_x) * _q->k;
+
+    // update internal state
+    _q->x_prime = _x;
+}
+
+// update symbol synchronizer internal state (filtered error, index, etc.)
+//  _q      :   frame synchronizer
+//  _x      :   input sample
+//  _y      :   output symbol
+static int gmskframesync_update_symsync(gmskframesync _q,
+                                        float         _x,
+                                        float *       _y)
+{
+    // push sample into filterbanks
+    firpfb_rrrf_push(_q->mf,  _x);
+    firpfb_rrrf_push(_q->dmf, _x);
+
+    float mf_out  = 0.0f;   // matched-filter output
+    float dmf_out = 0.0f;   // derivatived matched-filter output
+    int sample_available = 0;
+
+    // check if output sample is available
+    if (_q->pfb_timer <= 0) {
+        sample_available = 1;
+
+        // reset timer
+        _q->pfb_timer = _q->k;  // k samples/symbol
+
+        firpfb_rrrf_execute(_q->mf,  _q->pfb_index, &mf_out);
+        firpfb_rrrf_execute(_q->dmf, _q->pfb_index, &dmf_out);
+
+        // update filtered timing error
+        _q->pfb_q = 0.99f*_q->pfb_q + 0.05f*mf_out*dmf_out;
+
+        // accumulate error into soft filterbank value
+        _q->pfb_soft += _q->pfb_q;
+
+        // compute actual filterbank index, constrained to [0, npfb-1]
+        _q->pfb_index = roundf(_q->pfb_soft);
+        while (_q->pfb_index < 0) {
+            _q->pfb_index += _q->npfb;
+            _q->pfb_soft  += _q->npfb;
+            _q->pfb_timer--;
+        }
+        while (_q->pfb_index > (int)_q->npfb - 1) {
+            _q->pfb_index -= _q->npfb;
+            _q->pfb_soft  -= _q->npfb;
+            _q->pfb_timer++;
+        }
+    }
+
+    // decrement symbol timer
+    _q->pfb_timer--;
+
+    // set output and return status flag
+    *_y = mf_out / (float)(_q->k);
+    return sample_available;
+}
+
+// receive the payload of the current frame; unlike the code of liquid-dsp,
+// the synchronizer goes back to the reception of a header instead of
+// looking for a new preamble when another frame follows in the same burst
+//  _q      :   frame synchronizer object
+//  _x      :   input sample array, [size: _n x 1]
+//  _n      :   number of input samples
+//  returns the number of samples consumed
+static unsigned int gmskframesync_execute_rxpayload(gmskframesync   _q,
+                                                    float complex * _x,
+                                                    unsigned int    _n)
+{
+    unsigned int i;
+    for (i=0; i<_n; i++) {
+        float complex xf;
+#if GMSKFRAMESYNC_PREFILTER
+        iirfilt_crcf_execute(_q->prefilter, _x[i], &xf);
+#else
+        xf = _x[i];
+#endif
+
+        // mix signal down
+        float complex y;
+        nco_crcf_mix_down(_q->nco_coarse, xf, &y);
+        nco_crcf_step(_q->nco_coarse);
+
+        // update instantaneous frequency estimate
+        gmskframesync_update_fi(_q, y);
+
+        // update symbol synchronizer
+        float mf_out = 0.0f;
+        if (!gmskframesync_update_symsync(_q, _q->fi_hat, &mf_out))
+            continue;
+
+        // accumulate the spread of the soft symbols around their mean
+        // magnitude, which is the error of the demodulation
+        _q->evm_sum  += fabsf(mf_out);
+        _q->evm_sum2 += mf_out*mf_out;
+
+        // demodulate and save payload
+        _q->payload_byte = (_q->payload_byte << 1) | (mf_out > 0.0f ? 0x01 : 0x00);
+        _q->payload_enc[_q->payload_counter/8] = _q->payload_byte;
+        _q->payload_counter++;
+        if (_q->payload_counter < 8*_q->payload_enc_len)
+            continue;
+
+        // payload received
+        _q->payload_valid = packetizer_decode(_q->p_payload,
+                                              _q->payload_enc,
+                                              _q->payload_dec);
+
+        // invoke callback
+        if (_q->callback != NULL) {
+            // estimate the EVM (dB) from the soft symbols of the payload
+            float mean = _q->evm_sum / _q->payload_counter;
+            float var  = _q->evm_sum2 / _q->payload_counter - mean*mean;
+            float evm  = mean > 0.0f ? 10*log10f(fmaxf(var/(mean*mean), 1e-12f)) : 0.0f;
+
+            // set framestats internals
+            _q->framesyncstats.evm           = evm;
+            _q->framesyncstats.rssi          = 20*log10f(_q->gamma_hat);
+            _q->framesyncstats.cfo           = nco_crcf_get_frequency(_q->nco_coarse);
+            _q->framesyncstats.framesyms     = NULL;
+            _q->framesyncstats.num_framesyms = 0;
+            _q->framesyncstats.mod_scheme    = LIQUID_MODEM_UNKNOWN;
+            _q->framesyncstats.mod_bps       = 1;
+            _q->framesyncstats.check         = _q->check;
+            _q->framesyncstats.fec0          = _q->fec0;
+            _q->framesyncstats.fec1          = _q->fec1;
+
+            _q->callback(_q->header_dec,
+                         _q->header_valid,
+                         _q->payload_dec,
+                         _q->payload_dec_len,
+                         _q->payload_valid,
+                         _q->framesyncstats,
+                         _q->userdata);
+        }
+
+        if (_q->header_dec[_q->header_user_len + GMSKFRAME_H_DEC - 1] & GMSKFRAME_H_MORE) {
+            // keep the timing and carrier of the burst for the next frame
+            _q->state           = STATE_RXHEADER;
+            _q->header_counter  = 0;
+            _q->payload_counter = 0;
+            _q->evm_sum         = 0.0f;
+            _q->evm_sum2        = 0.0f;
+            _q->frame_start     = _q->num_samples + i + 1;
+        } else {
+            gmskframesync_reset(_q);
+        }
+        return i + 1;
+    }
+    return _n;
+}
+
+// execute frame synchronizer, receiving all the frames of a burst, and
+// dropping the frames whose user header is not in the filter as soon as the
+// header has been decoded
+//  _q      :   frame synchronizer object
+//  _x      :   input sample array, [size: _n x 1]
+//  _n      :   number of input samples
+int gmskframesync_execute_filtered(gmskframesync   _q,
+                                   float complex * _x,
+                                   unsigned int    _n)
+{
+    // the payload of a rejected frame must never be demodulated, and the
+    // payload of an accepted frame is received by
+    // gmskframesync_execute_rxpayload(), so the synchronizer must stop as
+    // soon as a header has been decoded. While looking for a preamble, the
+    // samples are processed by blocks shorter than half of the header: the
+    // header can't be complete at the end of such a block. Once a preamble
+    // has been found, the synchronizer runs one symbol at a time.
+    unsigned int block_len = (_q->header_mod_len / 2) * _q->k;
+    if (block_len < _q->k)
+        block_len = _q->k;
+
+    unsigned int i;
+    unsigned int n;
+    for (i=0; i<_n; i+=n, _q->num_samples+=n) {
+        if (_q->state != STATE_RXPAYLOAD) {
+            int detecting = _q->state == STATE_DETECTFRAME;
+            _q->header_checked = 0;
+            n = detecting ? block_len : _q->k;
+            if (n > _n - i)
+                n = _n - i;
+            gmskframesync_execute(_q, &_x[i], n);
+            // the header has been decoded, the statistics of the payload
+            // start with its first symbol
+            if (_q->state == STATE_RXPAYLOAD) {
+                _q->evm_sum  = 0.0f;
+                _q->evm_sum2 = 0.0f;
+            }
+            // the preamble has been detected in this block, the symbols of
+            // the header received since then give its position
+            if (detecting && _q->state != STATE_DETECTFRAME) {
+                unsigned long long int len = _q->num_samples + n;
+                unsigned int header_syms = _q->state == STATE_RXHEADER ? _q->header_counter : 0;
+                unsigned long long int frame_len = (_q->preamble_len + header_syms) * _q->k;
+                _q->frame_start = len > frame_len ? len - frame_len : 0;
+            }
+            continue;
+        }
+
+        if (_q->header_filter_num > 0 && !_q->header_checked) {
+            _q->header_checked = 1;
+            if (!gmskframesync_header_accepted(_q)) {
+                // drop the frame, but let the callback know about it
+                _q->num_rejected++;
+                if (_q->callback != NULL)
+                    _q->callback(_q->header_dec, 1, NULL, 0, 0, _q->framesyncstats, _q->userdata);
+                gmskframesync_reset(_q);
+                _q->header_checked = 0;
+                n = 0;
+                continue;
+            }
+        }
+
+        n = gmskframesync_execute_rxpayload(_q, &_x[i], _n - i);
+    }
+    return LIQUID_OK;
+}
+
+// get the number of frames dropped by gmskframesync_execute_filtered()
+unsigned int gmskframesync_get_num_rejected(gmskframesync _q)
+{
+    return _q->num_rejected;
+}
+
+// get the number of samples processed by gmskframesync_execute_filtered()
+unsigned long long int gmskframesync_get_num_samples(gmskframesync _q)
+{
+    return _q->num_samples;
+}
+
+// get the index of the first sample of the current frame
+unsigned long long int gmskframesync_get_frame_start(gmskframesync _q)
+{
+    return _q->frame_start;
+}
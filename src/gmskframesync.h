@@ -37,4 +37,45 @@ gmskframesync gmskframesync_create_set2(unsigned int       _k,
                                         framesync_callback _callback,
                                         void *             _userdata);
 
+// set the number of symbols of the preamble, which must be the same as
+// the one of the burst generator (63 by default)
+//  _q          :   frame synchronizer object
+//  _len        :   number of symbols in the preamble (15, 31, 63, 127 or 255)
+int gmskframesync_set_preamble_len(gmskframesync _q,
+                                   unsigned int  _len);
+
+// set the list of accepted user headers
+//  _q          :   frame synchronizer object
+//  _headers    :   accepted headers, _num blocks of _len bytes (copied)
+//  _len        :   number of bytes compared at the start of the user header
+//  _num        :   number of accepted headers (at most 16, 0 to accept all
+//                  frames)
+int gmskframesync_set_header_filter(gmskframesync         _q,
+                                    const unsigned char * _headers,
+                                    unsigned int          _len,
+                                    unsigned int          _num);
+
+// execute frame synchronizer, receiving all the frames of a burst made by
+// gmskburstgen, and dropping the frames whose user header is not in the
+// filter as soon as the header has been decoded; the callback is invoked
+// for these frames with a NULL payload and _payload_valid set to 0
+//  _q      :   frame synchronizer object
+//  _x      :   input sample array, [size: _n x 1]
+//  _n      :   number of input samples
+int gmskframesync_execute_filtered(gmskframesync   _q,
+                                   float complex * _x,
+                                   unsigned int    _n);
+
+// get the number of frames dropped by gmskframesync_execute_filtered()
+unsigned int gmskframesync_get_num_rejected(gmskframesync _q);
+
+// get the number of samples processed by gmskframesync_execute_filtered()
+// since the creation of the synchronizer
+unsigned long long int gmskframesync_get_num_samples(gmskframesync _q);
+
+// get the index of the first sample of the current frame (or of the last
+// frame received), counted like gmskframesync_get_num_samples(); the start
+// of a frame following another one in a burst is the start of its header
+unsigned long long int gmskframesync_get_frame_start(gmskframesync _q);
+
 #endif
@@ -30,6 +30,9 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #define _(string) gettext(string)
 
+/* Number of seconds between two updates of the metrics file */
+#define METRICS_PERIOD 5
+
 void signal_handler(int signum)
 {
   if(gmsk_transfer_is_verbose())
@@ -50,6 +53,10 @@ void usage()
   printf(_("Usage: gmsk-transfer [options] [filename]\n"));
   printf("\n");
   printf(_("Options:\n"));
+  printf(_("  -A <frames>  (default: 1)\n"));
+  printf(_("    In 'transmit' mode, send up to 'frames' frames behind\n"
+           "    the same preamble when the data is available fast\n"
+           "    enough. Each frame keeps its own header and CRC.\n"));
   printf("  -a\n");
   printf(_("    Use audio samples instead of IQ samples.\n"));
   printf(_("  -b <bit rate>  (default: 9600 b/s)\n"));
@@ -61,6 +68,10 @@ void usage()
            "    the radio.\n"));
   printf(_("  -e <fec[,fec]>  (default: h128,none)\n"));
   printf(_("    Inner and outer forward error correction codes to use.\n"));
+  printf(_("  -F <format>  (default: cf32)\n"));
+  printf(_("    Format of the IQ samples sent to or received from the\n"
+           "    radio: 'cf32' (complex float), 'cs16' (complex 16-bit\n"
+           "    integers) or 'cs8' (complex 8-bit integers).\n"));
   printf(_("  -f <frequency>  (default: 434000000 Hz)\n"));
   printf(_("    Frequency of the GMSK transmission.\n"));
   printf(_("  -g <gain>  (default: 0)\n"));
@@ -70,11 +81,60 @@ void usage()
   printf(_("  -i <id>  (default: \"\")\n"));
   printf(_("    Transfer id (at most 4 bytes). When receiving, the frames\n"
            "    with a different id will be ignored.\n"));
+  printf(_("  -j <jobs>  (default: 1)\n"));
+  printf(_("    In 'receive' mode with a 'file' radio, decode the\n"
+           "    recording on 'jobs' threads. A value of 0 uses one\n"
+           "    thread per processor.\n"));
+  printf(_("  -k <time>  (default: 0 s)\n"));
+  printf(_("    In 'transmit' mode with a SoapySDR radio having a\n"
+           "    hardware clock, start sending the samples when the\n"
+           "    clock of the radio reaches 'time' seconds. If 'time'\n"
+           "    starts with '+', it is relative to the current time of\n"
+           "    the clock. A time of 0 sends the samples immediately.\n"));
+  printf(_("  -l <delay>  (default: 0 ms)\n"));
+  printf(_("    In 'transmit' mode, wait at most 'delay' ms for more\n"
+           "    data to fill a frame before sending the data already\n"
+           "    read. A delay of 0 sends the data as soon as it is read.\n"
+           "    With '-v', the percentiles of the time between the\n"
+           "    reading of the data and its transmission are printed.\n"));
+  printf(_("  -M <filename>\n"));
+  printf(_("    Write the statistics of the transfer (frames received,\n"
+           "    corrupted or ignored, bytes, radio overflows, underflows\n"
+           "    and timeouts, RSSI, EVM and CFO of the frames) to\n"
+           "    'filename' in the text format of Prometheus, and update\n"
+           "    it every %u seconds.\n"), METRICS_PERIOD);
+  printf(_("  -m <channels>  (default: 0)\n"));
+  printf(_("    In 'receive' mode, split the samples received from the\n"
+           "    radio into 'channels' channels spaced by\n"
+           "    (sample rate / channels) Hz around the frequency, and\n"
+           "    receive frames on all of them at the same time.\n"
+           "    The number of channels must be even.\n"));
   printf(_("  -n <bt>  (default: 0.5)\n"));
   printf(_("    Bandwidth-time parameter of the GMSK modulation.\n"));
   printf(_("  -o <offset>  (default: 0 Hz, can be negative)\n"));
   printf(_("    Set the central frequency of the transceiver 'offset' Hz\n"
            "    lower than the signal frequency to send or receive.\n"));
+  printf(_("  -P <preamble>[,<header>[,<ramp>]]  (default: 63,8)\n"));
+  printf(_("    Length of the preamble of the frames in symbols (15, 31,\n"
+           "    63, 127 or 255), of their header in bytes (from 4 to 8,\n"
+           "    the id using 'header' - 4 bytes), and of the ramps at\n"
+           "    the start and at the end of a transmission in symbols\n"
+           "    (by default, the delay of the modulation filter).\n"
+           "    The transmitter and the receiver must use the same\n"
+           "    preamble and header lengths.\n"));
+  printf(_("  -p <ring size>  (default: 0)\n"));
+  printf(_("    In 'receive' mode, run the radio capture, the signal\n"
+           "    processing, the frame synchronization and the output of\n"
+           "    the data on separate threads, connected by rings able to\n"
+           "    store 'ring size' blocks of 50 ms of samples.\n"
+           "    In 'transmit' mode, encode up to 'ring size' frames in\n"
+           "    advance on separate threads while the current frame is\n"
+           "    sent to the radio.\n"
+           "    A ring size of 0 disables the pipeline.\n"));
+  printf(_("  -q <level>  (default: 0 dB)\n"));
+  printf(_("    In 'receive' mode, only process the samples when the\n"
+           "    power of the signal is more than 'level' dB above the\n"
+           "    noise floor. A level of 0 disables the squelch.\n"));
   printf(_("  -r <radio>  (default: \"\")\n"));
   printf(_("    Radio to use.\n"));
   printf(_("  -s <sample rate>  (default: 2000000 S/s)\n"));
@@ -93,8 +153,14 @@ void usage()
   printf(_("    Print debug messages.\n"));
   printf(_("  -w <delay>  (default: 0.0 s)\n"));
   printf(_("    Wait a little before switching the radio off.\n"
-           "    This can be useful if the hardware needs some time to send\n"
-           "    the last samples it has buffered.\n"));
+           "    The transmission already ends when the radio reports\n"
+           "    that it has sent the last samples, or when they should\n"
+           "    have been sent according to the sample rate, so this is\n"
+           "    only useful if the hardware has a longer latency.\n"));
+  printf("  -x\n");
+  printf(_("    Measure the time spent in each stage of the processing\n"
+           "    (radio, data, FEC, modulation, resampling, etc.) and\n"
+           "    print a summary at the end with '-v'.\n"));
   printf("\n");
   printf(_("By default the program is in 'receive' mode.\n"
            "Use the '-t' option to use the 'transmit' mode.\n"));
@@ -111,8 +177,9 @@ void usage()
            "'transmit' mode.\n"
            "The 'file=path-to-file' radio type reads/writes the samples\n"
            "from/to 'path-to-file'.\n"
-           "The IQ samples must be in 'complex float' format\n"
-           "(32 bits for the real part, 32 bits for the imaginary part).\n"
+           "The IQ samples must be in the format selected with the '-F'\n"
+           "option, 'complex float' by default (32 bits for the real part,\n"
+           "32 bits for the imaginary part).\n"
            "The audio samples must be in 'signed integer' format (16 bits).\n"));
   printf("\n");
   printf(_("The gain parameter can be specified either as an integer to set a\n"
@@ -128,6 +195,24 @@ void usage()
   gmsk_transfer_print_available_forward_error_codes();
 }
 
+void get_framing(char *str,
+                 unsigned int *preamble_size,
+                 unsigned int *header_size,
+                 int *ramp_size)
+{
+  char *end;
+
+  *preamble_size = strtoul(str, &end, 10);
+  if(*end == ',')
+  {
+    *header_size = strtoul(end + 1, &end, 10);
+    if(*end == ',')
+    {
+      *ramp_size = strtol(end + 1, &end, 10);
+    }
+  }
+}
+
 void get_fec_schemes(char *str, char *inner_fec, char *outer_fec)
 {
   unsigned int size = strlen(str);
@@ -189,6 +274,20 @@ int main(int argc, char **argv)
   unsigned int final_delay_usec = 0;
   unsigned int timeout = 0;
   unsigned char audio = 0;
+  unsigned int ring_size = 0;
+  unsigned int channels = 0;
+  float squelch = 0;
+  unsigned int jobs = 1;
+  double start_time = 0;
+  unsigned char start_time_relative = 0;
+  char *sample_format = "cf32";
+  unsigned int coalescing_delay = 0;
+  unsigned int aggregation = 1;
+  unsigned int preamble_size = 63;
+  unsigned int header_size = 8;
+  int ramp_size = -1;
+  unsigned char profiling = 0;
+  char *metrics_file = NULL;
   int opt;
 
   strcpy(inner_fec, "h128");
@@ -199,10 +298,14 @@ int main(int argc, char **argv)
   bindtextdomain(PACKAGE, LOCALEDIR);
   textdomain(PACKAGE);
 
-  while((opt = getopt(argc, argv, "ab:c:d:e:f:g:hi:n:o:r:s:T:tu:vw:")) != -1)
+  while((opt = getopt(argc, argv, "A:ab:c:d:e:F:f:g:hi:j:k:l:M:m:n:o:P:p:q:r:s:T:tu:vw:x")) != -1)
   {
     switch(opt)
     {
+    case 'A':
+      aggregation = strtoul(optarg, NULL, 10);
+      break;
+
     case 'a':
       audio = 1;
       break;
@@ -223,6 +326,10 @@ int main(int argc, char **argv)
       get_fec_schemes(optarg, inner_fec, outer_fec);
       break;
 
+    case 'F':
+      sample_format = optarg;
+      break;
+
     case 'f':
       frequency = strtoul(optarg, NULL, 10);
       break;
@@ -239,6 +346,27 @@ int main(int argc, char **argv)
       id = optarg;
       break;
 
+    case 'j':
+      jobs = strtoul(optarg, NULL, 10);
+      break;
+
+    case 'k':
+      start_time_relative = (optarg[0] == '+');
+      start_time = strtod(&optarg[start_time_relative], NULL);
+      break;
+
+    case 'l':
+      coalescing_delay = strtoul(optarg, NULL, 10);
+      break;
+
+    case 'M':
+      metrics_file = optarg;
+      break;
+
+    case 'm':
+      channels = strtoul(optarg, NULL, 10);
+      break;
+
     case 'n':
       bt = strtof(optarg, NULL);
       break;
@@ -247,6 +375,18 @@ int main(int argc, char **argv)
       frequency_offset = strtol(optarg, NULL, 10);
       break;
 
+    case 'P':
+      get_framing(optarg, &preamble_size, &header_size, &ramp_size);
+      break;
+
+    case 'p':
+      ring_size = strtoul(optarg, NULL, 10);
+      break;
+
+    case 'q':
+      squelch = strtof(optarg, NULL);
+      break;
+
     case 'r':
       radio_driver = optarg;
       break;
@@ -275,6 +415,10 @@ int main(int argc, char **argv)
       final_delay = strtof(optarg, NULL);
       break;
 
+    case 'x':
+      profiling = 1;
+      break;
+
     default:
       fprintf(stderr, _("Error: Unknown parameter: '-%c %s'\n"), opt, optarg);
       return(EXIT_FAILURE);
@@ -315,6 +459,28 @@ int main(int argc, char **argv)
     fprintf(stderr, _("Error: Failed to initialize transfer\n"));
     return(EXIT_FAILURE);
   }
+  if((gmsk_transfer_set_pipeline(transfer, ring_size) < 0) ||
+     (gmsk_transfer_set_channels(transfer, channels, NULL) < 0) ||
+     (gmsk_transfer_set_squelch(transfer, squelch) < 0) ||
+     (gmsk_transfer_set_jobs(transfer, jobs) < 0) ||
+     (gmsk_transfer_set_sample_format(transfer, sample_format) < 0) ||
+     (gmsk_transfer_set_coalescing_delay(transfer, coalescing_delay) < 0) ||
+     (gmsk_transfer_set_aggregation(transfer, aggregation) < 0) ||
+     (gmsk_transfer_set_start_time(transfer,
+                                   start_time * 1000000000,
+                                   start_time_relative) < 0) ||
+     (gmsk_transfer_set_framing(transfer,
+                                preamble_size,
+                                header_size,
+                                ramp_size) < 0) ||
+     (gmsk_transfer_set_profiling(transfer, profiling) < 0) ||
+     (gmsk_transfer_set_metrics_file(transfer,
+                                     metrics_file,
+                                     METRICS_PERIOD) < 0))
+  {
+    gmsk_transfer_free(transfer);
+    return(EXIT_FAILURE);
+  }
   gmsk_transfer_start(transfer);
   if(final_delay > 0)
   {
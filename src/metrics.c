@@ -0,0 +1,232 @@
+/*
+This file is part of gmsk-transfer, a program to send or receive data
+by software defined radio using the GMSK modulation.
+
+Copyright 2022 Guillaume LE VAILLANT
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "metrics.h"
+
+struct metrics_s
+{
+  gmsk_transfer_t transfer;
+  char *filename;
+  char *temporary_filename;
+  unsigned int period;
+  pthread_t thread;
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+  unsigned char stop;
+};
+
+static void write_counter(FILE *file,
+                          const char *name,
+                          const char *help,
+                          unsigned long long int value)
+{
+  fprintf(file, "# HELP %s %s\n", name, help);
+  fprintf(file, "# TYPE %s counter\n", name);
+  fprintf(file, "%s %llu\n", name, value);
+}
+
+static void write_gauge(FILE *file,
+                        const char *name,
+                        const char *help,
+                        float value)
+{
+  fprintf(file, "# HELP %s %s\n", name, help);
+  fprintf(file, "# TYPE %s gauge\n", name);
+  fprintf(file, "%s %.3f\n", name, value);
+}
+
+static int write_metrics(metrics_t metrics)
+{
+  gmsk_transfer_stats_t stats;
+  FILE *file;
+  const char *frames = "gmsk_transfer_frames_received_total";
+
+  gmsk_transfer_get_stats(metrics->transfer, &stats);
+  file = fopen(metrics->temporary_filename, "w");
+  if(file == NULL)
+  {
+    return(-1);
+  }
+
+  fprintf(file, "# HELP %s Frames detected by the receiver, by result.\n",
+          frames);
+  fprintf(file, "# TYPE %s counter\n", frames);
+  fprintf(file, "%s{result=\"ok\"} %lu\n", frames, stats.frames_received);
+  fprintf(file, "%s{result=\"corrupted_header\"} %lu\n",
+          frames,
+          stats.frames_corrupted_header);
+  fprintf(file, "%s{result=\"corrupted_payload\"} %lu\n",
+          frames,
+          stats.frames_corrupted_payload);
+  fprintf(file, "%s{result=\"ignored\"} %lu\n", frames, stats.frames_ignored);
+  write_counter(file,
+                "gmsk_transfer_bytes_received_total",
+                "Bytes of data delivered by the receiver.",
+                stats.bytes_received);
+  write_counter(file,
+                "gmsk_transfer_frames_sent_total",
+                "Frames sent by the transmitter.",
+                stats.frames_sent);
+  write_counter(file,
+                "gmsk_transfer_bytes_sent_total",
+                "Bytes of data sent by the transmitter.",
+                stats.bytes_sent);
+  write_counter(file,
+                "gmsk_transfer_radio_overflows_total",
+                "Overflows reported by the radio.",
+                stats.overflows);
+  write_counter(file,
+                "gmsk_transfer_radio_underflows_total",
+                "Underflows reported by the radio.",
+                stats.underflows);
+  write_counter(file,
+                "gmsk_transfer_radio_timeouts_total",
+                "Reads or writes of samples that timed out.",
+                stats.timeouts);
+  write_gauge(file,
+              "gmsk_transfer_rssi_db",
+              "Received signal strength of the last frame.",
+              stats.rssi);
+  write_gauge(file,
+              "gmsk_transfer_rssi_average_db",
+              "Average received signal strength of the frames.",
+              stats.rssi_average);
+  write_gauge(file,
+              "gmsk_transfer_evm_db",
+              "Error vector magnitude of the last frame.",
+              stats.evm);
+  write_gauge(file,
+              "gmsk_transfer_evm_average_db",
+              "Average error vector magnitude of the frames.",
+              stats.evm_average);
+  write_gauge(file,
+              "gmsk_transfer_cfo_hertz",
+              "Carrier frequency offset of the last frame.",
+              stats.cfo);
+  write_gauge(file,
+              "gmsk_transfer_cfo_average_hertz",
+              "Average carrier frequency offset of the frames.",
+              stats.cfo_average);
+
+  if(fclose(file) != 0)
+  {
+    remove(metrics->temporary_filename);
+    return(-1);
+  }
+  if(rename(metrics->temporary_filename, metrics->filename) != 0)
+  {
+    remove(metrics->temporary_filename);
+    return(-1);
+  }
+  return(0);
+}
+
+static void * metrics_thread(void *arg)
+{
+  metrics_t metrics = (metrics_t) arg;
+  struct timespec deadline;
+
+  pthread_mutex_lock(&metrics->mutex);
+  clock_gettime(CLOCK_REALTIME, &deadline);
+  while(!metrics->stop)
+  {
+    deadline.tv_sec += metrics->period;
+    while((!metrics->stop) &&
+          (pthread_cond_timedwait(&metrics->cond,
+                                  &metrics->mutex,
+                                  &deadline) == 0));
+    if(!metrics->stop)
+    {
+      /* A failed write is tried again at the next period */
+      write_metrics(metrics);
+    }
+  }
+  pthread_mutex_unlock(&metrics->mutex);
+
+  return(NULL);
+}
+
+metrics_t metrics_create(gmsk_transfer_t transfer,
+                         const char *filename,
+                         unsigned int period)
+{
+  metrics_t metrics;
+
+  if(period == 0)
+  {
+    return(NULL);
+  }
+  metrics = malloc(sizeof(struct metrics_s));
+  if(metrics == NULL)
+  {
+    return(NULL);
+  }
+  metrics->transfer = transfer;
+  metrics->period = period;
+  metrics->stop = 0;
+  metrics->filename = strdup(filename);
+  metrics->temporary_filename = malloc(strlen(filename) + 5);
+  if((metrics->filename == NULL) || (metrics->temporary_filename == NULL))
+  {
+    free(metrics->temporary_filename);
+    free(metrics->filename);
+    free(metrics);
+    return(NULL);
+  }
+  sprintf(metrics->temporary_filename, "%s.tmp", filename);
+  pthread_mutex_init(&metrics->mutex, NULL);
+  pthread_cond_init(&metrics->cond, NULL);
+
+  if((write_metrics(metrics) < 0) ||
+     (pthread_create(&metrics->thread, NULL, metrics_thread, metrics) != 0))
+  {
+    pthread_cond_destroy(&metrics->cond);
+    pthread_mutex_destroy(&metrics->mutex);
+    free(metrics->temporary_filename);
+    free(metrics->filename);
+    free(metrics);
+    return(NULL);
+  }
+
+  return(metrics);
+}
+
+void metrics_free(metrics_t metrics)
+{
+  if(metrics)
+  {
+    pthread_mutex_lock(&metrics->mutex);
+    metrics->stop = 1;
+    pthread_cond_signal(&metrics->cond);
+    pthread_mutex_unlock(&metrics->mutex);
+    pthread_join(metrics->thread, NULL);
+    write_metrics(metrics);
+    pthread_cond_destroy(&metrics->cond);
+    pthread_mutex_destroy(&metrics->mutex);
+    free(metrics->temporary_filename);
+    free(metrics->filename);
+    free(metrics);
+  }
+}
@@ -0,0 +1,48 @@
+/*
+This file is part of gmsk-transfer, a program to send or receive data
+by software defined radio using the GMSK modulation.
+
+Copyright 2022 Guillaume LE VAILLANT
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include "gmsk-transfer.h"
+
+/* Periodic export of the statistics of a transfer to a file in the text
+ * format of Prometheus. The file is replaced atomically by renaming
+ * a temporary file, so that the readers never see a partial file. */
+typedef struct metrics_s *metrics_t;
+
+/* Start exporting the statistics of a transfer
+ *  - transfer: transfer whose statistics are read with
+ *    gmsk_transfer_get_stats()
+ *  - filename: file to write
+ *  - period: number of seconds between two updates of the file
+ *
+ * The file is written immediately, then by another thread.
+ * If the file can't be written or if the thread can't be started, the
+ * function returns NULL.
+ */
+metrics_t metrics_create(gmsk_transfer_t transfer,
+                         const char *filename,
+                         unsigned int period);
+
+/* Stop the export, after writing the file a last time */
+void metrics_free(metrics_t metrics);
+
+#endif
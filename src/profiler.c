@@ -0,0 +1,203 @@
+/*
+This file is part of gmsk-transfer, a program to send or receive data
+by software defined radio using the GMSK modulation.
+
+Copyright 2022 Guillaume LE VAILLANT
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <math.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <time.h>
+#include "profiler.h"
+
+/* The histograms have 4 bins per power of 2, up to 2^40 ns (about
+ * 18 minutes) */
+#define HISTOGRAM_SUBBINS 4
+#define HISTOGRAM_SIZE (HISTOGRAM_SUBBINS * 40)
+
+typedef struct
+{
+  atomic_ulong calls;
+  atomic_ullong total;
+  atomic_ulong histogram[HISTOGRAM_SIZE];
+} stage_t;
+
+struct profiler_s
+{
+  unsigned int stages_size;
+  stage_t *stages;
+  atomic_llong start_time;
+};
+
+profiler_t profiler_create(unsigned int stages)
+{
+  profiler_t profiler = malloc(sizeof(struct profiler_s));
+
+  if(profiler == NULL)
+  {
+    return(NULL);
+  }
+  profiler->stages = calloc(stages, sizeof(stage_t));
+  if(profiler->stages == NULL)
+  {
+    free(profiler);
+    return(NULL);
+  }
+  profiler->stages_size = stages;
+  profiler_reset(profiler);
+
+  return(profiler);
+}
+
+void profiler_free(profiler_t profiler)
+{
+  if(profiler)
+  {
+    free(profiler->stages);
+    free(profiler);
+  }
+}
+
+void profiler_reset(profiler_t profiler)
+{
+  unsigned int i;
+  unsigned int j;
+
+  for(i = 0; i < profiler->stages_size; i++)
+  {
+    atomic_store(&profiler->stages[i].calls, 0);
+    atomic_store(&profiler->stages[i].total, 0);
+    for(j = 0; j < HISTOGRAM_SIZE; j++)
+    {
+      atomic_store(&profiler->stages[i].histogram[j], 0);
+    }
+  }
+  atomic_store(&profiler->start_time, profiler_get_time());
+}
+
+long long int profiler_get_time()
+{
+  struct timespec t;
+
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return((t.tv_sec * 1000000000LL) + t.tv_nsec);
+}
+
+/* Index of the bin of the histogram containing a duration: the durations
+ * from 2^e to 2^(e+1) are split in HISTOGRAM_SUBBINS bins */
+static unsigned int get_bin(unsigned long long int duration)
+{
+  unsigned int e = 0;
+  unsigned int bin;
+
+  if(duration < HISTOGRAM_SUBBINS)
+  {
+    return(duration);
+  }
+  while((duration >> (e + 1)) != 0)
+  {
+    e++;
+  }
+  /* The 2 bits following the highest bit give the sub-bin */
+  bin = (HISTOGRAM_SUBBINS * (e - 1)) + ((duration >> (e - 2)) & 3);
+
+  return((bin < HISTOGRAM_SIZE) ? bin : HISTOGRAM_SIZE - 1);
+}
+
+/* Largest duration contained in a bin of the histogram */
+static unsigned long long int get_bin_limit(unsigned int bin)
+{
+  unsigned int e = (bin / HISTOGRAM_SUBBINS) + 1;
+  unsigned int subbin = bin % HISTOGRAM_SUBBINS;
+
+  if(bin < HISTOGRAM_SUBBINS)
+  {
+    return(bin);
+  }
+  return(((HISTOGRAM_SUBBINS + subbin + 1ULL) << (e - 2)) - 1);
+}
+
+void profiler_record(profiler_t profiler,
+                     unsigned int stage,
+                     long long int duration)
+{
+  stage_t *s = &profiler->stages[stage];
+
+  if(duration < 0)
+  {
+    duration = 0;
+  }
+  /* There is only one writer, the readers only need the values to be
+   * consistent individually */
+  atomic_fetch_add_explicit(&s->histogram[get_bin(duration)],
+                            1,
+                            memory_order_relaxed);
+  atomic_fetch_add_explicit(&s->total, duration, memory_order_relaxed);
+  atomic_fetch_add_explicit(&s->calls, 1, memory_order_relaxed);
+}
+
+static unsigned long long int get_percentile(stage_t *stage,
+                                             unsigned long int calls,
+                                             float percentile)
+{
+  unsigned long int target = ceilf(calls * percentile);
+  unsigned long int count = 0;
+  unsigned int i;
+
+  for(i = 0; i < HISTOGRAM_SIZE - 1; i++)
+  {
+    count += atomic_load_explicit(&stage->histogram[i], memory_order_relaxed);
+    if(count >= target)
+    {
+      break;
+    }
+  }
+  return(get_bin_limit(i));
+}
+
+void profiler_get_stage(profiler_t profiler,
+                        unsigned int stage,
+                        unsigned long int *calls,
+                        unsigned long long int *total,
+                        unsigned long long int *p50,
+                        unsigned long long int *p99)
+{
+  stage_t *s = &profiler->stages[stage];
+  unsigned long int n = atomic_load_explicit(&s->calls, memory_order_relaxed);
+
+  if(calls)
+  {
+    *calls = n;
+  }
+  if(total)
+  {
+    *total = atomic_load_explicit(&s->total, memory_order_relaxed);
+  }
+  if(p50)
+  {
+    *p50 = (n > 0) ? get_percentile(s, n, 0.5) : 0;
+  }
+  if(p99)
+  {
+    *p99 = (n > 0) ? get_percentile(s, n, 0.99) : 0;
+  }
+}
+
+long long int profiler_get_elapsed(profiler_t profiler)
+{
+  return(profiler_get_time() - atomic_load(&profiler->start_time));
+}
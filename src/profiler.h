@@ -0,0 +1,75 @@
+/*
+This file is part of gmsk-transfer, a program to send or receive data
+by software defined radio using the GMSK modulation.
+
+Copyright 2022 Guillaume LE VAILLANT
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+/* Measure of the time spent in the stages of a processing loop. For each
+ * stage, the number of measures, their total and their distribution are
+ * kept. The measures are recorded by a single thread, but they can be read
+ * by other threads at the same time. */
+typedef struct profiler_s *profiler_t;
+
+/* Create a new profiler
+ *  - stages: number of stages
+ *
+ * If the allocation fails, the function returns NULL.
+ */
+profiler_t profiler_create(unsigned int stages);
+
+/* Cleanup a profiler */
+void profiler_free(profiler_t profiler);
+
+/* Forget the previous measures and start a new measurement period */
+void profiler_reset(profiler_t profiler);
+
+/* Get the time of the monotonic clock in nanoseconds */
+long long int profiler_get_time();
+
+/* Record a measure
+ *  - stage: index of the stage
+ *  - duration: time spent in the stage in nanoseconds
+ */
+void profiler_record(profiler_t profiler,
+                     unsigned int stage,
+                     long long int duration);
+
+/* Get the measures of a stage
+ *  - stage: index of the stage
+ *  - calls: if not NULL, set to the number of measures
+ *  - total: if not NULL, set to the total time in nanoseconds
+ *  - p50: if not NULL, set to the median time in nanoseconds
+ *  - p99: if not NULL, set to the 99th percentile of the time in
+ *    nanoseconds
+ *
+ * The percentiles are rounded up with a precision of 25%.
+ */
+void profiler_get_stage(profiler_t profiler,
+                        unsigned int stage,
+                        unsigned long int *calls,
+                        unsigned long long int *total,
+                        unsigned long long int *p50,
+                        unsigned long long int *p99);
+
+/* Get the time elapsed since the start of the measurement period in
+ * nanoseconds */
+long long int profiler_get_elapsed(profiler_t profiler);
+
+#endif
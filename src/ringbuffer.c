@@ -0,0 +1,349 @@
+/*
+This file is part of gmsk-transfer, a program to send or receive data
+by software defined radio using the GMSK modulation.
+
+Copyright 2021-2022 Guillaume LE VAILLANT
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "ringbuffer.h"
+
+struct ringbuffer_s
+{
+  unsigned char *data;
+  unsigned int element_size;
+  unsigned int capacity;
+  /* Total number of elements written and read since the creation of the
+   * ring. The write index is only modified by the producer and the read
+   * index only by the consumer. */
+  atomic_ulong write_index;
+  atomic_ulong read_index;
+  atomic_uint high_water;
+  atomic_int closed;
+  /* Only used to sleep when there is nothing to do */
+  atomic_int waiting;
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+};
+
+ringbuffer_t ringbuffer_create(unsigned int element_size,
+                               unsigned int capacity)
+{
+  ringbuffer_t ring;
+
+  if((element_size == 0) || (capacity == 0))
+  {
+    return(NULL);
+  }
+
+  ring = malloc(sizeof(struct ringbuffer_s));
+  if(ring == NULL)
+  {
+    return(NULL);
+  }
+  ring->data = malloc((size_t) element_size * capacity);
+  if(ring->data == NULL)
+  {
+    free(ring);
+    return(NULL);
+  }
+  ring->element_size = element_size;
+  ring->capacity = capacity;
+  atomic_init(&ring->write_index, 0);
+  atomic_init(&ring->read_index, 0);
+  atomic_init(&ring->high_water, 0);
+  atomic_init(&ring->closed, 0);
+  atomic_init(&ring->waiting, 0);
+  pthread_mutex_init(&ring->mutex, NULL);
+  pthread_cond_init(&ring->cond, NULL);
+
+  return(ring);
+}
+
+void ringbuffer_free(ringbuffer_t ring)
+{
+  if(ring)
+  {
+    pthread_cond_destroy(&ring->cond);
+    pthread_mutex_destroy(&ring->mutex);
+    free(ring->data);
+    free(ring);
+  }
+}
+
+void ringbuffer_reset(ringbuffer_t ring)
+{
+  atomic_store(&ring->write_index, 0);
+  atomic_store(&ring->read_index, 0);
+  atomic_store(&ring->high_water, 0);
+  atomic_store(&ring->closed, 0);
+}
+
+unsigned int ringbuffer_get_capacity(ringbuffer_t ring)
+{
+  return(ring->capacity);
+}
+
+unsigned int ringbuffer_get_readable(ringbuffer_t ring)
+{
+  unsigned long int w = atomic_load_explicit(&ring->write_index,
+                                             memory_order_acquire);
+  unsigned long int r = atomic_load_explicit(&ring->read_index,
+                                             memory_order_acquire);
+
+  return(w - r);
+}
+
+unsigned int ringbuffer_get_writable(ringbuffer_t ring)
+{
+  return(ring->capacity - ringbuffer_get_readable(ring));
+}
+
+unsigned int ringbuffer_get_high_water(ringbuffer_t ring)
+{
+  return(atomic_load(&ring->high_water));
+}
+
+static void ringbuffer_wake_up(ringbuffer_t ring)
+{
+  /* Pairs with the fence in the wait functions: either the waiting thread
+   * sees the new index, or we see that it is waiting */
+  atomic_thread_fence(memory_order_seq_cst);
+  if(atomic_load(&ring->waiting) > 0)
+  {
+    pthread_mutex_lock(&ring->mutex);
+    pthread_cond_broadcast(&ring->cond);
+    pthread_mutex_unlock(&ring->mutex);
+  }
+}
+
+static void copy_elements(ringbuffer_t ring,
+                          unsigned long int index,
+                          unsigned char *elements,
+                          unsigned int size,
+                          int to_ring)
+{
+  unsigned int position = index % ring->capacity;
+  unsigned int n = ring->capacity - position;
+  size_t s = ring->element_size;
+
+  if(n > size)
+  {
+    n = size;
+  }
+  if(to_ring)
+  {
+    memcpy(&ring->data[position * s], elements, n * s);
+    memcpy(ring->data, &elements[n * s], (size - n) * s);
+  }
+  else
+  {
+    memcpy(elements, &ring->data[position * s], n * s);
+    memcpy(&elements[n * s], ring->data, (size - n) * s);
+  }
+}
+
+unsigned int ringbuffer_write(ringbuffer_t ring,
+                              const void *elements,
+                              unsigned int size)
+{
+  unsigned long int w = atomic_load_explicit(&ring->write_index,
+                                             memory_order_relaxed);
+  unsigned long int r = atomic_load_explicit(&ring->read_index,
+                                             memory_order_acquire);
+  unsigned int free_size = ring->capacity - (w - r);
+
+  if(size > free_size)
+  {
+    size = free_size;
+  }
+  if(size == 0)
+  {
+    return(0);
+  }
+
+  copy_elements(ring, w, (unsigned char *) elements, size, 1);
+  atomic_store_explicit(&ring->write_index, w + size, memory_order_release);
+  if(w + size - r > atomic_load_explicit(&ring->high_water,
+                                         memory_order_relaxed))
+  {
+    atomic_store_explicit(&ring->high_water,
+                          w + size - r,
+                          memory_order_relaxed);
+  }
+  ringbuffer_wake_up(ring);
+
+  return(size);
+}
+
+unsigned int ringbuffer_read(ringbuffer_t ring,
+                             void *elements,
+                             unsigned int size)
+{
+  unsigned long int r = atomic_load_explicit(&ring->read_index,
+                                             memory_order_relaxed);
+  unsigned long int w = atomic_load_explicit(&ring->write_index,
+                                             memory_order_acquire);
+
+  if(size > w - r)
+  {
+    size = w - r;
+  }
+  if(size == 0)
+  {
+    return(0);
+  }
+
+  copy_elements(ring, r, (unsigned char *) elements, size, 0);
+  atomic_store_explicit(&ring->read_index, r + size, memory_order_release);
+  ringbuffer_wake_up(ring);
+
+  return(size);
+}
+
+static void get_deadline(struct timespec *deadline, unsigned int timeout)
+{
+  clock_gettime(CLOCK_REALTIME, deadline);
+  deadline->tv_sec += timeout / 1000;
+  deadline->tv_nsec += (timeout % 1000) * 1000000;
+  if(deadline->tv_nsec >= 1000000000)
+  {
+    deadline->tv_sec++;
+    deadline->tv_nsec -= 1000000000;
+  }
+}
+
+unsigned int ringbuffer_wait_readable(ringbuffer_t ring,
+                                      unsigned int size,
+                                      unsigned int timeout)
+{
+  struct timespec deadline;
+  unsigned int n = ringbuffer_get_readable(ring);
+  int r = 0;
+
+  if(size > ring->capacity)
+  {
+    size = ring->capacity;
+  }
+  if((n >= size) || atomic_load(&ring->closed))
+  {
+    return(n);
+  }
+
+  get_deadline(&deadline, timeout);
+  pthread_mutex_lock(&ring->mutex);
+  atomic_fetch_add(&ring->waiting, 1);
+  atomic_thread_fence(memory_order_seq_cst);
+  while(((n = ringbuffer_get_readable(ring)) < size) &&
+        (!atomic_load(&ring->closed)) &&
+        (r == 0))
+  {
+    r = pthread_cond_timedwait(&ring->cond, &ring->mutex, &deadline);
+  }
+  atomic_fetch_sub(&ring->waiting, 1);
+  pthread_mutex_unlock(&ring->mutex);
+
+  return(n);
+}
+
+unsigned int ringbuffer_wait_writable(ringbuffer_t ring,
+                                      unsigned int size,
+                                      unsigned int timeout)
+{
+  struct timespec deadline;
+  unsigned int n = ringbuffer_get_writable(ring);
+  int r = 0;
+
+  if(size > ring->capacity)
+  {
+    size = ring->capacity;
+  }
+  if((n >= size) || atomic_load(&ring->closed))
+  {
+    return(n);
+  }
+
+  get_deadline(&deadline, timeout);
+  pthread_mutex_lock(&ring->mutex);
+  atomic_fetch_add(&ring->waiting, 1);
+  atomic_thread_fence(memory_order_seq_cst);
+  while(((n = ringbuffer_get_writable(ring)) < size) &&
+        (!atomic_load(&ring->closed)) &&
+        (r == 0))
+  {
+    r = pthread_cond_timedwait(&ring->cond, &ring->mutex, &deadline);
+  }
+  atomic_fetch_sub(&ring->waiting, 1);
+  pthread_mutex_unlock(&ring->mutex);
+
+  return(n);
+}
+
+unsigned int ringbuffer_write_all(ringbuffer_t ring,
+                                  const void *elements,
+                                  unsigned int size)
+{
+  const unsigned char *e = elements;
+  unsigned int total = 0;
+  unsigned int n;
+
+  /* If the consumer has closed the ring, nobody will make some space */
+  while((total < size) && (!atomic_load(&ring->closed)))
+  {
+    ringbuffer_wait_writable(ring, 1, 100);
+    n = ringbuffer_write(ring, e, size - total);
+    e += n * ring->element_size;
+    total += n;
+  }
+
+  return(total);
+}
+
+unsigned int ringbuffer_read_all(ringbuffer_t ring,
+                                 void *elements,
+                                 unsigned int size)
+{
+  unsigned char *e = elements;
+  unsigned int total = 0;
+  unsigned int n;
+
+  while((total < size) && (!ringbuffer_is_finished(ring)))
+  {
+    ringbuffer_wait_readable(ring, size - total, 100);
+    n = ringbuffer_read(ring, e, size - total);
+    e += n * ring->element_size;
+    total += n;
+  }
+
+  return(total);
+}
+
+void ringbuffer_close(ringbuffer_t ring)
+{
+  atomic_store(&ring->closed, 1);
+  pthread_mutex_lock(&ring->mutex);
+  pthread_cond_broadcast(&ring->cond);
+  pthread_mutex_unlock(&ring->mutex);
+}
+
+int ringbuffer_is_finished(ringbuffer_t ring)
+{
+  return(atomic_load(&ring->closed) && (ringbuffer_get_readable(ring) == 0));
+}
@@ -0,0 +1,107 @@
+/*
+This file is part of gmsk-transfer, a program to send or receive data
+by software defined radio using the GMSK modulation.
+
+Copyright 2021-2022 Guillaume LE VAILLANT
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef RINGBUFFER_H
+#define RINGBUFFER_H
+
+/* Lock-free ring buffer for one producer thread and one consumer thread.
+ * The storage is allocated once when the ring is created. Reading and
+ * writing never take a lock; a mutex is only used to put a thread to sleep
+ * when the ring is empty (consumer) or full (producer). */
+typedef struct ringbuffer_s *ringbuffer_t;
+
+/* Create a new ring buffer
+ *  - element_size: size of an element in bytes
+ *  - capacity: maximum number of elements stored in the ring
+ *
+ * If the allocation fails, the function returns NULL.
+ */
+ringbuffer_t ringbuffer_create(unsigned int element_size,
+                               unsigned int capacity);
+
+/* Cleanup a ring buffer */
+void ringbuffer_free(ringbuffer_t ring);
+
+/* Empty a ring buffer and reopen it if it was closed
+ * Neither the producer nor the consumer must be using the ring when this
+ * function is called. */
+void ringbuffer_reset(ringbuffer_t ring);
+
+/* Get the maximum number of elements stored in the ring */
+unsigned int ringbuffer_get_capacity(ringbuffer_t ring);
+
+/* Get the number of elements that can be read */
+unsigned int ringbuffer_get_readable(ringbuffer_t ring);
+
+/* Get the number of elements that can be written */
+unsigned int ringbuffer_get_writable(ringbuffer_t ring);
+
+/* Get the highest number of elements that have been stored in the ring
+ * at the same time */
+unsigned int ringbuffer_get_high_water(ringbuffer_t ring);
+
+/* Write at most 'size' elements without blocking
+ * Return the number of elements written. */
+unsigned int ringbuffer_write(ringbuffer_t ring,
+                              const void *elements,
+                              unsigned int size);
+
+/* Read at most 'size' elements without blocking
+ * Return the number of elements read. */
+unsigned int ringbuffer_read(ringbuffer_t ring,
+                             void *elements,
+                             unsigned int size);
+
+/* Write 'size' elements, waiting for some free space when the ring is full
+ * Return the number of elements written, which is less than 'size' only if the
+ * ring has been closed. */
+unsigned int ringbuffer_write_all(ringbuffer_t ring,
+                                  const void *elements,
+                                  unsigned int size);
+
+/* Read 'size' elements, waiting for them when the ring is empty
+ * Return the number of elements read, which is less than 'size' only if the
+ * ring has been closed. */
+unsigned int ringbuffer_read_all(ringbuffer_t ring,
+                                 void *elements,
+                                 unsigned int size);
+
+/* Wait until at least 'size' elements can be read, the ring is closed or
+ * 'timeout' milliseconds have elapsed
+ * Return the number of elements that can be read. */
+unsigned int ringbuffer_wait_readable(ringbuffer_t ring,
+                                      unsigned int size,
+                                      unsigned int timeout);
+
+/* Wait until at least 'size' elements can be written, the ring is closed or
+ * 'timeout' milliseconds have elapsed
+ * Return the number of elements that can be written. */
+unsigned int ringbuffer_wait_writable(ringbuffer_t ring,
+                                      unsigned int size,
+                                      unsigned int timeout);
+
+/* Signal the consumer that the producer will not write anymore, or the
+ * producer that the consumer will not read anymore */
+void ringbuffer_close(ringbuffer_t ring);
+
+/* Return 1 if the ring has been closed and is empty, 0 otherwise */
+int ringbuffer_is_finished(ringbuffer_t ring);
+
+#endif
@@ -0,0 +1,439 @@
+/*
+This file is part of gmsk-transfer, a program to send or receive data
+by software defined radio using the GMSK modulation.
+
+Copyright 2022 Guillaume LE VAILLANT
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <liquid/liquid.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include "simulator.h"
+
+#define TAU (2 * M_PI)
+
+/* Total power of the echoes relative to the direct path, and power of the
+ * last echo relative to the first one (in dB) */
+#define MULTIPATH_ECHOES_POWER -6
+#define MULTIPATH_DECAY -20
+
+/* Number of sinusoids summed to make the fading, and number of samples
+ * after which their amplitudes are corrected for rounding errors */
+#define FADING_PATHS 16
+#define FADING_NORMALIZATION 4096
+
+struct simulator_s
+{
+  int paced;
+  float noise_amplitude;
+  firfilt_cccf multipath;
+  /* Flat Rayleigh fading made by the sum of sinusoids arriving from random
+   * directions (Jakes model) */
+  int fading;
+  complex float fading_phasors[FADING_PATHS];
+  complex float fading_steps[FADING_PATHS];
+  unsigned int fading_counter;
+  nco_crcf oscillator;
+  resamp_crcf resampler;
+  float resampling_rate;
+  unsigned long long int random_state;
+  complex float *buffer;
+  complex float *output;
+  unsigned int buffer_size;
+};
+
+/* Uniform random number in ]0, 1] from a xorshift64* generator */
+static float random_uniform(simulator_t simulator)
+{
+  unsigned long long int x = simulator->random_state;
+
+  x ^= x >> 12;
+  x ^= x << 25;
+  x ^= x >> 27;
+  simulator->random_state = x;
+
+  return((((x * 2685821657736338717ULL) >> 40) + 1) / 16777216.0f);
+}
+
+/* Complex Gaussian random number of power 1 */
+static complex float random_gaussian(simulator_t simulator)
+{
+  float r = sqrtf(-logf(random_uniform(simulator)));
+  float theta = TAU * random_uniform(simulator);
+
+  return(r * cexpf(I * theta));
+}
+
+static int parse_number(const char *value, float *number)
+{
+  char *end;
+
+  *number = strtof(value, &end);
+  return((*value != '\0') && (*end == '\0') && isfinite(*number));
+}
+
+static void free_objects(simulator_t simulator)
+{
+  if(simulator->multipath)
+  {
+    firfilt_cccf_destroy(simulator->multipath);
+  }
+  if(simulator->oscillator)
+  {
+    nco_crcf_destroy(simulator->oscillator);
+  }
+  if(simulator->resampler)
+  {
+    resamp_crcf_destroy(simulator->resampler);
+  }
+  free(simulator->buffer);
+  free(simulator->output);
+  free(simulator);
+}
+
+static firfilt_cccf create_multipath(simulator_t simulator,
+                                     unsigned int taps)
+{
+  complex float *h = malloc(taps * sizeof(complex float));
+  float echoes_power = 0;
+  float power;
+  float scale;
+  unsigned int i;
+  firfilt_cccf multipath;
+
+  if(h == NULL)
+  {
+    return(NULL);
+  }
+
+  /* Exponential power delay profile for the echoes, scaled to get their
+   * total power */
+  h[0] = 1;
+  for(i = 1; i < taps; i++)
+  {
+    power = powf(10, (MULTIPATH_DECAY * (i - 1.0f)) / ((taps - 1) * 10.0f));
+    h[i] = sqrtf(power) * random_gaussian(simulator);
+    echoes_power += crealf(h[i] * conjf(h[i]));
+  }
+  scale = sqrtf(powf(10, MULTIPATH_ECHOES_POWER / 10.0f) / echoes_power);
+  for(i = 1; i < taps; i++)
+  {
+    h[i] *= scale;
+  }
+  /* Keep the power of the signal */
+  scale = 1 / sqrtf(1 + powf(10, MULTIPATH_ECHOES_POWER / 10.0f));
+  for(i = 0; i < taps; i++)
+  {
+    h[i] *= scale;
+  }
+
+  multipath = firfilt_cccf_create(h, taps);
+  free(h);
+
+  return(multipath);
+}
+
+static void create_fading(simulator_t simulator,
+                          float doppler,
+                          unsigned long int sample_rate)
+{
+  float alpha;
+  unsigned int i;
+
+  simulator->fading = 1;
+  simulator->fading_counter = 0;
+  for(i = 0; i < FADING_PATHS; i++)
+  {
+    alpha = (TAU * (i + random_uniform(simulator))) / FADING_PATHS;
+    simulator->fading_phasors[i] = cexpf(I * TAU * random_uniform(simulator)) /
+      sqrtf(FADING_PATHS);
+    simulator->fading_steps[i] = cexpf((I * TAU * doppler * cosf(alpha)) /
+                                       sample_rate);
+  }
+}
+
+simulator_t simulator_create(const char *parameters,
+                             unsigned long int sample_rate)
+{
+  simulator_t simulator;
+  char *copy;
+  char *parameter;
+  char *value;
+  char *end;
+  char *state;
+  float snr = INFINITY;
+  float cfo = 0;
+  float drift = 0;
+  float spread = 0;
+  float doppler = 0;
+  unsigned long long int seed = 1;
+  int paced = 0;
+  int ok = 1;
+
+  if(sample_rate == 0)
+  {
+    return(NULL);
+  }
+  copy = strdup(parameters);
+  if(copy == NULL)
+  {
+    return(NULL);
+  }
+  for(parameter = strtok_r(copy, ",", &state);
+      ok && (parameter != NULL);
+      parameter = strtok_r(NULL, ",", &state))
+  {
+    value = strchr(parameter, '=');
+    if(value != NULL)
+    {
+      *value = '\0';
+      value++;
+    }
+    if(strcasecmp(parameter, "paced") == 0)
+    {
+      paced = 1;
+      ok = (value == NULL);
+    }
+    else if(value == NULL)
+    {
+      ok = 0;
+    }
+    else if(strcasecmp(parameter, "snr") == 0)
+    {
+      ok = parse_number(value, &snr);
+    }
+    else if(strcasecmp(parameter, "cfo") == 0)
+    {
+      ok = parse_number(value, &cfo);
+    }
+    else if(strcasecmp(parameter, "drift") == 0)
+    {
+      ok = parse_number(value, &drift) && (fabsf(drift) < 100000);
+    }
+    else if(strcasecmp(parameter, "multipath") == 0)
+    {
+      ok = parse_number(value, &spread) && (spread >= 0);
+    }
+    else if(strcasecmp(parameter, "fading") == 0)
+    {
+      ok = parse_number(value, &doppler) && (doppler >= 0);
+    }
+    else if(strcasecmp(parameter, "seed") == 0)
+    {
+      seed = strtoull(value, &end, 10);
+      ok = (*value != '\0') && (*end == '\0');
+    }
+    else
+    {
+      ok = 0;
+    }
+  }
+  free(copy);
+  if(!ok)
+  {
+    return(NULL);
+  }
+
+  simulator = malloc(sizeof(struct simulator_s));
+  if(simulator == NULL)
+  {
+    return(NULL);
+  }
+  bzero(simulator, sizeof(struct simulator_s));
+  simulator->paced = paced;
+  simulator->random_state = seed ^ 0x9e3779b97f4a7c15ULL;
+  if(simulator->random_state == 0)
+  {
+    simulator->random_state = 1;
+  }
+
+  if(isfinite(snr))
+  {
+    simulator->noise_amplitude = sqrtf(powf(10, -snr / 10));
+  }
+  if(roundf((spread * sample_rate) / 1000000) >= 1)
+  {
+    simulator->multipath = create_multipath(simulator,
+                                            roundf((spread * sample_rate) /
+                                                   1000000) + 1);
+    if(simulator->multipath == NULL)
+    {
+      free_objects(simulator);
+      return(NULL);
+    }
+  }
+  if(doppler > 0)
+  {
+    create_fading(simulator, doppler, sample_rate);
+  }
+  if(cfo != 0)
+  {
+    simulator->oscillator = nco_crcf_create(LIQUID_NCO);
+    if(simulator->oscillator == NULL)
+    {
+      free_objects(simulator);
+      return(NULL);
+    }
+    nco_crcf_set_frequency(simulator->oscillator, (TAU * cfo) / sample_rate);
+  }
+  simulator->resampling_rate = 1 + (drift / 1000000);
+  if(drift != 0)
+  {
+    simulator->resampler = resamp_crcf_create_default(simulator->resampling_rate);
+    if(simulator->resampler == NULL)
+    {
+      free_objects(simulator);
+      return(NULL);
+    }
+  }
+
+  return(simulator);
+}
+
+void simulator_free(simulator_t simulator)
+{
+  if(simulator)
+  {
+    free_objects(simulator);
+  }
+}
+
+int simulator_is_paced(simulator_t simulator)
+{
+  return(simulator->paced);
+}
+
+static int grow_buffers(simulator_t simulator, unsigned int samples_size)
+{
+  complex float *buffer;
+  complex float *output;
+  /* Room for the samples added by the resampler */
+  unsigned int output_size = ceilf(1.1 * samples_size *
+                                   simulator->resampling_rate) + 4;
+
+  if(samples_size <= simulator->buffer_size)
+  {
+    return(1);
+  }
+  buffer = realloc(simulator->buffer, samples_size * sizeof(complex float));
+  if(buffer == NULL)
+  {
+    return(0);
+  }
+  simulator->buffer = buffer;
+  output = realloc(simulator->output, output_size * sizeof(complex float));
+  if(output == NULL)
+  {
+    return(0);
+  }
+  simulator->output = output;
+  simulator->buffer_size = samples_size;
+
+  return(1);
+}
+
+static void apply_fading(simulator_t simulator,
+                         complex float *samples,
+                         unsigned int samples_size)
+{
+  complex float gain;
+  unsigned int i;
+  unsigned int j;
+
+  for(i = 0; i < samples_size; i++)
+  {
+    gain = 0;
+    for(j = 0; j < FADING_PATHS; j++)
+    {
+      gain += simulator->fading_phasors[j];
+      simulator->fading_phasors[j] *= simulator->fading_steps[j];
+    }
+    samples[i] *= gain;
+
+    simulator->fading_counter++;
+    if(simulator->fading_counter == FADING_NORMALIZATION)
+    {
+      simulator->fading_counter = 0;
+      for(j = 0; j < FADING_PATHS; j++)
+      {
+        simulator->fading_phasors[j] /= cabsf(simulator->fading_phasors[j]) *
+          sqrtf(FADING_PATHS);
+      }
+    }
+  }
+}
+
+complex float * simulator_execute(simulator_t simulator,
+                                  complex float *samples,
+                                  unsigned int samples_size,
+                                  unsigned int *output_size)
+{
+  complex float *output;
+  unsigned int i;
+
+  if(!grow_buffers(simulator, samples_size))
+  {
+    return(NULL);
+  }
+
+  if(simulator->multipath)
+  {
+    firfilt_cccf_execute_block(simulator->multipath,
+                               samples,
+                               samples_size,
+                               simulator->buffer);
+  }
+  else
+  {
+    memcpy(simulator->buffer, samples, samples_size * sizeof(complex float));
+  }
+  if(simulator->fading)
+  {
+    apply_fading(simulator, simulator->buffer, samples_size);
+  }
+  if(simulator->oscillator)
+  {
+    nco_crcf_mix_block_up(simulator->oscillator,
+                          simulator->buffer,
+                          simulator->buffer,
+                          samples_size);
+  }
+  if(simulator->resampler)
+  {
+    resamp_crcf_execute_block(simulator->resampler,
+                              simulator->buffer,
+                              samples_size,
+                              simulator->output,
+                              output_size);
+    output = simulator->output;
+  }
+  else
+  {
+    *output_size = samples_size;
+    output = simulator->buffer;
+  }
+  if(simulator->noise_amplitude > 0)
+  {
+    for(i = 0; i < *output_size; i++)
+    {
+      output[i] += simulator->noise_amplitude * random_gaussian(simulator);
+    }
+  }
+
+  return(output);
+}
@@ -0,0 +1,75 @@
+/*
+This file is part of gmsk-transfer, a program to send or receive data
+by software defined radio using the GMSK modulation.
+
+Copyright 2022 Guillaume LE VAILLANT
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SIMULATOR_H
+#define SIMULATOR_H
+
+#include <complex.h>
+
+/* Simulation of the impairments of a radio channel, applied to the samples
+ * going from a transmitter to a receiver: multipath propagation, flat
+ * Rayleigh fading, carrier frequency offset, drift of the sample clock and
+ * additive white Gaussian noise (in this order). The random numbers come
+ * from a seeded generator, so a simulation can be repeated exactly. */
+typedef struct simulator_s *simulator_t;
+
+/* Create a new channel simulator
+ *  - parameters: comma separated list of impairments, each one being
+ *    'name=value'; an empty string gives a perfect channel
+ *      snr=<dB>: signal to noise ratio, for a signal of power 1
+ *      cfo=<Hz>: carrier frequency offset
+ *      drift=<ppm>: how much faster the sample clock of the receiver is
+ *        than the one of the transmitter (can be negative)
+ *      multipath=<us>: delay spread of the echoes following the direct
+ *        path; their power decreases exponentially with their delay
+ *      fading=<Hz>: maximum Doppler frequency of the fading
+ *      seed=<n>: seed of the random number generator
+ *      paced: deliver the samples at the sample rate instead of as fast as
+ *        possible
+ *  - sample_rate: samples per second
+ *
+ * If the parameters are invalid or if the allocation fails, the function
+ * returns NULL.
+ */
+simulator_t simulator_create(const char *parameters,
+                             unsigned long int sample_rate);
+
+/* Cleanup a channel simulator */
+void simulator_free(simulator_t simulator);
+
+/* Return 1 if the samples must be delivered at the sample rate, 0 if they
+ * can be delivered as fast as possible */
+int simulator_is_paced(simulator_t simulator);
+
+/* Process a block of samples
+ *  - samples: input samples
+ *  - samples_size: number of input samples
+ *  - output_size: set to the number of output samples, which can differ
+ *    from the number of input samples when the sample clock drifts
+ *
+ * Return a pointer to the output samples, which are valid until the next
+ * call, or NULL if the allocation of the output buffer failed.
+ */
+complex float * simulator_execute(simulator_t simulator,
+                                  complex float *samples,
+                                  unsigned int samples_size,
+                                  unsigned int *output_size);
+
+#endif
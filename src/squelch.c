@@ -0,0 +1,330 @@
+/*
+This file is part of gmsk-transfer, a program to send or receive data
+by software defined radio using the GMSK modulation.
+
+Copyright 2021-2022 Guillaume LE VAILLANT
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "squelch.h"
+
+struct squelch_s
+{
+  unsigned int sum_length;
+  unsigned int window_length;
+  float threshold;
+  float noise_floor;
+  int open;
+  unsigned int hang;
+  unsigned int hang_counter;
+  /* Measurement of the power of the current window, which can span several
+   * blocks of samples */
+  complex float sum;
+  unsigned int sum_count;
+  float power;
+  unsigned int window_count;
+  /* Circular buffer with the last samples received while the gate was
+   * closed */
+  complex float *history;
+  unsigned int history_size;
+  unsigned int history_start;
+  unsigned int history_count;
+  unsigned long int samples_count;
+  unsigned long int gated_samples_count;
+};
+
+squelch_t squelch_create(unsigned int sum_length,
+                         unsigned int window_length,
+                         unsigned int history_size,
+                         float threshold)
+{
+  squelch_t squelch;
+
+  if((sum_length == 0) || (window_length < sum_length) || (history_size == 0))
+  {
+    return(NULL);
+  }
+
+  squelch = malloc(sizeof(struct squelch_s));
+  if(squelch == NULL)
+  {
+    return(NULL);
+  }
+  squelch->history = malloc(history_size * sizeof(complex float));
+  if(squelch->history == NULL)
+  {
+    free(squelch);
+    return(NULL);
+  }
+  squelch->sum_length = sum_length;
+  /* Use only complete sums in a window */
+  squelch->window_length = window_length - (window_length % sum_length);
+  squelch->history_size = history_size;
+  squelch->threshold = powf(10, threshold / 10);
+  squelch->hang = history_size;
+  squelch->samples_count = 0;
+  squelch->gated_samples_count = 0;
+  squelch_reset(squelch);
+
+  return(squelch);
+}
+
+void squelch_free(squelch_t squelch)
+{
+  if(squelch)
+  {
+    free(squelch->history);
+    free(squelch);
+  }
+}
+
+void squelch_reset(squelch_t squelch)
+{
+  /* Start with the gate open until the noise floor is known, in case the
+   * reception begins in the middle of a frame */
+  squelch->noise_floor = -1;
+  squelch->open = 1;
+  squelch->hang_counter = squelch->hang;
+  squelch->sum = 0;
+  squelch->sum_count = 0;
+  squelch->power = 0;
+  squelch->window_count = 0;
+  squelch->history_start = 0;
+  squelch->history_count = 0;
+}
+
+unsigned int squelch_get_history_size(squelch_t squelch)
+{
+  return(squelch->history_size);
+}
+
+int squelch_is_open(squelch_t squelch)
+{
+  return(squelch->open);
+}
+
+void squelch_get_counters(squelch_t squelch,
+                          unsigned long int *samples,
+                          unsigned long int *gated_samples)
+{
+  if(samples)
+  {
+    *samples = squelch->samples_count;
+  }
+  if(gated_samples)
+  {
+    *gated_samples = squelch->gated_samples_count;
+  }
+}
+
+/* Add samples to the power measurement of the current window. Summing
+ * 'sum_length' consecutive samples is a cheap low-pass filter removing
+ * most of the noise outside of the band of the signal. */
+static void squelch_measure(squelch_t squelch,
+                            complex float *samples,
+                            unsigned int samples_size)
+{
+  unsigned int i;
+  complex float sum = squelch->sum;
+  unsigned int sum_count = squelch->sum_count;
+
+  for(i = 0; i < samples_size; i++)
+  {
+    sum += samples[i];
+    sum_count++;
+    if(sum_count == squelch->sum_length)
+    {
+      squelch->power += (crealf(sum) * crealf(sum)) +
+        (cimagf(sum) * cimagf(sum));
+      sum = 0;
+      sum_count = 0;
+    }
+  }
+  squelch->sum = sum;
+  squelch->sum_count = sum_count;
+  squelch->window_count += samples_size;
+}
+
+/* Update the state of the gate at the end of a window */
+static void squelch_decide(squelch_t squelch, int busy)
+{
+  float power = squelch->power;
+
+  squelch->power = 0;
+  squelch->window_count = 0;
+
+  if(squelch->noise_floor < 0)
+  {
+    squelch->noise_floor = power;
+  }
+
+  if(power > squelch->noise_floor * squelch->threshold)
+  {
+    squelch->open = 1;
+    squelch->hang_counter = squelch->hang;
+  }
+  else if(squelch->open)
+  {
+    /* The noise floor follows the power immediately when it goes down at
+     * the end of a transmission */
+    if(power < squelch->noise_floor)
+    {
+      squelch->noise_floor = power;
+    }
+    if(squelch->hang_counter > squelch->window_length)
+    {
+      squelch->hang_counter -= squelch->window_length;
+    }
+    else if(!busy)
+    {
+      squelch->hang_counter = 0;
+      squelch->open = 0;
+    }
+  }
+  else
+  {
+    /* Average of the power of the noise */
+    squelch->noise_floor += (power - squelch->noise_floor) / 8;
+  }
+}
+
+static void squelch_push_history(squelch_t squelch,
+                                 complex float *samples,
+                                 unsigned int samples_size)
+{
+  unsigned int position;
+  unsigned int n;
+
+  if(samples_size >= squelch->history_size)
+  {
+    memcpy(squelch->history,
+           &samples[samples_size - squelch->history_size],
+           squelch->history_size * sizeof(complex float));
+    squelch->history_start = 0;
+    squelch->history_count = squelch->history_size;
+    return;
+  }
+
+  while(samples_size > 0)
+  {
+    position = (squelch->history_start + squelch->history_count) %
+      squelch->history_size;
+    n = squelch->history_size - position;
+    if(n > samples_size)
+    {
+      n = samples_size;
+    }
+    memcpy(&squelch->history[position], samples, n * sizeof(complex float));
+    squelch->history_count += n;
+    if(squelch->history_count > squelch->history_size)
+    {
+      squelch->history_start = (squelch->history_start +
+                                squelch->history_count -
+                                squelch->history_size) % squelch->history_size;
+      squelch->history_count = squelch->history_size;
+    }
+    samples += n;
+    samples_size -= n;
+  }
+}
+
+static unsigned int squelch_pop_history(squelch_t squelch,
+                                        complex float *output)
+{
+  unsigned int count = squelch->history_count;
+  unsigned int n = squelch->history_size - squelch->history_start;
+
+  if(n > count)
+  {
+    n = count;
+  }
+  memcpy(output,
+         &squelch->history[squelch->history_start],
+         n * sizeof(complex float));
+  memcpy(&output[n], squelch->history, (count - n) * sizeof(complex float));
+  squelch->history_start = 0;
+  squelch->history_count = 0;
+
+  return(count);
+}
+
+unsigned int squelch_execute(squelch_t squelch,
+                             complex float *samples,
+                             unsigned int samples_size,
+                             complex float *output,
+                             int busy,
+                             int *opened)
+{
+  unsigned int i;
+  unsigned int n;
+  unsigned int output_size = 0;
+  int was_open;
+  int closed = 0;
+
+  *opened = 0;
+  for(i = 0; i < samples_size; i += n)
+  {
+    /* Process the samples up to the end of the current window */
+    n = squelch->window_length - squelch->window_count;
+    if(n > samples_size - i)
+    {
+      n = samples_size - i;
+    }
+    squelch_measure(squelch, &samples[i], n);
+
+    if(squelch->open)
+    {
+      memcpy(&output[output_size], &samples[i], n * sizeof(complex float));
+      output_size += n;
+    }
+    else
+    {
+      squelch_push_history(squelch, &samples[i], n);
+      squelch->gated_samples_count += n;
+    }
+    squelch->samples_count += n;
+
+    if(squelch->window_count == squelch->window_length)
+    {
+      was_open = squelch->open;
+      squelch_decide(squelch, busy);
+      if(was_open && !squelch->open)
+      {
+        closed = 1;
+      }
+      else if(squelch->open && !was_open)
+      {
+        /* The history ends with the window that opened the gate. If the
+         * gate closed earlier in this block, the samples let through before
+         * it closed must not be followed by the history, as the caller
+         * restarts its processing at the beginning of the output */
+        *opened = 1;
+        if(closed)
+        {
+          squelch->gated_samples_count += output_size;
+          output_size = 0;
+          closed = 0;
+        }
+        squelch->gated_samples_count -= squelch->history_count;
+        output_size += squelch_pop_history(squelch, &output[output_size]);
+      }
+    }
+  }
+
+  return(output_size);
+}
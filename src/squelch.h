@@ -0,0 +1,89 @@
+/*
+This file is part of gmsk-transfer, a program to send or receive data
+by software defined radio using the GMSK modulation.
+
+Copyright 2021-2022 Guillaume LE VAILLANT
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SQUELCH_H
+#define SQUELCH_H
+
+#include <complex.h>
+
+/* Energy detector letting samples through only when the power in the band
+ * of the signal is above the noise floor. While the gate is closed, the
+ * last samples are kept in a history buffer, and they are let through first
+ * when the gate opens, so that the beginning of a frame is not lost. */
+typedef struct squelch_s *squelch_t;
+
+/* Create a new squelch
+ *  - sum_length: number of samples summed together before measuring the
+ *    power; it acts as a low-pass filter and should be about the duration
+ *    of a symbol
+ *  - window_length: number of samples used for a power measurement
+ *  - history_size: number of samples to let through before the ones that
+ *    opened the gate; the gate also stays open for that many samples after
+ *    the power goes down
+ *  - threshold: level above the noise floor opening the gate (in dB)
+ *
+ * If the allocation fails, the function returns NULL.
+ */
+squelch_t squelch_create(unsigned int sum_length,
+                         unsigned int window_length,
+                         unsigned int history_size,
+                         float threshold);
+
+/* Cleanup a squelch */
+void squelch_free(squelch_t squelch);
+
+/* Forget the noise floor and the history, and open the gate */
+void squelch_reset(squelch_t squelch);
+
+/* Get the maximum number of samples written by squelch_execute in addition
+ * to the number of input samples */
+unsigned int squelch_get_history_size(squelch_t squelch);
+
+/* Process a block of samples
+ *  - samples: input samples
+ *  - samples_size: number of input samples
+ *  - output: samples to process further; the buffer must have room for
+ *    samples_size + squelch_get_history_size() samples
+ *  - busy: if not 0, the gate is not allowed to close (e.g. because the
+ *    frame synchronizer is in the middle of a frame)
+ *  - opened: set to 1 if the gate was closed and has been opened, in which
+ *    case the output begins with the samples from the history buffer (the
+ *    samples let through before the gate closed in the same block are
+ *    dropped)
+ *
+ * Return the number of samples written to 'output'.
+ */
+unsigned int squelch_execute(squelch_t squelch,
+                             complex float *samples,
+                             unsigned int samples_size,
+                             complex float *output,
+                             int busy,
+                             int *opened);
+
+/* Return 1 if the gate is open, 0 otherwise */
+int squelch_is_open(squelch_t squelch);
+
+/* Get the number of samples processed and the number of samples that were
+ * not let through since the creation of the squelch */
+void squelch_get_counters(squelch_t squelch,
+                          unsigned long int *samples,
+                          unsigned long int *gated_samples);
+
+#endif
@@ -0,0 +1,177 @@
+/*
+This file is part of gmsk-transfer, a program to send or receive data
+by software defined radio using the GMSK modulation.
+
+Copyright 2021-2022 Guillaume LE VAILLANT
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Compare the conversion of audio samples one at a time, as it was done
+ * before, with the conversion by blocks used now by write_audio() and
+ * read_audio(). The results are printed like the ones of bench-dsp, the
+ * real-time factor being given for 48000 audio samples per second. */
+
+#include <complex.h>
+#include <liquid/liquid.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "convert.h"
+
+#define BLOCK_SIZE 1024
+/* About 100 s of audio at 48000 S/s (50 s of IQ samples) */
+#define SAMPLES_COUNT (2344 * BLOCK_SIZE)
+#define AUDIO_SAMPLE_RATE 48000
+
+double get_time()
+{
+  struct timespec t;
+
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return(t.tv_sec + (t.tv_nsec / 1000000000.0));
+}
+
+void print_result(char *name, double start, double end)
+{
+  double rate = (2 * SAMPLES_COUNT) / (end - start);
+
+  printf("%s,%.0f,%.2f\n", name, rate, rate / AUDIO_SAMPLE_RATE);
+}
+
+void write_by_sample(complex float *samples, FILE *output)
+{
+  firhilbf converter = firhilbf_create(25, 60);
+  float audio_samples[2];
+  short int audio_samples_s16[2];
+  unsigned int n;
+
+  for(n = 0; n < SAMPLES_COUNT; n++)
+  {
+    firhilbf_interp_execute(converter, samples[n], audio_samples);
+    audio_samples_s16[0] = audio_samples[0] * 32767;
+    audio_samples_s16[1] = audio_samples[1] * 32767;
+    fwrite(audio_samples_s16, sizeof(short int), 2, output);
+  }
+  firhilbf_destroy(converter);
+}
+
+void write_by_block(complex float *samples, FILE *output)
+{
+  firhilbf converter = firhilbf_create(25, 60);
+  float audio_samples[2 * BLOCK_SIZE];
+  short int audio_samples_s16[2 * BLOCK_SIZE];
+  unsigned int n;
+
+  for(n = 0; n < SAMPLES_COUNT; n += BLOCK_SIZE)
+  {
+    firhilbf_interp_execute_block(converter,
+                                  &samples[n],
+                                  BLOCK_SIZE,
+                                  audio_samples);
+    convert_float_to_s16(audio_samples, audio_samples_s16, 2 * BLOCK_SIZE, 1);
+    fwrite(audio_samples_s16, sizeof(short int), 2 * BLOCK_SIZE, output);
+  }
+  firhilbf_destroy(converter);
+}
+
+void read_by_sample(complex float *samples, FILE *input)
+{
+  firhilbf converter = firhilbf_create(25, 60);
+  float audio_samples[2];
+  short int audio_samples_s16[2];
+  unsigned int n = 0;
+
+  while((n < SAMPLES_COUNT) &&
+        (fread(audio_samples_s16, sizeof(short int), 2, input) == 2))
+  {
+    audio_samples[0] = audio_samples_s16[0] / 32768.0;
+    audio_samples[1] = audio_samples_s16[1] / 32768.0;
+    firhilbf_decim_execute(converter, audio_samples, &samples[n]);
+    n++;
+  }
+  firhilbf_destroy(converter);
+}
+
+void read_by_block(complex float *samples, FILE *input)
+{
+  firhilbf converter = firhilbf_create(25, 60);
+  float audio_samples[2 * BLOCK_SIZE];
+  short int audio_samples_s16[2 * BLOCK_SIZE];
+  unsigned int n = 0;
+
+  while((n < SAMPLES_COUNT) &&
+        (fread(audio_samples_s16,
+               2 * sizeof(short int),
+               BLOCK_SIZE,
+               input) == BLOCK_SIZE))
+  {
+    convert_s16_to_float(audio_samples_s16, audio_samples, 2 * BLOCK_SIZE, 1);
+    firhilbf_decim_execute_block(converter,
+                                 audio_samples,
+                                 BLOCK_SIZE,
+                                 &samples[n]);
+    n += BLOCK_SIZE;
+  }
+  firhilbf_destroy(converter);
+}
+
+int main()
+{
+  complex float *samples = malloc(SAMPLES_COUNT * sizeof(complex float));
+  FILE *file = tmpfile();
+  double start;
+  double end;
+  unsigned int n;
+
+  if((samples == NULL) || (file == NULL))
+  {
+    fprintf(stderr, "Error: Failed to initialize benchmark\n");
+    return(EXIT_FAILURE);
+  }
+  for(n = 0; n < SAMPLES_COUNT; n++)
+  {
+    samples[n] = 0.5 * cexpf(I * 0.1 * n);
+  }
+
+  start = get_time();
+  write_by_sample(samples, file);
+  fflush(file);
+  end = get_time();
+  print_result("audio_output_by_sample", start, end);
+
+  rewind(file);
+  start = get_time();
+  write_by_block(samples, file);
+  fflush(file);
+  end = get_time();
+  print_result("audio_output_by_block", start, end);
+
+  rewind(file);
+  start = get_time();
+  read_by_sample(samples, file);
+  end = get_time();
+  print_result("audio_input_by_sample", start, end);
+
+  rewind(file);
+  start = get_time();
+  read_by_block(samples, file);
+  end = get_time();
+  print_result("audio_input_by_block", start, end);
+
+  fclose(file);
+  free(samples);
+  return(EXIT_SUCCESS);
+}
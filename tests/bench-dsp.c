@@ -0,0 +1,478 @@
+/*
+This file is part of gmsk-transfer, a program to send or receive data
+by software defined radio using the GMSK modulation.
+
+Copyright 2022 Guillaume LE VAILLANT
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Measure the speed of the stages of the modulation and of the
+ * demodulation. For each stage, a line with the name of the stage, the
+ * number of samples processed per second and the real-time factor (how
+ * many times faster than needed at the sample rate of the stage) is
+ * printed, separated by commas. The frame synchronizer and the frame
+ * generator work at the symbol rate, their real-time factor is given for
+ * a bit rate of 9600 b/s.
+ * The FEC codes used for the frame assembly can be given as arguments
+ * (by default, all the codes that are always available). */
+
+#include <complex.h>
+#include <liquid/liquid.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include "gmskburstgen.h"
+#include "gmskframesync.h"
+
+#define TAU (2 * M_PI)
+#define BLOCK_SIZE 4096
+/* Duration of the measurement of a stage in seconds */
+#define DURATION 0.5
+#define BT 0.5
+#define REFERENCE_BIT_RATE 9600
+#define PAYLOAD_SIZE 1000
+#define HEADER_SIZE 8
+#define SIGNAL_FRAMES 4
+
+typedef struct
+{
+  unsigned long int sample_rate;
+  unsigned int bit_rate;
+} configuration_t;
+
+/* Default configuration, narrow band, and highest bit rate tested by
+ * test-program.sh */
+configuration_t configurations[] = {
+  { 2000000, 9600 },
+  { 250000, 1200 },
+  { 20000000, 8000000 }
+};
+
+char *default_fecs[] = {
+  "none",
+  "rep3",
+  "rep5",
+  "h74",
+  "h84",
+  "h128",
+  "g2412",
+  "secded2216",
+  "secded3932",
+  "secded7264"
+};
+
+/* Process a block and return the number of samples processed */
+typedef unsigned int (*stage_t)(void *context);
+
+typedef struct
+{
+  msresamp_crcf resampler;
+  nco_crcf oscillator;
+  complex float *input;
+  complex float *output;
+} samples_context_t;
+
+typedef struct
+{
+  gmskframesync frame_synchronizer;
+  complex float *samples;
+  unsigned int samples_size;
+  unsigned int position;
+  unsigned int frames;
+} sync_context_t;
+
+typedef struct
+{
+  gmskburstgen frame_generator;
+  fec_scheme fec;
+  unsigned char header[HEADER_SIZE];
+  unsigned char payload[PAYLOAD_SIZE];
+  complex float samples[BLOCK_SIZE];
+} assemble_context_t;
+
+double get_time()
+{
+  struct timespec t;
+
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return(t.tv_sec + (t.tv_nsec / 1000000000.0));
+}
+
+void run_benchmark(char *name,
+                   stage_t stage,
+                   void *context,
+                   double sample_rate)
+{
+  double start = get_time();
+  double elapsed;
+  unsigned long int samples = 0;
+
+  do
+  {
+    samples += stage(context);
+    elapsed = get_time() - start;
+  }
+  while(elapsed < DURATION);
+
+  printf("%s,%.0f,%.2f\n",
+         name,
+         samples / elapsed,
+         samples / (elapsed * sample_rate));
+  fflush(stdout);
+}
+
+complex float * allocate_samples(unsigned int samples_size)
+{
+  complex float *samples = malloc(samples_size * sizeof(complex float));
+
+  if(samples == NULL)
+  {
+    fprintf(stderr, "Error: Memory allocation failed\n");
+    exit(EXIT_FAILURE);
+  }
+  return(samples);
+}
+
+void make_noise(complex float *samples, unsigned int samples_size)
+{
+  unsigned int i;
+
+  for(i = 0; i < samples_size; i++)
+  {
+    samples[i] = 0.1 * (randnf() + (I * randnf()));
+  }
+}
+
+unsigned int resample(void *context)
+{
+  samples_context_t *c = (samples_context_t *) context;
+  unsigned int n;
+
+  msresamp_crcf_execute(c->resampler, c->input, BLOCK_SIZE, c->output, &n);
+  return(BLOCK_SIZE);
+}
+
+unsigned int mix_up(void *context)
+{
+  samples_context_t *c = (samples_context_t *) context;
+
+  nco_crcf_mix_block_up(c->oscillator, c->input, c->output, BLOCK_SIZE);
+  return(BLOCK_SIZE);
+}
+
+unsigned int mix_down(void *context)
+{
+  samples_context_t *c = (samples_context_t *) context;
+
+  nco_crcf_mix_block_down(c->oscillator, c->input, c->output, BLOCK_SIZE);
+  return(BLOCK_SIZE);
+}
+
+unsigned int synchronize(void *context)
+{
+  sync_context_t *c = (sync_context_t *) context;
+
+  if(c->position + BLOCK_SIZE > c->samples_size)
+  {
+    c->position = 0;
+  }
+  gmskframesync_execute_filtered(c->frame_synchronizer,
+                                 &c->samples[c->position],
+                                 BLOCK_SIZE);
+  c->position += BLOCK_SIZE;
+  return(BLOCK_SIZE);
+}
+
+unsigned int assemble(void *context)
+{
+  assemble_context_t *c = (assemble_context_t *) context;
+  unsigned int samples = 0;
+  unsigned int n;
+  int complete = 0;
+
+  gmskburstgen_assemble(c->frame_generator,
+                        c->header,
+                        c->payload,
+                        PAYLOAD_SIZE,
+                        LIQUID_CRC_32,
+                        c->fec,
+                        LIQUID_FEC_NONE,
+                        0);
+  while(!complete)
+  {
+    complete = gmskburstgen_write(c->frame_generator, c->samples, BLOCK_SIZE);
+    n = BLOCK_SIZE;
+    if(complete)
+    {
+      /* Don't count the padding */
+      while((n > 0) && (c->samples[n - 1] == 0))
+      {
+        n--;
+      }
+    }
+    samples += n;
+  }
+  return(samples);
+}
+
+int frame_received(unsigned char *header,
+                   int header_valid,
+                   unsigned char *payload,
+                   unsigned int payload_size,
+                   int payload_valid,
+                   framesyncstats_s stats,
+                   void *user_data)
+{
+  sync_context_t *c = (sync_context_t *) user_data;
+
+  /* Only the number of valid frames is counted */
+  (void) header;
+  (void) header_valid;
+  (void) payload;
+  (void) payload_size;
+  (void) stats;
+
+  if(payload_valid)
+  {
+    c->frames++;
+  }
+  return(0);
+}
+
+void bench_resampler(configuration_t *configuration,
+                     unsigned int samples_per_symbol)
+{
+  float symbol_rate = configuration->bit_rate * samples_per_symbol;
+  float ratios[2];
+  float rates[2];
+  char *directions[2] = { "tx", "rx" };
+  char name[128];
+  samples_context_t c;
+  unsigned int i;
+
+  /* Transmission: from the frame generator to the radio, reception: from
+   * the radio to the frame synchronizer */
+  ratios[0] = configuration->sample_rate / symbol_rate;
+  rates[0] = symbol_rate;
+  ratios[1] = symbol_rate / configuration->sample_rate;
+  rates[1] = configuration->sample_rate;
+
+  for(i = 0; i < 2; i++)
+  {
+    c.resampler = msresamp_crcf_create(ratios[i], 60);
+    c.input = allocate_samples(BLOCK_SIZE);
+    c.output = allocate_samples(ceilf(BLOCK_SIZE * ratios[i] * 1.1) + 64);
+    make_noise(c.input, BLOCK_SIZE);
+    snprintf(name,
+             sizeof(name),
+             "resampler_%s_%lu_%u",
+             directions[i],
+             configuration->sample_rate,
+             configuration->bit_rate);
+    run_benchmark(name, resample, &c, rates[i]);
+    msresamp_crcf_destroy(c.resampler);
+    free(c.input);
+    free(c.output);
+  }
+}
+
+void bench_oscillator(configuration_t *configuration)
+{
+  char name[128];
+  samples_context_t c;
+
+  c.oscillator = nco_crcf_create(LIQUID_VCO);
+  nco_crcf_set_frequency(c.oscillator, TAU * 0.05);
+  c.input = allocate_samples(BLOCK_SIZE);
+  c.output = allocate_samples(BLOCK_SIZE);
+  make_noise(c.input, BLOCK_SIZE);
+
+  snprintf(name, sizeof(name), "nco_mix_up_%lu", configuration->sample_rate);
+  run_benchmark(name, mix_up, &c, configuration->sample_rate);
+  snprintf(name, sizeof(name), "nco_mix_down_%lu", configuration->sample_rate);
+  run_benchmark(name, mix_down, &c, configuration->sample_rate);
+
+  nco_crcf_destroy(c.oscillator);
+  free(c.input);
+  free(c.output);
+}
+
+/* Make a few frames separated by noise */
+unsigned int make_signal(complex float **samples,
+                         unsigned int samples_per_symbol)
+{
+  gmskburstgen frame_generator = gmskburstgen_create(samples_per_symbol,
+                                                     samples_per_symbol + 1,
+                                                     BT);
+  unsigned char header[HEADER_SIZE];
+  unsigned char payload[PAYLOAD_SIZE];
+  unsigned int samples_size = 0;
+  unsigned int capacity = 16 * BLOCK_SIZE;
+  unsigned int i;
+  int complete;
+
+  *samples = allocate_samples(capacity);
+  memset(header, 0, HEADER_SIZE);
+  for(i = 0; i < PAYLOAD_SIZE; i++)
+  {
+    payload[i] = rand() & 255;
+  }
+  gmskburstgen_set_header_len(frame_generator, HEADER_SIZE);
+
+  for(i = 0; i < SIGNAL_FRAMES; i++)
+  {
+    gmskburstgen_assemble(frame_generator,
+                          header,
+                          payload,
+                          PAYLOAD_SIZE,
+                          LIQUID_CRC_32,
+                          LIQUID_FEC_HAMMING128,
+                          LIQUID_FEC_NONE,
+                          0);
+    complete = 0;
+    while(!complete)
+    {
+      if(samples_size + (2 * BLOCK_SIZE) > capacity)
+      {
+        capacity *= 2;
+        *samples = realloc(*samples, capacity * sizeof(complex float));
+        if(*samples == NULL)
+        {
+          fprintf(stderr, "Error: Memory allocation failed\n");
+          exit(EXIT_FAILURE);
+        }
+      }
+      complete = gmskburstgen_write(frame_generator,
+                                    &(*samples)[samples_size],
+                                    BLOCK_SIZE);
+      samples_size += BLOCK_SIZE;
+    }
+    /* Some noise between the frames */
+    make_noise(&(*samples)[samples_size], BLOCK_SIZE);
+    samples_size += BLOCK_SIZE;
+  }
+  for(i = 0; i < samples_size; i++)
+  {
+    (*samples)[i] += 0.01 * (randnf() + (I * randnf()));
+  }
+  gmskburstgen_destroy(frame_generator);
+
+  return(samples_size);
+}
+
+void bench_synchronizer(unsigned int samples_per_symbol)
+{
+  sync_context_t c;
+  unsigned int i;
+
+  for(i = 0; i < 2; i++)
+  {
+    bzero(&c, sizeof(c));
+    c.frame_synchronizer = gmskframesync_create_set2(samples_per_symbol,
+                                                     samples_per_symbol + 1,
+                                                     BT,
+                                                     TAU * 0.01,
+                                                     frame_received,
+                                                     &c);
+    gmskframesync_set_header_len(c.frame_synchronizer, HEADER_SIZE);
+    if(i == 0)
+    {
+      c.samples_size = 16 * BLOCK_SIZE;
+      c.samples = allocate_samples(c.samples_size);
+      make_noise(c.samples, c.samples_size);
+    }
+    else
+    {
+      c.samples_size = make_signal(&c.samples, samples_per_symbol);
+    }
+    run_benchmark((i == 0) ? "framesync_noise" : "framesync_signal",
+                  synchronize,
+                  &c,
+                  REFERENCE_BIT_RATE * samples_per_symbol);
+    if((i == 1) && (c.frames == 0))
+    {
+      fprintf(stderr, "Error: No frame received by the synchronizer\n");
+      exit(EXIT_FAILURE);
+    }
+    gmskframesync_destroy(c.frame_synchronizer);
+    free(c.samples);
+  }
+}
+
+void bench_assembly(char *fec_name, unsigned int samples_per_symbol)
+{
+  assemble_context_t *c = malloc(sizeof(assemble_context_t));
+  char name[128];
+  unsigned int i;
+
+  if(c == NULL)
+  {
+    fprintf(stderr, "Error: Memory allocation failed\n");
+    exit(EXIT_FAILURE);
+  }
+  c->fec = liquid_getopt_str2fec(fec_name);
+  if(c->fec == LIQUID_FEC_UNKNOWN)
+  {
+    fprintf(stderr, "Error: Unknown FEC code '%s'\n", fec_name);
+    exit(EXIT_FAILURE);
+  }
+  c->frame_generator = gmskburstgen_create(samples_per_symbol,
+                                           samples_per_symbol + 1,
+                                           BT);
+  gmskburstgen_set_header_len(c->frame_generator, HEADER_SIZE);
+  memset(c->header, 0, HEADER_SIZE);
+  for(i = 0; i < PAYLOAD_SIZE; i++)
+  {
+    c->payload[i] = rand() & 255;
+  }
+
+  snprintf(name, sizeof(name), "assemble_%s", fec_name);
+  run_benchmark(name, assemble, c, REFERENCE_BIT_RATE * samples_per_symbol);
+
+  gmskburstgen_destroy(c->frame_generator);
+  free(c);
+}
+
+int main(int argc, char **argv)
+{
+  unsigned int samples_per_symbol = ceilf(1 / BT);
+  int i;
+
+  for(i = 0; i < (int) (sizeof(configurations) / sizeof(configuration_t)); i++)
+  {
+    bench_resampler(&configurations[i], samples_per_symbol);
+    bench_oscillator(&configurations[i]);
+  }
+  bench_synchronizer(samples_per_symbol);
+  if(argc > 1)
+  {
+    for(i = 1; i < argc; i++)
+    {
+      bench_assembly(argv[i], samples_per_symbol);
+    }
+  }
+  else
+  {
+    for(i = 0; i < (int) (sizeof(default_fecs) / sizeof(char *)); i++)
+    {
+      bench_assembly(default_fecs[i], samples_per_symbol);
+    }
+  }
+
+  return(EXIT_SUCCESS);
+}
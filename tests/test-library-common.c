@@ -0,0 +1,54 @@
+/*
+This file is part of gmsk-transfer, a program to send or receive data
+by software defined radio using the GMSK modulation.
+
+Copyright 2022 Guillaume LE VAILLANT
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <string.h>
+#include "test-library-common.h"
+
+int read_data(void *context, unsigned char *payload, unsigned int payload_size)
+{
+  struct context_s *ctx = (struct context_s *) context;
+  unsigned int size = payload_size;
+
+  if(ctx->index == ctx->size)
+  {
+    return(-1);
+  }
+  if(ctx->index + size > ctx->size)
+  {
+    size = ctx->size - ctx->index;
+  }
+  memcpy(payload, ctx->data + ctx->index, size);
+  ctx->index += size;
+
+  return(size);
+}
+
+int write_data(void *context, unsigned char *payload, unsigned int payload_size)
+{
+  struct context_s *ctx = (struct context_s *) context;
+
+  /* Note: The callback of a real application would make sure that it can write
+   * all the payload without buffer overflow.
+   */
+  memcpy(ctx->data + ctx->size, payload, payload_size);
+  ctx->size += payload_size;
+
+  return(payload_size);
+}
@@ -0,0 +1,38 @@
+/*
+This file is part of gmsk-transfer, a program to send or receive data
+by software defined radio using the GMSK modulation.
+
+Copyright 2022 Guillaume LE VAILLANT
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef TEST_LIBRARY_COMMON_H
+#define TEST_LIBRARY_COMMON_H
+
+/* Data sent or received by the data callbacks of the tests */
+struct context_s
+{
+  unsigned char data[256];
+  unsigned int size;
+  unsigned int index;
+};
+
+/* Data callback giving the 'size' bytes of 'data' in transmit mode */
+int read_data(void *context, unsigned char *payload, unsigned int payload_size);
+
+/* Data callback appending the payloads to 'data' in receive mode */
+int write_data(void *context, unsigned char *payload, unsigned int payload_size);
+
+#endif
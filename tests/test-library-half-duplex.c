@@ -0,0 +1,108 @@
+/*
+This file is part of gmsk-transfer, a program to send or receive data
+by software defined radio using the GMSK modulation.
+
+Copyright 2022 Guillaume LE VAILLANT
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "gmsk-transfer.h"
+#include "test-library-common.h"
+
+int main()
+{
+  gmsk_transfer_t transfer;
+  struct context_s context;
+  char message[] = "This is a test transmission using a half-duplex transfer.";
+  char samples_file[] = "/tmp/samples.XXXXXX";
+  int samples_fd = mkstemp(samples_file);
+  int ok = 0;
+
+  fprintf(stderr, "Test: Send and receive switching the direction\n");
+
+  if(samples_fd == -1)
+  {
+    fprintf(stderr, "Error: Failed to create temporary file\n");
+    return(EXIT_FAILURE);
+  }
+
+  if(dup2(samples_fd, STDIN_FILENO) == -1)
+  {
+    fprintf(stderr, "Error: Failed to redirect standard input\n");
+    return(EXIT_FAILURE);
+  }
+  if(dup2(samples_fd, STDOUT_FILENO) == -1)
+  {
+    fprintf(stderr, "Error: Failed to redirect standard output\n");
+    return(EXIT_FAILURE);
+  }
+
+  bzero(&context, sizeof(context));
+  strcpy((char *) context.data, message);
+  context.size = strlen(message);
+  transfer = gmsk_transfer_create_callback("io",
+                                           1,
+                                           read_data,
+                                           &context,
+                                           2000000,
+                                           9600,
+                                           434000000,
+                                           0,
+                                           0,
+                                           "0",
+                                           0,
+                                           0.5,
+                                           "h128",
+                                           "none",
+                                           "",
+                                           NULL,
+                                           0,
+                                           0);
+  if(transfer == NULL)
+  {
+    fprintf(stderr, "Error: Failed to initialize transfer\n");
+    return(EXIT_FAILURE);
+  }
+  gmsk_transfer_start(transfer);
+
+  /* Receive the samples that have just been sent */
+  lseek(samples_fd, 0, SEEK_SET);
+  bzero(&context, sizeof(context));
+  if(gmsk_transfer_switch_direction(transfer, 0, "0", write_data, &context) < 0)
+  {
+    fprintf(stderr, "Error: Failed to switch the direction of the transfer\n");
+    return(EXIT_FAILURE);
+  }
+  gmsk_transfer_start(transfer);
+  gmsk_transfer_free(transfer);
+
+  ok = ((context.size == strlen(message)) &&
+        (memcmp(message, context.data, context.size) == 0));
+  close(samples_fd);
+  unlink(samples_file);
+
+  if(ok)
+  {
+    return(EXIT_SUCCESS);
+  }
+  else
+  {
+    return(EXIT_FAILURE);
+  }
+}
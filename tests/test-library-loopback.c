@@ -0,0 +1,127 @@
+/*
+This file is part of gmsk-transfer, a program to send or receive data
+by software defined radio using the GMSK modulation.
+
+Copyright 2022 Guillaume LE VAILLANT
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "gmsk-transfer.h"
+#include "test-library-common.h"
+
+void * reception_thread(void *arg)
+{
+  gmsk_transfer_start((gmsk_transfer_t) arg);
+
+  return(NULL);
+}
+
+int main()
+{
+  gmsk_transfer_t send;
+  gmsk_transfer_t receive;
+  pthread_t thread;
+  struct context_s send_context;
+  struct context_s receive_context;
+  char message[] = "This is a test transmission using a shared radio.";
+  char expected[256];
+  unsigned int run;
+  int ok = 0;
+
+  fprintf(stderr, "Test: Send and receive twice sharing a loopback radio\n");
+
+  bzero(&send_context, sizeof(send_context));
+  strcpy((char *) send_context.data, message);
+  send_context.size = strlen(message);
+  bzero(&receive_context, sizeof(receive_context));
+  strcpy(expected, message);
+  strcat(expected, message);
+
+  receive = gmsk_transfer_create_callback("loopback",
+                                          0,
+                                          write_data,
+                                          &receive_context,
+                                          2000000,
+                                          9600,
+                                          434000000,
+                                          0,
+                                          0,
+                                          "0",
+                                          0,
+                                          0.5,
+                                          "h128",
+                                          "none",
+                                          "",
+                                          NULL,
+                                          0,
+                                          0);
+  if(receive == NULL)
+  {
+    fprintf(stderr, "Error: Failed to initialize transfer\n");
+    return(EXIT_FAILURE);
+  }
+  send = gmsk_transfer_create_shared_callback(receive,
+                                              1,
+                                              read_data,
+                                              &send_context,
+                                              434000000,
+                                              0,
+                                              "0",
+                                              0);
+  if(send == NULL)
+  {
+    fprintf(stderr, "Error: Failed to initialize transfer\n");
+    return(EXIT_FAILURE);
+  }
+
+  /* The pair is run twice to check that the shared radio can be reused,
+   * the payloads of both runs are appended to the received data */
+  for(run = 0; run < 2; run++)
+  {
+    if(run > 0)
+    {
+      gmsk_transfer_reset(send);
+      gmsk_transfer_reset(receive);
+      send_context.index = 0;
+    }
+
+    /* Each direction runs in its own thread */
+    if(pthread_create(&thread, NULL, reception_thread, receive) != 0)
+    {
+      fprintf(stderr, "Error: Failed to start reception thread\n");
+      return(EXIT_FAILURE);
+    }
+    gmsk_transfer_start(send);
+    pthread_join(thread, NULL);
+  }
+  gmsk_transfer_free(send);
+  gmsk_transfer_free(receive);
+
+  ok = ((receive_context.size == strlen(expected)) &&
+        (memcmp(expected, receive_context.data, receive_context.size) == 0));
+
+  if(ok)
+  {
+    return(EXIT_SUCCESS);
+  }
+  else
+  {
+    return(EXIT_FAILURE);
+  }
+}
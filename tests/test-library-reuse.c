@@ -0,0 +1,145 @@
+/*
+This file is part of gmsk-transfer, a program to send or receive data
+by software defined radio using the GMSK modulation.
+
+Copyright 2022 Guillaume LE VAILLANT
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "gmsk-transfer.h"
+#include "test-library-common.h"
+
+int main()
+{
+  gmsk_transfer_t send;
+  gmsk_transfer_t receive;
+  struct context_s context;
+  char message1[] = "This is a test transmission ";
+  char message2[] = "using the same transfer twice.";
+  char message[128];
+  char expected[256];
+  char samples_file[] = "/tmp/samples.XXXXXX";
+  int samples_fd = mkstemp(samples_file);
+  int ok = 0;
+
+  fprintf(stderr, "Test: Send and receive reusing the transfers\n");
+
+  strcpy(message, message1);
+  strcat(message, message2);
+  strcpy(expected, message);
+  strcat(expected, message);
+
+  if(samples_fd == -1)
+  {
+    fprintf(stderr, "Error: Failed to create temporary file\n");
+    return(EXIT_FAILURE);
+  }
+
+  if(dup2(samples_fd, STDIN_FILENO) == -1)
+  {
+    fprintf(stderr, "Error: Failed to redirect standard input\n");
+    return(EXIT_FAILURE);
+  }
+  if(dup2(samples_fd, STDOUT_FILENO) == -1)
+  {
+    fprintf(stderr, "Error: Failed to redirect standard output\n");
+    return(EXIT_FAILURE);
+  }
+
+  /* Send the message in two runs of the same transfer */
+  bzero(&context, sizeof(context));
+  send = gmsk_transfer_create_callback("io",
+                                       1,
+                                       read_data,
+                                       &context,
+                                       2000000,
+                                       9600,
+                                       434000000,
+                                       0,
+                                       0,
+                                       "0",
+                                       0,
+                                       0.5,
+                                       "h128",
+                                       "none",
+                                       "",
+                                       NULL,
+                                       0,
+                                       0);
+  if(send == NULL)
+  {
+    fprintf(stderr, "Error: Failed to initialize transfer\n");
+    return(EXIT_FAILURE);
+  }
+  strcpy((char *) context.data, message1);
+  context.size = strlen(message1);
+  gmsk_transfer_start(send);
+  gmsk_transfer_reset(send);
+  strcpy((char *) context.data, message2);
+  context.size = strlen(message2);
+  context.index = 0;
+  gmsk_transfer_start(send);
+  gmsk_transfer_free(send);
+
+  /* Receive the samples twice with the same transfer */
+  lseek(samples_fd, 0, SEEK_SET);
+  bzero(&context, sizeof(context));
+  receive = gmsk_transfer_create_callback("io",
+                                          0,
+                                          write_data,
+                                          &context,
+                                          2000000,
+                                          9600,
+                                          434000000,
+                                          0,
+                                          0,
+                                          "0",
+                                          0,
+                                          0.5,
+                                          "h128",
+                                          "none",
+                                          "",
+                                          NULL,
+                                          0,
+                                          0);
+  if(receive == NULL)
+  {
+    fprintf(stderr, "Error: Failed to initialize transfer\n");
+    return(EXIT_FAILURE);
+  }
+  gmsk_transfer_start(receive);
+  lseek(samples_fd, 0, SEEK_SET);
+  gmsk_transfer_reset(receive);
+  gmsk_transfer_start(receive);
+  gmsk_transfer_free(receive);
+
+  ok = ((context.size == strlen(expected)) &&
+        (memcmp(expected, context.data, context.size) == 0));
+  close(samples_fd);
+  unlink(samples_file);
+
+  if(ok)
+  {
+    return(EXIT_SUCCESS);
+  }
+  else
+  {
+    return(EXIT_FAILURE);
+  }
+}
@@ -0,0 +1,133 @@
+/*
+This file is part of gmsk-transfer, a program to send or receive data
+by software defined radio using the GMSK modulation.
+
+Copyright 2022 Guillaume LE VAILLANT
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "gmsk-transfer.h"
+#include "test-library-common.h"
+
+void * reception_thread(void *arg)
+{
+  gmsk_transfer_start((gmsk_transfer_t) arg);
+
+  return(NULL);
+}
+
+int main()
+{
+  gmsk_transfer_t send;
+  gmsk_transfer_t receive;
+  pthread_t thread;
+  gmsk_transfer_stats_t send_stats;
+  gmsk_transfer_stats_t receive_stats;
+  struct context_s send_context;
+  struct context_s receive_context;
+  char message[] = "This is a test transmission through a simulated channel.";
+  /* Noise, small frequency and clock errors, and echoes during 2 us, with
+   * the samples sent in real time */
+  char channel[] = "sim=snr=15,cfo=50,drift=20,multipath=2,seed=7,paced";
+  int ok = 0;
+
+  fprintf(stderr, "Test: Send and receive through a simulated channel\n");
+
+  bzero(&send_context, sizeof(send_context));
+  strcpy((char *) send_context.data, message);
+  send_context.size = strlen(message);
+  bzero(&receive_context, sizeof(receive_context));
+
+  receive = gmsk_transfer_create_callback(channel,
+                                          0,
+                                          write_data,
+                                          &receive_context,
+                                          500000,
+                                          9600,
+                                          434000000,
+                                          0,
+                                          0,
+                                          "0",
+                                          0,
+                                          0.5,
+                                          "h128",
+                                          "none",
+                                          "",
+                                          NULL,
+                                          0,
+                                          0);
+  if(receive == NULL)
+  {
+    fprintf(stderr, "Error: Failed to initialize transfer\n");
+    return(EXIT_FAILURE);
+  }
+  send = gmsk_transfer_create_shared_callback(receive,
+                                              1,
+                                              read_data,
+                                              &send_context,
+                                              434000000,
+                                              0,
+                                              "0",
+                                              0);
+  if(send == NULL)
+  {
+    fprintf(stderr, "Error: Failed to initialize transfer\n");
+    return(EXIT_FAILURE);
+  }
+
+  /* Each direction runs in its own thread */
+  if(pthread_create(&thread, NULL, reception_thread, receive) != 0)
+  {
+    fprintf(stderr, "Error: Failed to start reception thread\n");
+    return(EXIT_FAILURE);
+  }
+  gmsk_transfer_start(send);
+  pthread_join(thread, NULL);
+  gmsk_transfer_get_stats(send, &send_stats);
+  gmsk_transfer_get_stats(receive, &receive_stats);
+  gmsk_transfer_free(send);
+  gmsk_transfer_free(receive);
+
+  ok = ((receive_context.size == strlen(message)) &&
+        (memcmp(message, receive_context.data, receive_context.size) == 0));
+  if(ok)
+  {
+    /* The message fits in one frame */
+    ok = ((send_stats.frames_sent == 1) &&
+          (send_stats.bytes_sent == strlen(message)) &&
+          (receive_stats.frames_received == 1) &&
+          (receive_stats.bytes_received == strlen(message)) &&
+          (receive_stats.frames_corrupted_header == 0) &&
+          (receive_stats.frames_corrupted_payload == 0) &&
+          (receive_stats.rssi == receive_stats.rssi_average));
+    if(!ok)
+    {
+      fprintf(stderr, "Error: Wrong statistics\n");
+    }
+  }
+
+  if(ok)
+  {
+    return(EXIT_SUCCESS);
+  }
+  else
+  {
+    return(EXIT_FAILURE);
+  }
+}
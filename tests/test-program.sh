@@ -24,6 +24,7 @@ GMSK_TRANSFER=../src/gmsk-transfer
 MESSAGE=$(mktemp -t message.XXXXXX)
 DECODED=$(mktemp -t decoded.XXXXXX)
 SAMPLES=$(mktemp -t samples.XXXXXX)
+METRICS=$(mktemp -t metrics.XXXXXX)
 
 echo "This is a test transmission using gmsk-transfer." > ${MESSAGE}
 
@@ -75,6 +76,22 @@ check_nok_file()
     ! diff -q ${MESSAGE} ${DECODED} > /dev/null
 }
 
+# Send the message twice with some silence between the frames
+check_ok_file_silence()
+{
+    NAME=$1
+    OPTIONS1=$2
+    OPTIONS2=$3
+    SILENCE=$4
+
+    echo "Test: ${NAME}"
+    ${GMSK_TRANSFER} -t -r io ${OPTIONS1} ${MESSAGE} > ${SAMPLES}
+    head -c ${SILENCE} /dev/zero >> ${SAMPLES}
+    ${GMSK_TRANSFER} -t -r io ${OPTIONS1} ${MESSAGE} >> ${SAMPLES}
+    ${GMSK_TRANSFER} -r file=${SAMPLES} ${OPTIONS2} ${DECODED}
+    cat ${MESSAGE} ${MESSAGE} | diff -q - ${DECODED} > /dev/null
+}
+
 check_ok_io "Default parameters" "" ""
 check_ok_io "Bit rate 1200" "-b 1200" "-b 1200"
 check_ok_file "Bit rate 38400" "-b 38400" "-b 38400"
@@ -95,6 +112,53 @@ check_ok_io "FEC Hamming(7/4)" "-e h74" "-e h74"
 check_ok_file "FEC Golay(24/12) and repeat(3)" "-e g2412,rep3" "-e g2412,rep3"
 check_ok_io "Id a1B2" "-i a1B2" "-i a1B2"
 check_nok_file "Wrong id ABCD ABC" "-i ABCD" "-i ABC"
+check_nok_io "Wrong id ABCD EFGH with pipelined reception" "-i ABCD" "-i EFGH -p 4"
+check_ok_io "Pipelined reception" "" "-p 4"
+check_ok_file "Pipelined reception with small rings" "-b 38400" "-b 38400 -p 1"
+check_ok_io "Pipelined transmission" "-p 4" ""
+check_ok_file "Multi-channel reception, channel 0" "" "-m 8"
+check_ok_file "Multi-channel reception, channel 1" \
+              "-f 434250000 -o 250000" \
+              "-f 434000000 -m 8"
+check_ok_io "Multi-channel reception, channel 7" \
+            "-f 433750000 -o -250000" \
+            "-f 434000000 -m 8"
+check_ok_io "Squelch" "" "-q 6"
+check_ok_file "Squelch with pipelined reception" "" "-q 6 -p 4"
+# 30 ms of silence (480000 bytes at 2 MS/s) is long enough for the gate to
+# close, and short enough for it to open again in the same block of samples
+check_ok_file_silence "Squelch with silence between frames" "" "-q 6" 480000
+check_ok_file_silence "Squelch with silence between frames, pipelined" \
+                      "" "-q 6 -p 4" 480000
+check_ok_file "Pipelined transmission and reception" "-e h74 -p 8" "-e h74 -p 8"
+check_ok_io "Coalescing delay" "-l 20" ""
+check_ok_file "Coalescing delay with pipelined transmission" "-l 20 -p 4" ""
+check_ok_io "Frame aggregation" "-b 1200 -A 8" "-b 1200"
+check_ok_io "Frame aggregation with coalescing delay" \
+            "-b 1200 -A 8 -l 20" \
+            "-b 1200"
+check_ok_file "Frame aggregation with id and pipelined reception" \
+              "-b 1200 -A 8 -i test" \
+              "-b 1200 -i test -p 4"
+check_ok_io "Short preamble and header" "-P 15,4,1" "-P 15,4"
+check_ok_file "Long preamble with id and aggregation" \
+              "-P 127,6 -i ab -b 1200 -A 8" \
+              "-P 127,6 -i ab -b 1200"
+check_nok_io "Wrong preamble length 31 63" "-P 31" ""
+check_ok_io "Sample format cs16" "-F cs16" "-F cs16"
+check_ok_file "Sample format cs8" "-F cs8" "-F cs8"
+check_nok_io "Wrong sample format cs16 cf32" "-F cs16" ""
+echo "Test: Start time without hardware clock"
+if ${GMSK_TRANSFER} -t -r io -k +1 ${MESSAGE} > ${SAMPLES}
+then
+    exit 1
+fi
+check_ok_io "Profiling with frequency offset" "-x -o 200000" "-x -o 200000"
+check_ok_file "Profiling with squelch" "-x" "-x -q 6"
+check_ok_io "Metrics file" "" "-M ${METRICS}"
+grep -q '^gmsk_transfer_frames_received_total{result="ok"} 1$' ${METRICS}
+check_nok_io "Metrics file with wrong id" "-i ABCD" "-i EFGH -M ${METRICS}"
+grep -q '^gmsk_transfer_frames_received_total{result="ignored"} 1$' ${METRICS}
 check_ok_file "Audio frequency 1500" \
               "-a -s 48000 -f 1500 -b 1200" \
               "-a -s 48000 -f 1500 -b 1200"
@@ -104,11 +168,28 @@ check_nok_io "Wrong audio frequency 1500 2500" \
 check_ok_io "Audio gain -20" \
             "-a -s 48000 -f 1500 -b 1200 -g -20" \
             "-a -s 48000 -f 1500 -b 1200"
+check_ok_io "Audio engine to Hilbert transform" \
+            "-a -s 48000 -f 1500 -b 1200" \
+            "-a -s 48000 -f 1500 -b 1200 -p 4"
+check_ok_io "Hilbert transform to audio engine" \
+            "-a -s 48000 -f 1500 -b 1200 -p 4" \
+            "-a -s 48000 -f 1500 -b 1200"
+check_ok_io "Audio sample rate 44100" \
+            "-a -s 44100 -f 1500 -b 1200" \
+            "-a -s 44100 -f 1500 -b 1200"
+check_ok_io "Frame aggregation with audio engine" \
+            "-a -s 48000 -f 1500 -b 1200 -A 4" \
+            "-a -s 48000 -f 1500 -b 1200"
+
+dd if=/dev/random of=${MESSAGE} bs=1000 count=60 status=none
+check_ok_file "Parallel decoding of a long recording" \
+              "-s 38400 -b 9600" \
+              "-s 38400 -b 9600 -j 4"
 
 dd if=/dev/random of=${MESSAGE} bs=1000 count=1000 status=none
 check_ok_file "Bit rate 8000000 and sample rate 20000000" \
               "-s 20000000 -b 8000000" \
               "-s 20000000 -b 8000000"
 
-rm -f ${MESSAGE} ${DECODED} ${SAMPLES}
+rm -f ${MESSAGE} ${DECODED} ${SAMPLES} ${METRICS}
 echo "All tests passed."